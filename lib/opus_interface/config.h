@@ -7,14 +7,30 @@
 #ifndef CONFIG_H
 #define CONFIG_H
 
+#if defined(CONFIG_OPUS_SCRATCH_ARENA)
+/* Scratch memory from one static arena, see Opus_Scratch_Alloc() */
+#define NONTHREADSAFE_PSEUDOSTACK
+#define GLOBAL_STACK_SIZE CONFIG_OPUS_SCRATCH_ARENA_SIZE
+#else
 /* Variable leng arays  */
 #define VAR_ARRAYS
+#endif
 // #define USE_ALLOCA
 /* Comment out the next line for floating-point code */
 #define FIXED_POINT 1
 
 #define DISABLE_FLOAT_API
 
+#if defined(CONFIG_AUDIO_BIT_DEPTH_32)
+/* Keep 24 bits through the fixed-point decoder, opus_res is 32 bit */
+#define ENABLE_RES24
+#endif
+
+#if defined(CONFIG_OPUS_CUSTOM_MODE)
+/* opus_custom_* API with frame sizes other than 2.5, 5, 10 and 20 ms */
+#define CUSTOM_MODES
+#endif
+
 #define OPUS_BUILD 1
 
 #endif /* CONFIG_H */
@@ -32,3 +32,14 @@ static OPUS_INLINE void opus_free(void *ptr)
 {
 	k_free(ptr);
 }
+
+#if defined(NONTHREADSAFE_PSEUDOSTACK)
+#define OVERRIDE_OPUS_ALLOC_SCRATCH
+
+void *Opus_Scratch_Alloc(size_t size);
+
+static OPUS_INLINE void *opus_alloc_scratch(size_t size)
+{
+	return Opus_Scratch_Alloc(size);
+}
+#endif /* defined(NONTHREADSAFE_PSEUDOSTACK) */
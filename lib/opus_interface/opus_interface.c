@@ -5,7 +5,11 @@
  */
 
 /* Includes ------------------------------------------------------------------*/
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
 #include "opus_interface.h"
+#include <string.h>
 #include <zephyr/kernel.h>
 #include <zephyr/logging/log.h>
 LOG_MODULE_REGISTER(opus_interface, CONFIG_AUDIO_SYSTEM_LOG_LEVEL);
@@ -23,22 +27,88 @@ typedef struct {
 
 	OpusEncoder *Encoder; /*!< Opus encoder. */
 
+	OpusMSEncoder *MSEncoder; /*!< Opus multistream encoder, used instead of Encoder. */
+
+	OpusCustomEncoder *CEncoder; /*!< Opus Custom encoder, used instead of Encoder. */
+
+	OpusCustomMode *ENC_mode; /*!< Mode of the Opus Custom encoder. */
+
+	uint8_t ENC_res24; /*!< Encoder input is 24 bit samples in 32 bit words. */
+
 	uint8_t ENC_configured; /*!< Specifies if the Encoder is configured. */
 
 	OpusDecoder *Decoder; /*!< Opus decoder. */
 
+	OpusCustomDecoder *CDecoder; /*!< Opus Custom decoder, used instead of Decoder. */
+
+	OpusCustomMode *DEC_mode; /*!< Mode of the Opus Custom decoder. */
+
+	uint8_t DEC_streams; /*!< Number of streams in a multistream packet. */
+
+	uint8_t DEC_stream_id; /*!< Stream decoded from a multistream packet. */
+
+	uint8_t DEC_res24; /*!< Decoder output is 24 bit samples in 32 bit words. */
+
 	uint8_t DEC_configured; /*!< Specifies if the Decoder is configured. */
 
 } OPUS_HandleTypeDef;
 
 /* Private defines -----------------------------------------------------------*/
+/* Largest packet a single Opus stream produces for one frame */
+#define OPUS_MAX_PACKET_BYTES 1275
+
+#if defined(NONTHREADSAFE_PSEUDOSTACK)
+/* Fill pattern of the scratch arena, bytes still holding it were never used */
+#define OPUS_SCRATCH_FILL  0xAA
+/* Bytes past the arena checked after every call, an overflow up to this size only
+ * writes the guard
+ */
+#define OPUS_SCRATCH_GUARD 256
+#endif /* defined(NONTHREADSAFE_PSEUDOSTACK) */
+
 /* Private macros ------------------------------------------------------------*/
+/* Route encoder ctl requests to the multistream or custom encoder when one is in use */
+#define ENC_OPUS_CTL(...)                                                                          \
+	((hOpus.CEncoder != NULL)    ? opus_custom_encoder_ctl(hOpus.CEncoder, __VA_ARGS__)       \
+	 : (hOpus.MSEncoder != NULL) ? opus_multistream_encoder_ctl(hOpus.MSEncoder, __VA_ARGS__) \
+				     : opus_encoder_ctl(hOpus.Encoder, __VA_ARGS__))
+
 /* Private variables ---------------------------------------------------------*/
 static OPUS_HandleTypeDef hOpus = {.ENC_configured = 0, .DEC_configured = 0};
 
+#if defined(NONTHREADSAFE_PSEUDOSTACK)
+static uint8_t opus_scratch[GLOBAL_STACK_SIZE + OPUS_SCRATCH_GUARD] __aligned(8);
+static uint8_t opus_scratch_ready;
+#endif /* defined(NONTHREADSAFE_PSEUDOSTACK) */
+
 /* Global variables ----------------------------------------------------------*/
 /* Private function prototypes -----------------------------------------------*/
 
+#if defined(NONTHREADSAFE_PSEUDOSTACK)
+/**
+ * @brief  Fails a codec call found to have run past the end of the scratch arena.
+ * @note   Opus does not bound its pseudostack allocations, so the overflow is only
+ *         seen after the call returned. One that went further than the guard has
+ *         already overwritten the RAM after the arena and the system should not be
+ *         trusted. The guard also misses writes of the fill pattern itself.
+ * @param  ret: Return value of the codec call.
+ * @retval ret, or OPUS_ALLOC_FAIL if the guard bytes were written.
+ */
+static int Opus_Scratch_Check(int ret)
+{
+	for (int i = GLOBAL_STACK_SIZE; i < sizeof(opus_scratch); i++) {
+		if (opus_scratch[i] != OPUS_SCRATCH_FILL) {
+			LOG_ERR("Opus scratch arena overflow, increase OPUS_SCRATCH_ARENA_SIZE");
+			return OPUS_ALLOC_FAIL;
+		}
+	}
+
+	return ret;
+}
+#else
+#define Opus_Scratch_Check(ret) (ret)
+#endif /* defined(NONTHREADSAFE_PSEUDOSTACK) */
+
 /* Functions Definition ------------------------------------------------------*/
 /**
  * @brief  This function returns the amount of memory required for the current encoder setup.
@@ -47,9 +117,20 @@ static OPUS_HandleTypeDef hOpus = {.ENC_configured = 0, .DEC_configured = 0};
  */
 uint32_t ENC_Opus_getMemorySize(ENC_Opus_ConfigTypeDef *EncConfigOpus)
 {
-	uint32_t tot_enc_size =
-		(EncConfigOpus->bitrate / 8 / ((uint16_t)(1000.0f / EncConfigOpus->ms_frame))) *
-		2; // Opus frame output data 40 Bytes
+	uint32_t frames_per_sec = (uint16_t)(1000.0f / EncConfigOpus->ms_frame);
+	uint32_t tot_enc_size;
+
+	if (EncConfigOpus->rate_control == OPUS_RATE_CBR) {
+		tot_enc_size = (EncConfigOpus->bitrate / 8 / frames_per_sec) *
+			       2; // Opus frame output data 40 Bytes
+	} else {
+		/* The encoder never writes more than the buffer, which caps the peak rate */
+		tot_enc_size = OPUS_MAX_PACKET_BYTES * MAX(EncConfigOpus->streams, 1);
+		if (EncConfigOpus->peak_bitrate) {
+			tot_enc_size = MIN(tot_enc_size,
+					   EncConfigOpus->peak_bitrate / 8 / frames_per_sec);
+		}
+	}
 
 	return tot_enc_size;
 }
@@ -63,7 +144,7 @@ uint32_t DEC_Opus_getMemorySize(DEC_Opus_ConfigTypeDef *DecConfigOpus)
 {
 	uint32_t tot_dec_size = ((uint32_t)(((float)(DecConfigOpus->sample_freq / 1000)) *
 					    DecConfigOpus->ms_frame)) *
-				DecConfigOpus->channels * 2;
+				DecConfigOpus->channels * (DecConfigOpus->res24 ? 4 : 2);
 
 	return tot_dec_size;
 }
@@ -81,32 +162,79 @@ Opus_Status ENC_Opus_Init(ENC_Opus_ConfigTypeDef *ENC_configOpus, int *opus_err)
 
 	hOpus.ENC_frame_size =
 		(uint16_t)(((float)(ENC_configOpus->sample_freq / 1000)) *
-			   ENC_configOpus->ms_frame); // Opus input frame sample amount 480
-
-	hOpus.max_enc_frame_size =
-		(ENC_configOpus->bitrate / 8 / ((uint16_t)(1000.0f / ENC_configOpus->ms_frame))) *
-		2; // Opus output frame data size 40 Bytes
-
-	/*Encoder Init*/
-	//   hOpus.Encoder = opus_encoder_create(ENC_configOpus->sample_freq,
-	//   ENC_configOpus->channels, ENC_configOpus->application, opus_err);
-	size_t encoder_size = opus_encoder_get_size(ENC_configOpus->channels);
-	LOG_INF("Encoder will allocate memory of size: %d", encoder_size);
-	hOpus.Encoder = (OpusEncoder *)k_malloc(encoder_size);
-	if (hOpus.Encoder == NULL) {
-		*opus_err = OPUS_ALLOC_FAIL;
+			   ENC_configOpus->ms_frame); // 120, 240, 480 or 960 samples at 48 kHz
+
+	hOpus.max_enc_frame_size = ENC_Opus_getMemorySize(ENC_configOpus);
+	hOpus.ENC_res24 = ENC_configOpus->res24;
+
+	if (ENC_configOpus->custom) {
+#if defined(CUSTOM_MODES)
+		/*Opus Custom Encoder Init, the mode is created for the frame size*/
+		hOpus.ENC_mode = opus_custom_mode_create(ENC_configOpus->sample_freq,
+							 hOpus.ENC_frame_size, opus_err);
+		if (hOpus.ENC_mode == NULL) {
+			return OPUS_ERROR;
+		}
+
+		size_t encoder_size =
+			opus_custom_encoder_get_size(hOpus.ENC_mode, ENC_configOpus->channels);
+		LOG_INF("Custom encoder will allocate memory of size: %d", encoder_size);
+		hOpus.CEncoder = (OpusCustomEncoder *)k_malloc(encoder_size);
+		if (hOpus.CEncoder == NULL) {
+			*opus_err = OPUS_ALLOC_FAIL;
+			return OPUS_ERROR;
+		}
+		*opus_err = opus_custom_encoder_init(hOpus.CEncoder, hOpus.ENC_mode,
+						     ENC_configOpus->channels);
+#else
+		*opus_err = OPUS_UNIMPLEMENTED;
 		return OPUS_ERROR;
+#endif /* defined(CUSTOM_MODES) */
+	} else if (ENC_configOpus->streams) {
+		/*Multistream Encoder Init, channel n is coded in stream n*/
+		unsigned char mapping[ENC_configOpus->channels];
+
+		for (int i = 0; i < ENC_configOpus->channels; i++) {
+			mapping[i] = i;
+		}
+
+		size_t encoder_size = opus_multistream_encoder_get_size(
+			ENC_configOpus->streams, ENC_configOpus->coupled_streams);
+		LOG_INF("Multistream encoder will allocate memory of size: %d", encoder_size);
+		hOpus.MSEncoder = (OpusMSEncoder *)k_malloc(encoder_size);
+		if (hOpus.MSEncoder == NULL) {
+			*opus_err = OPUS_ALLOC_FAIL;
+			return OPUS_ERROR;
+		}
+		*opus_err = opus_multistream_encoder_init(
+			hOpus.MSEncoder, ENC_configOpus->sample_freq, ENC_configOpus->channels,
+			ENC_configOpus->streams, ENC_configOpus->coupled_streams, mapping,
+			ENC_configOpus->application);
+	} else {
+		/*Encoder Init*/
+		//   hOpus.Encoder = opus_encoder_create(ENC_configOpus->sample_freq,
+		//   ENC_configOpus->channels, ENC_configOpus->application, opus_err);
+		size_t encoder_size = opus_encoder_get_size(ENC_configOpus->channels);
+		LOG_INF("Encoder will allocate memory of size: %d", encoder_size);
+		hOpus.Encoder = (OpusEncoder *)k_malloc(encoder_size);
+		if (hOpus.Encoder == NULL) {
+			*opus_err = OPUS_ALLOC_FAIL;
+			return OPUS_ERROR;
+		}
+		*opus_err = opus_encoder_init(hOpus.Encoder, ENC_configOpus->sample_freq,
+					      ENC_configOpus->channels,
+					      ENC_configOpus->application);
 	}
-	*opus_err = opus_encoder_init(hOpus.Encoder, ENC_configOpus->sample_freq,
-				      ENC_configOpus->channels, ENC_configOpus->application);
 
 	if (*opus_err != OPUS_SUCCESS) {
 		return OPUS_ERROR;
 	}
 
-	status = ENC_Opus_Force_CELTmode();
-	if (status != OPUS_SUCCESS) {
-		return OPUS_ERROR;
+	if (hOpus.CEncoder == NULL) {
+		status = ENC_Opus_Force_CELTmode();
+		if (status != OPUS_SUCCESS) {
+			return OPUS_ERROR;
+		}
 	}
 
 	/*Bitrate set*/
@@ -121,43 +249,60 @@ Opus_Status ENC_Opus_Init(ENC_Opus_ConfigTypeDef *ENC_configOpus, int *opus_err)
 		return OPUS_ERROR;
 	}
 
-	status = ENC_Opus_Set_CBR();
+	switch (ENC_configOpus->rate_control) {
+	case OPUS_RATE_CVBR:
+		status = ENC_Opus_Set_CVBR();
+		break;
+	case OPUS_RATE_VBR:
+		status = ENC_Opus_Set_VBR();
+		break;
+	default:
+		status = ENC_Opus_Set_CBR();
+		break;
+	}
 	if (status != OPUS_SUCCESS) {
 		return OPUS_ERROR;
 	}
 
-	//   status = ENC_Opus_Set_VBR();
-	//   if (status != OPUS_SUCCESS)
-	//   {
-	//         return OPUS_ERROR;
-	//   }
-
-	status = opus_encoder_ctl(hOpus.Encoder, OPUS_SET_LSB_DEPTH(16));
+	status = ENC_OPUS_CTL(OPUS_SET_LSB_DEPTH(
+		ENC_configOpus->lsb_depth ? ENC_configOpus->lsb_depth
+					  : (ENC_configOpus->res24 ? 24 : 16)));
 	if (status != OPUS_SUCCESS) {
 		return OPUS_ERROR;
 	}
 
-	status = opus_encoder_ctl(hOpus.Encoder, OPUS_SET_SIGNAL(OPUS_SIGNAL_MUSIC));
+	status = ENC_OPUS_CTL(OPUS_SET_PACKET_LOSS_PERC(ENC_configOpus->packet_loss_perc));
 	if (status != OPUS_SUCCESS) {
 		return OPUS_ERROR;
 	}
 
-	status = opus_encoder_ctl(hOpus.Encoder, OPUS_SET_DTX(0)); // No fec in celt mode
+	if (hOpus.CEncoder != NULL) {
+		/* Opus Custom codes the full band, signal, DTX and channel ctls do not apply */
+		hOpus.ENC_configured = 1;
+		return OPUS_SUCCESS;
+	}
+
+	status = ENC_OPUS_CTL(
+		OPUS_SET_SIGNAL(ENC_configOpus->signal ? ENC_configOpus->signal : OPUS_AUTO));
 	if (status != OPUS_SUCCESS) {
 		return OPUS_ERROR;
 	}
 
-	status = opus_encoder_ctl(hOpus.Encoder, OPUS_SET_PACKET_LOSS_PERC(15));
+	status = ENC_OPUS_CTL(OPUS_SET_DTX(0)); // No fec in celt mode
 	if (status != OPUS_SUCCESS) {
 		return OPUS_ERROR;
 	}
 
-	status = opus_encoder_ctl(hOpus.Encoder, OPUS_SET_BANDWIDTH(OPUS_BANDWIDTH_WIDEBAND));
+	/* CELT has no mediumband, the encoder codes it as wideband */
+	status = ENC_OPUS_CTL(OPUS_SET_BANDWIDTH(ENC_configOpus->bandwidth ? ENC_configOpus->bandwidth
+									  : OPUS_AUTO));
 	if (status != OPUS_SUCCESS) {
 		return OPUS_ERROR;
 	}
 
-	status = opus_encoder_ctl(hOpus.Encoder, OPUS_SET_FORCE_CHANNELS(2));
+	/* Keep stereo input coded as stereo, mono encoders and streams code one channel */
+	status = ENC_OPUS_CTL(OPUS_SET_FORCE_CHANNELS(
+		ENC_configOpus->streams ? OPUS_AUTO : ENC_configOpus->channels));
 	if (status != OPUS_SUCCESS) {
 		return OPUS_ERROR;
 	}
@@ -176,7 +321,19 @@ void ENC_Opus_Deinit(void)
 {
 	//   opus_encoder_destroy(hOpus.Encoder);
 	k_free(hOpus.Encoder);
+	k_free(hOpus.MSEncoder);
+	k_free(hOpus.CEncoder);
+#if defined(CUSTOM_MODES)
+	if (hOpus.ENC_mode != NULL) {
+		opus_custom_mode_destroy(hOpus.ENC_mode);
+	}
+#endif /* defined(CUSTOM_MODES) */
+	hOpus.Encoder = NULL;
+	hOpus.MSEncoder = NULL;
+	hOpus.CEncoder = NULL;
+	hOpus.ENC_mode = NULL;
 	hOpus.ENC_configured = 0;
+	hOpus.ENC_res24 = 0;
 	hOpus.ENC_frame_size = 0;
 	hOpus.max_enc_frame_size = 0;
 }
@@ -201,25 +358,59 @@ Opus_Status DEC_Opus_Init(DEC_Opus_ConfigTypeDef *DEC_configOpus, int *opus_err)
 {
 	*opus_err = 0;
 	hOpus.DEC_frame_size = ((uint32_t)(((float)(DEC_configOpus->sample_freq / 1000)) *
-					   DEC_configOpus->ms_frame)); // 480 Bytes
-
-	/*Decoder Init*/
-	//   hOpus.Decoder = opus_decoder_create(DEC_configOpus->sample_freq,
-	//   DEC_configOpus->channels, opus_err);
-	int decoder_size = opus_decoder_get_size(DEC_configOpus->channels);
-	LOG_INF("Decoder will allocate memory of size: %d", decoder_size);
-	hOpus.Decoder = (OpusDecoder *)k_malloc(decoder_size);
-	if (hOpus.Decoder == NULL) {
-		*opus_err = OPUS_ALLOC_FAIL;
+					   DEC_configOpus->ms_frame)); // Samples per channel
+
+	if (DEC_configOpus->custom) {
+#if defined(CUSTOM_MODES)
+		/*Opus Custom Decoder Init, the mode must match the encoder*/
+		hOpus.DEC_mode = opus_custom_mode_create(DEC_configOpus->sample_freq,
+							 hOpus.DEC_frame_size, opus_err);
+		if (hOpus.DEC_mode == NULL) {
+			return OPUS_ERROR;
+		}
+
+		int decoder_size =
+			opus_custom_decoder_get_size(hOpus.DEC_mode, DEC_configOpus->channels);
+		LOG_INF("Custom decoder will allocate memory of size: %d", decoder_size);
+		hOpus.CDecoder = (OpusCustomDecoder *)k_malloc(decoder_size);
+		if (hOpus.CDecoder == NULL) {
+			*opus_err = OPUS_ALLOC_FAIL;
+			return OPUS_ERROR;
+		}
+		*opus_err = opus_custom_decoder_init(hOpus.CDecoder, hOpus.DEC_mode,
+						     DEC_configOpus->channels);
+#else
+		*opus_err = OPUS_UNIMPLEMENTED;
 		return OPUS_ERROR;
+#endif /* defined(CUSTOM_MODES) */
+	} else {
+		/*Decoder Init*/
+		//   hOpus.Decoder = opus_decoder_create(DEC_configOpus->sample_freq,
+		//   DEC_configOpus->channels, opus_err);
+		int decoder_size = opus_decoder_get_size(DEC_configOpus->channels);
+		LOG_INF("Decoder will allocate memory of size: %d", decoder_size);
+		hOpus.Decoder = (OpusDecoder *)k_malloc(decoder_size);
+		if (hOpus.Decoder == NULL) {
+			*opus_err = OPUS_ALLOC_FAIL;
+			return OPUS_ERROR;
+		}
+		*opus_err = opus_decoder_init(hOpus.Decoder, DEC_configOpus->sample_freq,
+					      DEC_configOpus->channels);
 	}
-	*opus_err = opus_decoder_init(hOpus.Decoder, DEC_configOpus->sample_freq,
-				      DEC_configOpus->channels);
 
 	if (*opus_err != OPUS_SUCCESS) {
 		return OPUS_ERROR;
 	}
 
+	/* With multistream input only one stream is decoded, the others are skipped */
+	if (DEC_configOpus->stream_id >= MAX(DEC_configOpus->streams, 1)) {
+		*opus_err = OPUS_BAD_ARG;
+		return OPUS_ERROR;
+	}
+	hOpus.DEC_streams = DEC_configOpus->streams;
+	hOpus.DEC_stream_id = DEC_configOpus->stream_id;
+	hOpus.DEC_res24 = DEC_configOpus->res24;
+
 	hOpus.DEC_configured = 1;
 
 	return OPUS_SUCCESS;
@@ -234,8 +425,20 @@ void DEC_Opus_Deinit(void)
 {
 	//   opus_decoder_destroy(hOpus.Decoder);
 	k_free(hOpus.Decoder);
+	k_free(hOpus.CDecoder);
+#if defined(CUSTOM_MODES)
+	if (hOpus.DEC_mode != NULL) {
+		opus_custom_mode_destroy(hOpus.DEC_mode);
+	}
+#endif /* defined(CUSTOM_MODES) */
+	hOpus.Decoder = NULL;
+	hOpus.CDecoder = NULL;
+	hOpus.DEC_mode = NULL;
 	hOpus.DEC_configured = 0;
 	hOpus.DEC_frame_size = 0;
+	hOpus.DEC_streams = 0;
+	hOpus.DEC_stream_id = 0;
+	hOpus.DEC_res24 = 0;
 }
 
 /**
@@ -257,7 +460,7 @@ uint8_t DEC_Opus_IsConfigured(void)
 Opus_Status ENC_Opus_Set_Bitrate(int bitrate, int *opus_err)
 {
 	/*set Opus bitrate*/
-	*opus_err = opus_encoder_ctl(hOpus.Encoder, OPUS_SET_BITRATE(bitrate));
+	*opus_err = ENC_OPUS_CTL(OPUS_SET_BITRATE(bitrate));
 
 	if (*opus_err != OPUS_OK) {
 		return OPUS_ERROR;
@@ -273,7 +476,7 @@ Opus_Status ENC_Opus_Set_Bitrate(int bitrate, int *opus_err)
 Opus_Status ENC_Opus_Set_CBR(void)
 {
 	/*set Opus bitrate*/
-	int err = opus_encoder_ctl(hOpus.Encoder, OPUS_SET_VBR(0));
+	int err = ENC_OPUS_CTL(OPUS_SET_VBR(0));
 
 	if (err != OPUS_OK) {
 		return OPUS_ERROR;
@@ -282,15 +485,41 @@ Opus_Status ENC_Opus_Set_CBR(void)
 }
 
 /**
- * @brief  Set variable bitrate option for the encoder.
+ * @brief  Set unconstrained variable bitrate option for the encoder.
  * @param  None.
  * @retval BV_Status: Value indicating success or error.
  */
 Opus_Status ENC_Opus_Set_VBR(void)
 {
 	/*set Opus bitrate*/
-	int err = opus_encoder_ctl(hOpus.Encoder, OPUS_SET_VBR(1));
+	int err = ENC_OPUS_CTL(OPUS_SET_VBR(1));
 
+	if (err != OPUS_OK) {
+		return OPUS_ERROR;
+	}
+
+	err = ENC_OPUS_CTL(OPUS_SET_VBR_CONSTRAINT(0));
+	if (err != OPUS_OK) {
+		return OPUS_ERROR;
+	}
+	return OPUS_SUCCESS;
+}
+
+/**
+ * @brief  Set constrained variable bitrate option for the encoder.
+ * @param  None.
+ * @retval BV_Status: Value indicating success or error.
+ */
+Opus_Status ENC_Opus_Set_CVBR(void)
+{
+	/*set Opus bitrate*/
+	int err = ENC_OPUS_CTL(OPUS_SET_VBR(1));
+
+	if (err != OPUS_OK) {
+		return OPUS_ERROR;
+	}
+
+	err = ENC_OPUS_CTL(OPUS_SET_VBR_CONSTRAINT(1));
 	if (err != OPUS_OK) {
 		return OPUS_ERROR;
 	}
@@ -306,11 +535,30 @@ Opus_Status ENC_Opus_Set_VBR(void)
 Opus_Status ENC_Opus_Set_Complexity(int complexity, int *opus_err)
 {
 	/*set Opus complexity*/
-	*opus_err = opus_encoder_ctl(hOpus.Encoder, OPUS_SET_COMPLEXITY(complexity));
+	*opus_err = ENC_OPUS_CTL(OPUS_SET_COMPLEXITY(complexity));
+
+	if (*opus_err != OPUS_OK) {
+		return OPUS_ERROR;
+	}
+	return OPUS_SUCCESS;
+}
+
+/**
+ * @brief  Get the delay of the codec, from encoder input to decoder output
+ * @param  lookahead: set to the delay in samples.
+ * @param  opus_err: @ref opus_errorcodes
+ * @retval BV_Status: Value indicating success or error.
+ */
+Opus_Status ENC_Opus_Get_Lookahead(int *lookahead, int *opus_err)
+{
+	opus_int32 value = 0;
+
+	*opus_err = ENC_OPUS_CTL(OPUS_GET_LOOKAHEAD(&value));
 
 	if (*opus_err != OPUS_OK) {
 		return OPUS_ERROR;
 	}
+	*lookahead = value;
 	return OPUS_SUCCESS;
 }
 
@@ -321,7 +569,12 @@ Opus_Status ENC_Opus_Set_Complexity(int complexity, int *opus_err)
  */
 Opus_Status ENC_Opus_Force_SILKmode(void)
 {
-	int err = opus_encoder_ctl(hOpus.Encoder, OPUS_SET_FORCE_MODE(MODE_SILK_ONLY));
+	if (IS_ENABLED(CONFIG_OPUS_CELT_ONLY)) {
+		/* SILK is not built in */
+		return OPUS_ERROR;
+	}
+
+	int err = ENC_OPUS_CTL(OPUS_SET_FORCE_MODE(MODE_SILK_ONLY));
 
 	if (err != OPUS_OK) {
 		return OPUS_ERROR;
@@ -336,7 +589,7 @@ Opus_Status ENC_Opus_Force_SILKmode(void)
  */
 Opus_Status ENC_Opus_Force_CELTmode(void)
 {
-	int err = opus_encoder_ctl(hOpus.Encoder, OPUS_SET_FORCE_MODE(MODE_CELT_ONLY));
+	int err = ENC_OPUS_CTL(OPUS_SET_FORCE_MODE(MODE_CELT_ONLY));
 
 	if (err != OPUS_OK) {
 		return OPUS_ERROR;
@@ -346,29 +599,293 @@ Opus_Status ENC_Opus_Force_CELTmode(void)
 
 /**
  * @brief  Encoding functions
- * @param  buf_in: pointer to the PCM buffer to be encoded.
+ * @param  buf_in: pointer to the PCM buffer to be encoded, 16 bit samples or 24 bit
+ *         samples in 32 bit words if the encoder was configured with res24.
  * @param  buf_out: pointer to the Encoded buffer.
  * @retval Number of bytes in case of success, 0 viceversa.
  */
 int ENC_Opus_Encode(uint8_t *buf_in, uint8_t *buf_out)
 {
-	return opus_encode(hOpus.Encoder, (opus_int16 *)buf_in, 480, (unsigned char *)buf_out,
-			   (opus_int32)hOpus.max_enc_frame_size);
-	//   return opus_encode(hOpus.Encoder, (opus_int16 *) buf_in, hOpus.ENC_frame_size,
-	//   (unsigned char *) buf_out, (opus_int32) hOpus.max_enc_frame_size);
+	int ret;
+
+#if defined(CUSTOM_MODES)
+	if (hOpus.CEncoder != NULL) {
+		if (hOpus.ENC_res24) {
+			ret = opus_custom_encode24(hOpus.CEncoder, (opus_int32 *)buf_in,
+						   hOpus.ENC_frame_size, (unsigned char *)buf_out,
+						   (int)hOpus.max_enc_frame_size);
+		} else {
+			ret = opus_custom_encode(hOpus.CEncoder, (opus_int16 *)buf_in,
+						 hOpus.ENC_frame_size, (unsigned char *)buf_out,
+						 (int)hOpus.max_enc_frame_size);
+		}
+
+		return Opus_Scratch_Check(ret);
+	}
+#endif /* defined(CUSTOM_MODES) */
+
+	if (hOpus.MSEncoder != NULL && hOpus.ENC_res24) {
+		ret = opus_multistream_encode24(hOpus.MSEncoder, (opus_int32 *)buf_in,
+						hOpus.ENC_frame_size, (unsigned char *)buf_out,
+						(opus_int32)hOpus.max_enc_frame_size);
+	} else if (hOpus.MSEncoder != NULL) {
+		ret = opus_multistream_encode(hOpus.MSEncoder, (opus_int16 *)buf_in,
+					      hOpus.ENC_frame_size, (unsigned char *)buf_out,
+					      (opus_int32)hOpus.max_enc_frame_size);
+	} else if (hOpus.ENC_res24) {
+		ret = opus_encode24(hOpus.Encoder, (opus_int32 *)buf_in, hOpus.ENC_frame_size,
+				    (unsigned char *)buf_out, (opus_int32)hOpus.max_enc_frame_size);
+	} else {
+		ret = opus_encode(hOpus.Encoder, (opus_int16 *)buf_in, hOpus.ENC_frame_size,
+				  (unsigned char *)buf_out, (opus_int32)hOpus.max_enc_frame_size);
+	}
+
+	return Opus_Scratch_Check(ret);
+}
+
+/**
+ * @brief  Length of one frame in packet framing, RFC 6716 section 3.2.1.
+ * @param  data: First length byte.
+ * @param  len: Bytes available from data.
+ * @param  frame_len: Returns the frame length.
+ * @retval Number of length bytes, or OPUS_INVALID_PACKET.
+ */
+static int opus_frame_len_parse(const uint8_t *data, opus_int32 len, opus_int32 *frame_len)
+{
+	if (len < 1) {
+		return OPUS_INVALID_PACKET;
+	}
+
+	if (data[0] < 252) {
+		*frame_len = data[0];
+		return 1;
+	}
+
+	if (len < 2) {
+		return OPUS_INVALID_PACKET;
+	}
+
+	*frame_len = data[0] + 4 * data[1];
+
+	return 2;
+}
+
+/**
+ * @brief  Parses a self-delimited Opus packet, RFC 6716 appendix B, as all but the last
+ *         stream of a multistream packet are. It only differs from standard framing by
+ *         one more frame length: of the only frame, of both frames of code 1, or of the
+ *         last frame of codes 2 and 3.
+ * @param  data: Packet.
+ * @param  len: Bytes available from data.
+ * @param  out: Returns the packet in standard framing, of at most OPUS_MAX_PACKET_BYTES,
+ *         NULL to only find where the next stream starts.
+ * @param  out_len: Returns the number of bytes in out.
+ * @retval Size of the self-delimited packet, or @ref opus_errorcodes.
+ */
+static int opus_sd_packet_parse(const uint8_t *data, opus_int32 len, uint8_t *out,
+				opus_int32 *out_len)
+{
+	opus_int32 pos = 1;
+	opus_int32 frame_len;
+	opus_int32 frames_len = 0;
+	opus_int32 padding = 0;
+	opus_int32 sd_pos;
+	opus_int32 total;
+	int count = 1;
+	bool cbr = true;
+	int ret;
+
+	if (len < 1) {
+		return OPUS_INVALID_PACKET;
+	}
+
+	switch (data[0] & 0x3) {
+	case 0:
+		break;
+	case 1:
+		count = 2;
+		break;
+	case 2:
+		count = 2;
+		cbr = false;
+		break;
+	default:
+		if (len < 2 || (data[1] & 0x3F) == 0) {
+			return OPUS_INVALID_PACKET;
+		}
+		count = data[1] & 0x3F;
+		cbr = !(data[1] & 0x80);
+		pos = 2;
+
+		/* Padding length, 255 adds 254 and another length byte follows */
+		for (uint8_t p = (data[1] & 0x40) ? 255 : 0; p == 255; pos++) {
+			if (pos >= len) {
+				return OPUS_INVALID_PACKET;
+			}
+			p = data[pos];
+			padding += (p == 255) ? 254 : p;
+		}
+		break;
+	}
+
+	/* Lengths of all frames but the last, in standard framing too */
+	for (int i = 0; !cbr && i < count - 1; i++) {
+		ret = opus_frame_len_parse(data + pos, len - pos, &frame_len);
+		if (ret < 0) {
+			return ret;
+		}
+		pos += ret;
+		frames_len += frame_len;
+	}
+
+	/* The self-delimiting length, of the last frame or of each frame with CBR */
+	sd_pos = pos;
+	ret = opus_frame_len_parse(data + pos, len - pos, &frame_len);
+	if (ret < 0) {
+		return ret;
+	}
+	pos += ret;
+	frames_len += cbr ? frame_len * count : frame_len;
+
+	total = pos + frames_len + padding;
+	if (total > len) {
+		return OPUS_INVALID_PACKET;
+	}
+
+	if (out != NULL) {
+		*out_len = total - ret;
+		if (*out_len > OPUS_MAX_PACKET_BYTES) {
+			return OPUS_BUFFER_TOO_SMALL;
+		}
+		memcpy(out, data, sd_pos);
+		memcpy(out + sd_pos, data + pos, total - pos);
+	}
+
+	return total;
 }
 
 /**
  * @brief  Decoding functions
  * @param  buf_in: pointer to the Encoded buffer to be decoded.
  * @param  len: length of the buffer in.
- * @param  buf_out: pointer to the Decoded buffer.
+ * @param  buf_out: pointer to the Decoded buffer, 16 bit samples or 24 bit samples in
+ *         32 bit words if the decoder was configured with res24.
  * @retval Number of decoded samples or @ref opus_errorcodes.
  */
 int DEC_Opus_Decode(uint8_t *buf_in, uint32_t len, uint8_t *buf_out)
 {
-	return opus_decode(hOpus.Decoder, (unsigned char *)buf_in, (opus_int32)len,
-			   (opus_int16 *)buf_out, hOpus.DEC_frame_size, 0);
+	int ret;
+
+#if defined(CUSTOM_MODES)
+	if (hOpus.CDecoder != NULL) {
+		if (hOpus.DEC_res24) {
+			ret = opus_custom_decode24(hOpus.CDecoder, (unsigned char *)buf_in,
+						   (int)len, (opus_int32 *)buf_out,
+						   hOpus.DEC_frame_size);
+		} else {
+			ret = opus_custom_decode(hOpus.CDecoder, (unsigned char *)buf_in, (int)len,
+						 (opus_int16 *)buf_out, hOpus.DEC_frame_size);
+		}
+
+		return Opus_Scratch_Check(ret);
+	}
+#endif /* defined(CUSTOM_MODES) */
+
+	/* Without a packet the decoder runs the packet loss concealment */
+	if (hOpus.DEC_streams > 1 && buf_in != NULL) {
+		/* The last stream is in standard framing and decodes as it is */
+		static uint8_t stream_pkt[OPUS_MAX_PACKET_BYTES];
+		opus_int32 stream_len;
+
+		for (int s = 0; s < hOpus.DEC_stream_id; s++) {
+			ret = opus_sd_packet_parse(buf_in, (opus_int32)len, NULL, NULL);
+			if (ret < 0) {
+				return ret;
+			}
+			buf_in += ret;
+			len -= ret;
+		}
+
+		if (hOpus.DEC_stream_id != hOpus.DEC_streams - 1) {
+			ret = opus_sd_packet_parse(buf_in, (opus_int32)len, stream_pkt, &stream_len);
+			if (ret < 0) {
+				return ret;
+			}
+			buf_in = stream_pkt;
+			len = stream_len;
+		}
+	}
+
+	if (hOpus.DEC_res24) {
+		ret = opus_decode24(hOpus.Decoder, (unsigned char *)buf_in, (opus_int32)len,
+				    (opus_int32 *)buf_out, hOpus.DEC_frame_size, 0);
+	} else {
+		ret = opus_decode(hOpus.Decoder, (unsigned char *)buf_in, (opus_int32)len,
+				  (opus_int16 *)buf_out, hOpus.DEC_frame_size, 0);
+	}
+
+	return Opus_Scratch_Check(ret);
+}
+
+#if defined(NONTHREADSAFE_PSEUDOSTACK)
+/**
+ * @brief  Hands the static scratch arena to Opus, called on the first codec call.
+ * @param  size: Arena size requested by Opus, GLOBAL_STACK_SIZE.
+ * @retval Pointer to the arena.
+ */
+void *Opus_Scratch_Alloc(size_t size)
+{
+	__ASSERT_NO_MSG(size <= GLOBAL_STACK_SIZE);
+
+	memset(opus_scratch, OPUS_SCRATCH_FILL, sizeof(opus_scratch));
+	opus_scratch_ready = 1;
+
+	return opus_scratch;
+}
+#endif /* defined(NONTHREADSAFE_PSEUDOSTACK) */
+
+/**
+ * @brief  Peak use of the Opus scratch arena.
+ * @note   A lower bound: it ends at the highest byte that no longer holds the fill
+ *         pattern, so buffers allocated at the top but not written, or written with
+ *         the pattern, are not counted. Size the arena with a margin above it.
+ * @param  size: Returns the arena size, 0 if Opus allocates on the thread stack.
+ * @retval Number of bytes written since the last reset.
+ */
+uint32_t Opus_Scratch_GetUsage(uint32_t *size)
+{
+#if defined(NONTHREADSAFE_PSEUDOSTACK)
+	uint32_t used = GLOBAL_STACK_SIZE;
+
+	*size = GLOBAL_STACK_SIZE;
+	if (!opus_scratch_ready) {
+		return 0;
+	}
+
+	/* The arena grows upwards, the untouched fill is at the top */
+	while (used > 0 && opus_scratch[used - 1] == OPUS_SCRATCH_FILL) {
+		used--;
+	}
+
+	return used;
+#else
+	*size = 0;
+	return 0;
+#endif /* defined(NONTHREADSAFE_PSEUDOSTACK) */
+}
+
+/**
+ * @brief  Restarts the peak use measurement of the scratch arena.
+ * @note   No encoder or decoder call may be running.
+ * @retval None.
+ */
+void Opus_Scratch_ResetUsage(void)
+{
+#if defined(NONTHREADSAFE_PSEUDOSTACK)
+	if (opus_scratch_ready) {
+		memset(opus_scratch, OPUS_SCRATCH_FILL, GLOBAL_STACK_SIZE);
+	}
+#endif /* defined(NONTHREADSAFE_PSEUDOSTACK) */
 }
 
 /************************ (C) COPYRIGHT STMicroelectronics *****END OF FILE****/
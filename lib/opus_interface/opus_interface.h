@@ -14,7 +14,9 @@ extern "C" {
 
 /* Includes ------------------------------------------------------------------*/
 #include "opus.h"
+#include "opus_custom.h"
 #include "opus_defines.h"
+#include "opus_multistream.h"
 #include "opus_private.h"
 
 /* Exported types ------------------------------------------------------------*/
@@ -26,6 +28,15 @@ typedef enum {
 	OPUS_ERROR = 0x01    /*!< Error.*/
 } Opus_Status;
 
+/**
+ * @brief Opus encoder rate control.
+ */
+typedef enum {
+	OPUS_RATE_CBR = 0x00,  /*!< Constant bitrate, every packet has the same size.*/
+	OPUS_RATE_CVBR = 0x01, /*!< Constrained VBR, packet size varies around the bitrate.*/
+	OPUS_RATE_VBR = 0x02   /*!< Unconstrained VBR, bitrate follows the content.*/
+} Opus_RateControl;
+
 /* Private defines -----------------------------------------------------------*/
 #define SILK_MODE   0x00
 #define HYBRID_MODE 0x01
@@ -48,6 +59,26 @@ typedef struct {
 
 	uint8_t complexity; /*!< Specifies the choosen encoding complexity. */
 
+	uint8_t rate_control; /*!< @ref Opus_RateControl, CBR if 0. */
+
+	uint32_t peak_bitrate; /*!< Packet size cap for VBR and CVBR, 0 for the largest packet. */
+
+	int32_t bandwidth; /*!< Coded bandwidth (OPUS_BANDWIDTH_*), 0 lets the encoder choose. */
+
+	int32_t signal; /*!< Signal type hint (OPUS_SIGNAL_*), 0 lets the encoder choose. */
+
+	uint8_t lsb_depth; /*!< Significant bits of the input, 0 for the sample width. */
+
+	uint8_t packet_loss_perc; /*!< Expected packet loss in percent. */
+
+	uint8_t streams; /*!< Number of multistream streams, 0 for a single Opus stream. */
+
+	uint8_t coupled_streams; /*!< Number of streams coding two channels. */
+
+	uint8_t custom; /*!< Use the Opus Custom (CELT) API, needs CUSTOM_MODES. */
+
+	uint8_t res24; /*!< 24 bit samples in 32 bit words (opus_encode24), 16 bit if 0. */
+
 	uint8_t *pInternalMemory; /*!< Pointer to the internal memory */
 
 } ENC_Opus_ConfigTypeDef;
@@ -62,6 +93,14 @@ typedef struct {
 
 	uint8_t channels; /*!< Number of audio input channels */
 
+	uint8_t streams; /*!< Number of streams in a packet, 0 for a single Opus stream. */
+
+	uint8_t stream_id; /*!< Stream to decode when streams is not 0. */
+
+	uint8_t custom; /*!< Use the Opus Custom (CELT) API, needs CUSTOM_MODES. */
+
+	uint8_t res24; /*!< 24 bit samples in 32 bit words (opus_decode24), 16 bit if 0. */
+
 	uint8_t *pInternalMemory; /*!< Pointer to the internal memory */
 
 } DEC_Opus_ConfigTypeDef;
@@ -81,11 +120,15 @@ uint8_t DEC_Opus_IsConfigured(void);
 Opus_Status ENC_Opus_Set_Bitrate(int bitrate, int *opus_err);
 Opus_Status ENC_Opus_Set_CBR(void);
 Opus_Status ENC_Opus_Set_VBR(void);
+Opus_Status ENC_Opus_Set_CVBR(void);
 Opus_Status ENC_Opus_Set_Complexity(int complexity, int *opus_err);
+Opus_Status ENC_Opus_Get_Lookahead(int *lookahead, int *opus_err);
 Opus_Status ENC_Opus_Force_SILKmode(void);
 Opus_Status ENC_Opus_Force_CELTmode(void);
 int ENC_Opus_Encode(uint8_t *buf_in, uint8_t *buf_out);
 int DEC_Opus_Decode(uint8_t *buf_in, uint32_t len, uint8_t *buf_out);
+uint32_t Opus_Scratch_GetUsage(uint32_t *size);
+void Opus_Scratch_ResetUsage(void);
 
 #ifdef __cplusplus
 }
@@ -0,0 +1,102 @@
+/*
+ * Copyright (c) 2025 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+/* SILK entry points for the CELT-only build (CONFIG_OPUS_CELT_ONLY).
+ * ENC_Opus_Init() forces CELT, so the encoder never calls into SILK and the
+ * SILK states take no memory. A SILK or hybrid packet received by the decoder
+ * fails with OPUS_INTERNAL_ERROR.
+ */
+
+/* Includes ------------------------------------------------------------------*/
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+#include <zephyr/kernel.h>
+#include "API.h"
+#include "errors.h"
+
+/* Functions Definition ------------------------------------------------------*/
+opus_int silk_Get_Encoder_Size(opus_int *encSizeBytes, opus_int channels)
+{
+	ARG_UNUSED(channels);
+
+	*encSizeBytes = 0;
+
+	return SILK_NO_ERROR;
+}
+
+opus_int silk_InitEncoder(void *encState, int channels, int arch,
+			  silk_EncControlStruct *encStatus)
+{
+	ARG_UNUSED(encState);
+	ARG_UNUSED(channels);
+	ARG_UNUSED(arch);
+	ARG_UNUSED(encStatus);
+
+	return SILK_NO_ERROR;
+}
+
+opus_int silk_Encode(void *encState, silk_EncControlStruct *encControl, const opus_res *samplesIn,
+		     opus_int nSamplesIn, ec_enc *psRangeEnc, opus_int32 *nBytesOut,
+		     const opus_int prefillFlag, int activity)
+{
+	ARG_UNUSED(encState);
+	ARG_UNUSED(encControl);
+	ARG_UNUSED(samplesIn);
+	ARG_UNUSED(nSamplesIn);
+	ARG_UNUSED(psRangeEnc);
+	ARG_UNUSED(prefillFlag);
+	ARG_UNUSED(activity);
+
+	*nBytesOut = 0;
+
+	return SILK_ENC_INTERNAL_ERROR;
+}
+
+opus_int silk_Get_Decoder_Size(opus_int *decSizeBytes)
+{
+	*decSizeBytes = 0;
+
+	return SILK_NO_ERROR;
+}
+
+opus_int silk_ResetDecoder(void *decState)
+{
+	ARG_UNUSED(decState);
+
+	return SILK_NO_ERROR;
+}
+
+opus_int silk_InitDecoder(void *decState)
+{
+	ARG_UNUSED(decState);
+
+	return SILK_NO_ERROR;
+}
+
+opus_int silk_Decode(void *decState, silk_DecControlStruct *decControl, opus_int lostFlag,
+		     opus_int newPacketFlag, ec_dec *psRangeDec, opus_res *samplesOut,
+		     opus_int32 *nSamplesOut,
+#ifdef ENABLE_DEEP_PLC
+		     LPCNetPLCState *lpcnet,
+#endif
+		     int arch)
+{
+	ARG_UNUSED(decState);
+	ARG_UNUSED(decControl);
+	ARG_UNUSED(lostFlag);
+	ARG_UNUSED(newPacketFlag);
+	ARG_UNUSED(psRangeDec);
+	ARG_UNUSED(samplesOut);
+#ifdef ENABLE_DEEP_PLC
+	ARG_UNUSED(lpcnet);
+#endif
+	ARG_UNUSED(arch);
+
+	*nSamplesOut = 0;
+
+	return SILK_DEC_PAYLOAD_ERROR;
+}
@@ -0,0 +1,110 @@
+#!/usr/bin/env python3
+#
+# Copyright (c) 2025 Nordic Semiconductor ASA
+#
+# SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+#
+
+"""Report flash and RAM used by the Opus library in one or two builds.
+
+Reads zephyr/zephyr.map of each build directory and sums the input sections
+of the object files that come from lib/opus and lib/opus_interface, grouped
+by Opus component. With two build directories, the second column shows the
+difference to the first one, e.g. a full and a CELT-only build:
+
+    python3 scripts/opus_size_report.py build_opus_gateway build_opus_gateway_celt
+"""
+
+import argparse
+import os
+import re
+import sys
+
+LIB_DIR = os.path.join(os.path.dirname(os.path.abspath(__file__)), '..', 'lib')
+
+GROUPS = {
+    'opus': os.path.join('opus', 'src'),
+    'celt': os.path.join('opus', 'celt'),
+    'silk': os.path.join('opus', 'silk'),
+    'interface': 'opus_interface',
+}
+
+# Input section line, the section name is on the line before when it is long
+SECTION_RE = re.compile(r'^\s(\.\S+)?\s+0x([0-9a-f]+)\s+0x([0-9a-f]+)\s+\S*\((\S+)\.obj\)$')
+NAME_RE = re.compile(r'^\s(\.\S+)$')
+
+
+def source_groups():
+    """Map source file names to their Opus component."""
+    groups = {}
+    for group, rel in GROUPS.items():
+        for root, _, files in os.walk(os.path.join(LIB_DIR, rel)):
+            for f in files:
+                if f.endswith('.c'):
+                    groups[f] = group
+    return groups
+
+
+def section_kind(name):
+    if name.startswith(('.text', '.rodata')):
+        return 'flash'
+    if name.startswith('.data'):
+        return 'data'
+    if name.startswith(('.bss', '.noinit', 'COMMON')):
+        return 'bss'
+    return None
+
+
+def map_sizes(build_dir, groups):
+    sizes = {g: {'flash': 0, 'data': 0, 'bss': 0} for g in GROUPS}
+    name = None
+
+    with open(os.path.join(build_dir, 'zephyr', 'zephyr.map'), encoding='utf-8') as f:
+        for line in f:
+            m = NAME_RE.match(line)
+            if m:
+                name = m.group(1)
+                continue
+
+            m = SECTION_RE.match(line)
+            if m:
+                sec = m.group(1) or name
+                size = int(m.group(3), 16)
+                group = groups.get(m.group(4))
+                kind = section_kind(sec or '')
+                if group and kind and size:
+                    sizes[group][kind] += size
+            name = None
+
+    return sizes
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__,
+                                     formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument('build_dir', nargs='+', help='Build directory, one or two')
+    args = parser.parse_args()
+
+    if len(args.build_dir) > 2:
+        parser.error('At most two build directories')
+
+    groups = source_groups()
+    builds = [map_sizes(d, groups) for d in args.build_dir]
+
+    print(f"{'component':<10} {'kind':<6}" + ''.join(f' {os.path.basename(os.path.normpath(d)):>24}'
+                                                      for d in args.build_dir) +
+          (f" {'diff':>8}" if len(builds) == 2 else ''))
+    for kind in ('flash', 'data', 'bss'):
+        for group in list(GROUPS) + ['total']:
+            vals = [sum(b[g][kind] for g in GROUPS) if group == 'total' else b[group][kind]
+                    for b in builds]
+            row = f'{group:<10} {kind:<6}' + ''.join(f' {v:>24}' for v in vals)
+            if len(vals) == 2:
+                row += f' {vals[1] - vals[0]:>+8}'
+            print(row)
+
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
@@ -0,0 +1,96 @@
+/*
+ * Copyright (c) 2025 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#include "asrc.h"
+
+#include <zephyr/sys/util.h>
+
+#if (CONFIG_AUDIO_BIT_DEPTH_32)
+/* Largest float below 2^31, so the conversion back cannot overflow */
+#define SAMPLE_MAX 2147483520.0f
+#else
+#define SAMPLE_MAX 32767.0f
+#endif
+
+#define Q32_ONE	 ((int64_t)1 << 32)
+#define Q32_SCALE (1.0f / 4294967296.0f)
+
+void asrc_init(struct asrc *asrc)
+{
+	*asrc = (struct asrc){0};
+	/* Interpolate between the second and third history sample first */
+	asrc->pos = 1;
+}
+
+void asrc_ratio_set(struct asrc *asrc, int32_t corr_mppm)
+{
+	/* Step through the input 1 + corr samples per output sample */
+	asrc->step_adj = (int32_t)(((int64_t)corr_mppm * Q32_ONE) / 1000000000);
+}
+
+/**
+ * @brief Input sample k of the history followed by the new input.
+ */
+static inline float asrc_sample_get(const struct asrc *asrc, const asrc_sample_t *in, bool mono,
+				    uint8_t ch, uint32_t k)
+{
+	if (k < ARRAY_SIZE(asrc->hist[0])) {
+		return asrc->hist[ch][k];
+	}
+
+	k -= ARRAY_SIZE(asrc->hist[0]);
+
+	return mono ? in[k] : in[k * ASRC_CH_NUM + ch];
+}
+
+size_t asrc_process(struct asrc *asrc, const asrc_sample_t *in, size_t in_frames, bool mono,
+		    asrc_sample_t *out, size_t out_max_frames)
+{
+	uint64_t pos = ((uint64_t)asrc->pos << 32) | asrc->frac;
+	uint64_t step = Q32_ONE + asrc->step_adj;
+	size_t out_frames = 0;
+
+	/* Each output needs one input before and two after its position */
+	while ((pos >> 32) <= in_frames && out_frames < out_max_frames) {
+		uint32_t n = pos >> 32;
+		float mu = (uint32_t)pos * Q32_SCALE;
+
+		for (uint8_t ch = 0; ch < ASRC_CH_NUM; ch++) {
+			float xm1 = asrc_sample_get(asrc, in, mono, ch, n - 1);
+			float x0 = asrc_sample_get(asrc, in, mono, ch, n);
+			float x1 = asrc_sample_get(asrc, in, mono, ch, n + 1);
+			float x2 = asrc_sample_get(asrc, in, mono, ch, n + 2);
+
+			/* Farrow coefficients of the third order Lagrange interpolator */
+			float c1 = x1 - xm1 / 3.0f - x0 / 2.0f - x2 / 6.0f;
+			float c2 = (xm1 + x1) / 2.0f - x0;
+			float c3 = (x2 - xm1) / 6.0f + (x0 - x1) / 2.0f;
+			float y = ((c3 * mu + c2) * mu + c1) * mu + x0;
+
+			y = CLAMP(y, -SAMPLE_MAX, SAMPLE_MAX);
+			out[out_frames * ASRC_CH_NUM + ch] =
+				(asrc_sample_t)((y >= 0.0f) ? (y + 0.5f) : (y - 0.5f));
+		}
+
+		out_frames++;
+		pos += step;
+	}
+
+	/* Keep the last three inputs and carry the position over */
+	for (uint8_t ch = 0; ch < ASRC_CH_NUM; ch++) {
+		for (uint32_t k = 0; k < ARRAY_SIZE(asrc->hist[0]); k++) {
+			uint32_t i = in_frames - ARRAY_SIZE(asrc->hist[0]) + k;
+
+			asrc->hist[ch][k] = mono ? in[i] : in[i * ASRC_CH_NUM + ch];
+		}
+	}
+
+	pos -= (uint64_t)in_frames << 32;
+	asrc->pos = pos >> 32;
+	asrc->frac = (uint32_t)pos;
+
+	return out_frames;
+}
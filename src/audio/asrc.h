@@ -0,0 +1,72 @@
+/*
+ * Copyright (c) 2025 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#ifndef _ASRC_H_
+#define _ASRC_H_
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+/* Output is always interleaved stereo */
+#define ASRC_CH_NUM 2
+
+#if (CONFIG_AUDIO_BIT_DEPTH_32)
+typedef int32_t asrc_sample_t;
+#else
+typedef int16_t asrc_sample_t;
+#endif
+
+/**
+ * @brief Fractional ratio sample rate converter, for clock drift.
+ *
+ * @note  Third order Lagrange interpolation in Farrow form, so the ratio can
+ *	  change between any two calls without switching filters.
+ */
+struct asrc {
+	asrc_sample_t hist[ASRC_CH_NUM][3]; /* Last three input samples */
+	uint32_t frac;			    /* Position between two inputs, Q32 */
+	uint32_t pos;			    /* Input the next output is taken after */
+	int32_t step_adj;		    /* Input step minus one, Q32 */
+};
+
+/**
+ * @brief	Reset the converter to a 1:1 ratio.
+ *
+ * @param[out]	asrc	Converter state.
+ */
+void asrc_init(struct asrc *asrc);
+
+/**
+ * @brief	Set the conversion ratio.
+ *
+ * @note	Safe to call from an ISR while asrc_process() runs in a thread.
+ *
+ * @param[in,out]	asrc		Converter state.
+ * @param[in]		corr_mppm	Output clock error in 1/1000 ppm. Positive
+ *					when the output runs slow, so fewer
+ *					samples are produced per input sample.
+ */
+void asrc_ratio_set(struct asrc *asrc, int32_t corr_mppm);
+
+/**
+ * @brief	Convert a block of samples.
+ *
+ * @note	Delays the signal by about one and a half input samples.
+ *
+ * @param[in,out]	asrc		Converter state.
+ * @param[in]		in		Input samples, interleaved if stereo.
+ * @param[in]		in_frames	Number of input samples per channel, at least 3.
+ * @param[in]		mono		Input is mono and is written to both channels.
+ * @param[out]		out		Interleaved stereo output.
+ * @param[in]		out_max_frames	Room in out, in samples per channel.
+ *
+ * @return	Number of output samples per channel.
+ */
+size_t asrc_process(struct asrc *asrc, const asrc_sample_t *in, size_t in_frames, bool mono,
+		    asrc_sample_t *out, size_t out_max_frames);
+
+#endif /* _ASRC_H_ */
@@ -9,6 +9,7 @@
 #include <stdlib.h>
 #include <stdio.h>
 #include <ctype.h>
+#include <math.h>
 #include <zephyr/zbus/zbus.h>
 #include <zephyr/kernel.h>
 #include <zephyr/shell/shell.h>
@@ -25,16 +26,13 @@
 #include "audio_system.h"
 #include "streamctrl.h"
 #include "sd_card_playback.h"
+#include "clock_recovery.h"
+#include "asrc.h"
+#include "blk_ring.h"
 
 #include <zephyr/logging/log.h>
 LOG_MODULE_REGISTER(audio_datapath, CONFIG_AUDIO_DATAPATH_LOG_LEVEL);
 
-#if (CONFIG_SW_CODEC_OPUS)
-#include "opus_interface.h"
-extern DEC_Opus_ConfigTypeDef DecConfigOpus; /*!< opus encode configuration.*/
-int numDec = 0;                              /*Number of decoded samples or @ref opus_errorcodes.*/
-#endif
-
 /*
  * Terminology
  *   - sample: signed integer of audio waveform amplitude
@@ -45,12 +43,23 @@ int numDec = 0;                              /*Number of decoded samples or @ref
 
 #define SDU_REF_DELTA_MAX_ERR_US (int)(CONFIG_AUDIO_FRAME_DURATION_US * 0.001)
 
-#define BLK_PERIOD_US 1000
+/* One frame is split into CONFIG_FIFO_FRAME_SPLIT_NUM blocks of CONFIG_AUDIO_BLOCK_PERIOD_US */
+#define BLK_PERIOD_US (CONFIG_AUDIO_FRAME_DURATION_US / CONFIG_FIFO_FRAME_SPLIT_NUM)
 
+/* Frames in the sample FIFO: target delay and jitter margin, plus the frame being written */
+#define FIFO_NUM_FRAMES                                                                            \
+	(DIV_ROUND_UP(CONFIG_AUDIO_PRES_DLY_US + CONFIG_AUDIO_OUT_FIFO_JITTER_US,                  \
+		      CONFIG_AUDIO_FRAME_DURATION_US) +                                            \
+	 1)
 /* Total sample FIFO period in microseconds */
-#define FIFO_SMPL_PERIOD_US (CONFIG_AUDIO_MAX_PRES_DLY_US * 2) // 60000*2us=120ms
-#define FIFO_NUM_BLKS       NUM_BLKS(FIFO_SMPL_PERIOD_US)      // 120ms/1s=120 blocks
+#define FIFO_SMPL_PERIOD_US (FIFO_NUM_FRAMES * CONFIG_AUDIO_FRAME_DURATION_US) // 5*10ms=50ms
+#define FIFO_NUM_BLKS       NUM_BLKS(FIFO_SMPL_PERIOD_US)                      // 50ms/1ms=50 blocks
 #define MAX_FIFO_SIZE       (FIFO_NUM_BLKS * BLK_SIZE_SAMPLES(CONFIG_AUDIO_SAMPLE_RATE_HZ) * 2)
+/* Longest presentation delay that leaves room for an incoming frame */
+#define FIFO_PRES_DLY_MAX_US                                                                       \
+	MIN(FIFO_SMPL_PERIOD_US - CONFIG_AUDIO_FRAME_DURATION_US -                                 \
+		    (IS_ENABLED(CONFIG_AUDIO_ASRC) ? 2 : 1) * BLK_PERIOD_US,                       \
+	    CONFIG_AUDIO_MAX_PRES_DLY_US)
 
 /* Number of audio blocks given a duration */
 #define NUM_BLKS(d) ((d) / BLK_PERIOD_US)
@@ -60,10 +69,14 @@ int numDec = 0;                              /*Number of decoded samples or @ref
 /* clang-format on */
 /* Increment sample FIFO index by one block */
 #define NEXT_IDX(i) (((i) < (FIFO_NUM_BLKS - 1)) ? ((i) + 1) : 0)
-/* Decrement sample FIFO index by one block */
-#define PREV_IDX(i) (((i) > 0) ? ((i)-1) : (FIFO_NUM_BLKS - 1))
 
 #define NUM_BLKS_IN_FRAME      NUM_BLKS(CONFIG_AUDIO_FRAME_DURATION_US)
+BUILD_ASSERT((CONFIG_AUDIO_FRAME_DURATION_US % CONFIG_FIFO_FRAME_SPLIT_NUM) == 0,
+	     "Frame duration must be a whole number of microseconds per block");
+BUILD_ASSERT((CONFIG_AUDIO_SAMPLE_RATE_HZ / 100 * BLK_PERIOD_US) % 10000 == 0,
+	     "Block period must hold a whole number of samples");
+BUILD_ASSERT(BLK_PERIOD_US == CONFIG_AUDIO_BLOCK_PERIOD_US,
+	     "FIFO_FRAME_SPLIT_NUM must split a frame into AUDIO_BLOCK_PERIOD_US blocks");
 #define BLK_MONO_NUM_SAMPS     BLK_SIZE_SAMPLES(CONFIG_AUDIO_SAMPLE_RATE_HZ)
 #define BLK_STEREO_NUM_SAMPS   (BLK_MONO_NUM_SAMPS * 2)
 /* Number of octets in a single audio block */
@@ -73,6 +86,8 @@ int numDec = 0;                              /*Number of decoded samples or @ref
 #define DRIFT_COMP_WAITING_CNT (DRIFT_MEAS_PERIOD_US / BLK_PERIOD_US)
 /* How much data to be collected before moving on with presentation compensation */
 #define PRES_COMP_NUM_DATA_PTS (DRIFT_MEAS_PERIOD_US / CONFIG_AUDIO_FRAME_DURATION_US)
+/* Error that moves blocks again once presentation compensation is locked */
+#define PRES_COMP_UNLOCK_US    (2 * BLK_PERIOD_US)
 
 /* Audio clock - nRF5340 Analog Phase-Locked Loop (APLL) */
 #define APLL_FREQ_CENTER 39854
@@ -81,6 +96,8 @@ int numDec = 0;                              /*Number of decoded samples or @ref
 /* Use nanoseconds to reduce rounding errors */
 /* clang-format off */
 #define APLL_FREQ_ADJ(t) (-((t)*1000) / 331)
+/* Convert a clock correction in 1/1000 ppm to APLL frequency units */
+#define APLL_FREQ_ADJ_MPPM(c) ((c) / 3310)
 /* clang-format on */
 
 #define DRIFT_MEAS_PERIOD_US       100000
@@ -95,6 +112,10 @@ int numDec = 0;                              /*Number of decoded samples or @ref
 
 /* How often to print under-run warning */
 #define UNDERRUN_LOG_INTERVAL_BLKS 5000
+/* Blocks of the last good block repeated, fading out, when the out FIFO runs dry */
+#define UNDERRUN_CONCEAL_BLKS	   DIV_ROUND_UP(CONFIG_AUDIO_UNDERRUN_CONCEAL_US, BLK_PERIOD_US)
+/* Unity gain of the under-run fades */
+#define FADE_GAIN_ONE		   (1 << 15)
 
 enum drift_comp_state {
 	DRIFT_STATE_INIT,   /* Waiting for data to be received */
@@ -131,6 +152,10 @@ static struct {
 
 	struct {
 		struct data_fifo *fifo;
+		/* A FIFO block holds a whole frame, handed to I2S one block at a time */
+		uint8_t *frame;
+		uint8_t blks_out;      /* Blocks of frame handed to I2S */
+		uint8_t blks_released; /* Blocks of the oldest frame filled by I2S */
 	} in;
 
 	struct {
@@ -139,11 +164,26 @@ static struct {
 #elif CONFIG_AUDIO_BIT_DEPTH_32
 		int32_t __aligned(sizeof(uint32_t)) fifo[MAX_FIFO_SIZE];
 #endif
-		uint16_t prod_blk_idx; /* Output producer audio block index */
-		uint16_t cons_blk_idx; /* Output consumer audio block index */
+		/* Producer is the datapath thread, consumer the I2S ISR */
+		struct blk_ring ring;
 		uint32_t prod_blk_ts[FIFO_NUM_BLKS];
+		/* Most blocks queued since the last read of the high water mark */
+		uint16_t max_blks_in_fifo;
+		/* Sender is silent, an empty FIFO is not an under-run */
+		bool dtx;
+		/* Blocks played since the FIFO ran dry, 0 while there is data */
+		uint16_t empty_blks;
 		/* Statistics */
 		uint32_t total_blk_underruns;
+		uint32_t total_blks;
+		uint32_t total_dtx_blks;
+		uint32_t total_underruns;      /* FIFO ran dry while streaming */
+		uint32_t total_conceal_blks;   /* Blocks repeated while fading out */
+		uint32_t total_silent_blks;    /* Blocks of silence after the fade out */
+		uint32_t total_fade_ins;       /* Returns of data after an empty FIFO */
+		/* Decoded bytes written in place vs copied into the FIFO */
+		uint64_t total_direct_bytes;
+		uint64_t total_copied_bytes;
 	} out;
 
 	uint32_t prev_drift_sdu_ref_us;
@@ -158,15 +198,56 @@ static struct {
 		bool enabled;
 	} drift_comp;
 
+	struct {
+		struct clock_recovery loop;
+		uint32_t fill_sum_us; /* Out FIFO fill level summed over the window */
+		uint16_t ctr;	      /* Count func calls. Used for averaging the fill level */
+		bool restart;	      /* Fill level jumped in the window, learn a new target */
+	} clk_rec;
+
+	/* Time spent in the I2S block complete callback */
+	struct {
+		uint32_t cnt;
+		uint32_t cyc_max;
+		uint64_t cyc_total;
+		int64_t start_ms;
+	} isr;
+
 	struct {
 		enum pres_comp_state state: 8;
 		uint16_t ctr; /* Count func calls. Used for collecting data points and waiting */
 		int32_t sum_err_dly_us;
 		uint32_t pres_delay_us;
 		bool enabled;
+		/* Achieved presentation delay since the last adjustment */
+		struct {
+			uint32_t cnt;
+			uint32_t min_us;
+			uint32_t max_us;
+			uint64_t sum_us;
+			uint64_t sum_sq_us;
+		} stats;
 	} pres_comp;
 } ctrl_blk;
 
+#if (CONFIG_AUDIO_ASRC)
+BUILD_ASSERT(sizeof(asrc_sample_t) == sizeof(ctrl_blk.out.fifo[0]), "ASRC sample size mismatch");
+
+static struct asrc asrc;
+/* Resampled frame, after what was left of a block from the previous frame */
+static asrc_sample_t asrc_buf[(NUM_BLKS_IN_FRAME + 2) * BLK_STEREO_NUM_SAMPS];
+static size_t asrc_buf_frames;
+#endif /* (CONFIG_AUDIO_ASRC) */
+
+/**
+ * @brief	Record the out FIFO high water mark, called after producing blocks.
+ */
+static void out_fifo_max_blks_update(void)
+{
+	ctrl_blk.out.max_blks_in_fifo =
+		MAX(ctrl_blk.out.max_blks_in_fifo, blk_ring_fill(&ctrl_blk.out.ring));
+}
+
 static bool tone_active;
 /* Buffer which can hold max 1 period test tone at 100 Hz */
 static uint16_t test_tone_buf[CONFIG_AUDIO_SAMPLE_RATE_HZ / 100];
@@ -219,6 +300,13 @@ static void hfclkaudio_set(uint16_t freq_value)
 	nrfx_clock_hfclkaudio_config_set(freq_val);
 }
 
+static const char *const clk_rec_state_names[] = {
+	"INIT",
+	"CALIB",
+	"TRACK",
+	"LOCKED",
+};
+
 static void drift_comp_state_set(enum drift_comp_state new_state)
 {
 	if (new_state == ctrl_blk.drift_comp.state) {
@@ -230,6 +318,51 @@ static void drift_comp_state_set(enum drift_comp_state new_state)
 	LOG_INF("Drft comp state: %s", drift_comp_state_names[new_state]);
 }
 
+/**
+ * @brief	Adjust frequency of HFCLKAUDIO to follow the gateway clock.
+ *
+ * @note	Over Wi-Fi there is no SDU reference. The out FIFO is filled at the
+ *		gateway rate and drained at the HFCLKAUDIO rate, so its fill level,
+ *		averaged over DRIFT_MEAS_PERIOD_US, is the error of a PI loop.
+ */
+static void audio_datapath_clock_recovery(void)
+{
+	uint16_t num_blks_in_fifo = blk_ring_fill(&ctrl_blk.out.ring);
+	enum clock_recovery_state prev_state = ctrl_blk.clk_rec.loop.state;
+	int32_t corr_mppm;
+
+	ctrl_blk.clk_rec.fill_sum_us += num_blks_in_fifo * BLK_PERIOD_US;
+
+	if (++ctrl_blk.clk_rec.ctr < DRIFT_COMP_WAITING_CNT) {
+		return;
+	}
+
+	uint32_t fill_us = ctrl_blk.clk_rec.fill_sum_us / DRIFT_COMP_WAITING_CNT;
+
+	ctrl_blk.clk_rec.ctr = 0;
+	ctrl_blk.clk_rec.fill_sum_us = 0;
+
+	if (ctrl_blk.clk_rec.restart) {
+		/* Silence, under-run or overrun, the fill level says nothing about drift */
+		ctrl_blk.clk_rec.restart = false;
+		clock_recovery_restart(&ctrl_blk.clk_rec.loop);
+		return;
+	}
+
+	corr_mppm = clock_recovery_update(&ctrl_blk.clk_rec.loop, fill_us);
+#if (CONFIG_AUDIO_ASRC)
+	/* The I2S clock is not ours to steer, resample instead */
+	asrc_ratio_set(&asrc, corr_mppm);
+#else
+	hfclkaudio_set(APLL_FREQ_CENTER + APLL_FREQ_ADJ_MPPM(corr_mppm));
+#endif /* (CONFIG_AUDIO_ASRC) */
+
+	if (ctrl_blk.clk_rec.loop.state != prev_state) {
+		LOG_INF("Clock recovery state: %s",
+			clk_rec_state_names[ctrl_blk.clk_rec.loop.state]);
+	}
+}
+
 /**
  * @brief	Adjust frequency of HFCLKAUDIO to get audio in sync.
  *
@@ -240,11 +373,11 @@ static void drift_comp_state_set(enum drift_comp_state new_state)
 static void audio_datapath_drift_compensation(uint32_t frame_start_ts_us)
 {
 	if (IS_ENABLED(CONFIG_AUDIO_HEADSET)) {
-		/** For headsets we do not use the timestamp gotten from hci_tx_sync_get to adjust
-		 * for drift
-		 */
-		ctrl_blk.prev_drift_sdu_ref_us = ctrl_blk.prev_pres_sdu_ref_us;
+		/* Headsets get no SDU reference, recover the clock from the out FIFO */
+		audio_datapath_clock_recovery();
+		return;
 	}
+
 	switch (ctrl_blk.drift_comp.state) {
 	case DRIFT_STATE_INIT: {
 		/* Check if audio data has been received */
@@ -353,137 +486,154 @@ static void pres_comp_state_set(enum pres_comp_state new_state)
 	ERR_CHK(ret);
 }
 
+/**
+ * @brief	Collect the achieved presentation delay while locked.
+ */
+static void pres_comp_stats_add(uint32_t pres_dly_us)
+{
+	if (ctrl_blk.pres_comp.stats.cnt == 0) {
+		ctrl_blk.pres_comp.stats.min_us = pres_dly_us;
+		ctrl_blk.pres_comp.stats.max_us = pres_dly_us;
+	}
+
+	ctrl_blk.pres_comp.stats.cnt++;
+	ctrl_blk.pres_comp.stats.sum_us += pres_dly_us;
+	ctrl_blk.pres_comp.stats.sum_sq_us += (uint64_t)pres_dly_us * pres_dly_us;
+	ctrl_blk.pres_comp.stats.min_us = MIN(ctrl_blk.pres_comp.stats.min_us, pres_dly_us);
+	ctrl_blk.pres_comp.stats.max_us = MAX(ctrl_blk.pres_comp.stats.max_us, pres_dly_us);
+}
+
 /**
  * @brief	Move audio blocks back and forth in FIFO to get audio in sync.
  *
- * @note	The audio sync is based on sdu_ref_us.
+ * @note	Over Wi-Fi there is no SDU reference, the presentation delay runs from
+ *		the reception of a frame to the start of its first block on I2S.
  *
  * @param	recv_frame_ts_us	Timestamp of when frame was received.
- * @param	sdu_ref_us		ISO timestamp reference from Bluetooth LE controller.
- * @param	sdu_ref_not_consecutive	True if sdu_ref_us and the previous sdu_ref_us
- *					originate from non-consecutive frames.
  */
-// static void audio_datapath_presentation_compensation(uint32_t recv_frame_ts_us, uint32_t
-// sdu_ref_us, 						     bool sdu_ref_not_consecutive)
-// {
-// 	if (ctrl_blk.drift_comp.state != DRIFT_STATE_LOCKED) {
-// 		/* Unconditionally reset state machine if drift compensation looses lock */
-// 		pres_comp_state_set(PRES_STATE_INIT);
-// 		return;
-// 	}
-
-// 	/* Move presentation compensation into PRES_STATE_WAIT if sdu_ref_us and
-// 	 * the previous sdu_ref_us originate from non-consecutive frames.
-// 	 */
-// 	if (sdu_ref_not_consecutive) {
-// 		ctrl_blk.pres_comp.ctr = 0;
-// 		pres_comp_state_set(PRES_STATE_WAIT);
-// 	}
-
-// 	int32_t wanted_pres_dly_us =
-// 		ctrl_blk.pres_comp.pres_delay_us - (recv_frame_ts_us - sdu_ref_us);
-// 	int32_t pres_adj_us = 0;
-
-// 	switch (ctrl_blk.pres_comp.state) {
-// 	case PRES_STATE_INIT: {
-// 		ctrl_blk.pres_comp.ctr = 0;
-// 		ctrl_blk.pres_comp.sum_err_dly_us = 0;
-// 		pres_comp_state_set(PRES_STATE_MEAS);
-
-// 		break;
-// 	}
-// 	case PRES_STATE_MEAS: {
-// 		if (ctrl_blk.pres_comp.ctr++ < PRES_COMP_NUM_DATA_PTS) {
-// 			ctrl_blk.pres_comp.sum_err_dly_us +=
-// 				wanted_pres_dly_us - ctrl_blk.current_pres_dly_us;
-
-// 			/* Same state - Collect more data */
-// 			break;
-// 		}
-
-// 		ctrl_blk.pres_comp.ctr = 0;
-
-// 		pres_adj_us = ctrl_blk.pres_comp.sum_err_dly_us / PRES_COMP_NUM_DATA_PTS;
-// 		if ((pres_adj_us >= (BLK_PERIOD_US / 2)) || (pres_adj_us <= -(BLK_PERIOD_US / 2))) {
-// 			pres_comp_state_set(PRES_STATE_WAIT);
-// 		} else {
-// 			/* Drift compensation will always be in DRIFT_STATE_LOCKED here */
-// 			pres_comp_state_set(PRES_STATE_LOCKED);
-// 		}
-
-// 		break;
-// 	}
-// 	case PRES_STATE_WAIT: {
-// 		if (ctrl_blk.pres_comp.ctr++ >
-// 		    (FIFO_SMPL_PERIOD_US / CONFIG_AUDIO_FRAME_DURATION_US)) {
-// 			pres_comp_state_set(PRES_STATE_INIT);
-// 		}
-
-// 		break;
-// 	}
-// 	case PRES_STATE_LOCKED: {
-// 		/*
-// 		 * Presentation delay compensation moves into PRES_STATE_WAIT if sdu_ref_us
-// 		 * and the previous sdu_ref_us originate from non-consecutive frames, or into
-// 		 * PRES_STATE_INIT if drift compensation unlocks.
-// 		 */
-
-// 		break;
-// 	}
-// 	default: {
-// 		break;
-// 	}
-// 	}
-
-// 	if (pres_adj_us == 0) {
-// 		return;
-// 	}
-
-// 	if (pres_adj_us >= 0) {
-// 		pres_adj_us += (BLK_PERIOD_US / 2);
-// 	} else {
-// 		pres_adj_us += -(BLK_PERIOD_US / 2);
-// 	}
-
-// 	/* Number of adjustment blocks is 0 as long as |pres_adj_us| < BLK_PERIOD_US */
-// 	int32_t pres_adj_blks = pres_adj_us / BLK_PERIOD_US;
-
-// 	if (pres_adj_blks > (FIFO_NUM_BLKS / 2)) {
-// 		/* Limit adjustment */
-// 		pres_adj_blks = FIFO_NUM_BLKS / 2;
-
-// 		LOG_WRN("Requested presentation delay out of range: pres_adj_us=%d", pres_adj_us);
-// 	} else if (pres_adj_blks < -(FIFO_NUM_BLKS / 2)) {
-// 		/* Limit adjustment */
-// 		pres_adj_blks = -(FIFO_NUM_BLKS / 2);
-
-// 		LOG_WRN("Requested presentation delay out of range: pres_adj_us=%d", pres_adj_us);
-// 	}
-
-// 	if (pres_adj_blks > 0) {
-// 		LOG_DBG("Presentation delay inserted: pres_adj_blks=%d", pres_adj_blks);
-
-// 		/* Increase presentation delay */
-// 		for (int i = 0; i < pres_adj_blks; i++) {
-// 			/* Mute audio block */
-// 			memset(&ctrl_blk.out.fifo[ctrl_blk.out.prod_blk_idx * BLK_STEREO_NUM_SAMPS],
-// 			       0, BLK_STEREO_SIZE_OCTETS);
-
-// 			/* Record producer block start reference */
-// 			ctrl_blk.out.prod_blk_ts[ctrl_blk.out.prod_blk_idx] =
-// 				recv_frame_ts_us - ((pres_adj_blks - i) * BLK_PERIOD_US);
-
-// 			ctrl_blk.out.prod_blk_idx = NEXT_IDX(ctrl_blk.out.prod_blk_idx);
-// 		}
-// 	} else if (pres_adj_blks < 0) {
-// 		LOG_DBG("Presentation delay removed: pres_adj_blks=%d", pres_adj_blks);
-
-// 		/* Reduce presentation delay */
-// 		for (int i = 0; i > pres_adj_blks; i--) {
-// 			ctrl_blk.out.prod_blk_idx = PREV_IDX(ctrl_blk.out.prod_blk_idx);
-// 		}
-// 	}
-// }
+static void audio_datapath_presentation_compensation(uint32_t recv_frame_ts_us)
+{
+	uint32_t pres_dly_us = ctrl_blk.current_pres_dly_us;
+	int32_t pres_adj_us = 0;
+
+	if (ctrl_blk.out.dtx || pres_dly_us == 0) {
+		/* Nothing from the stream is playing, there is no delay to measure */
+		return;
+	}
+
+	switch (ctrl_blk.pres_comp.state) {
+	case PRES_STATE_INIT: {
+		ctrl_blk.pres_comp.ctr = 0;
+		ctrl_blk.pres_comp.sum_err_dly_us = 0;
+		pres_comp_state_set(PRES_STATE_MEAS);
+
+		break;
+	}
+	case PRES_STATE_MEAS:
+	case PRES_STATE_LOCKED: {
+		if (ctrl_blk.pres_comp.state == PRES_STATE_LOCKED) {
+			pres_comp_stats_add(pres_dly_us);
+		}
+
+		ctrl_blk.pres_comp.sum_err_dly_us +=
+			(int32_t)ctrl_blk.pres_comp.pres_delay_us - (int32_t)pres_dly_us;
+
+		if (++ctrl_blk.pres_comp.ctr < PRES_COMP_NUM_DATA_PTS) {
+			/* Same state - Collect more data */
+			break;
+		}
+
+		int32_t err_us = ctrl_blk.pres_comp.sum_err_dly_us / PRES_COMP_NUM_DATA_PTS;
+		/* Once locked, only follow larger steps so Wi-Fi jitter does not move blocks */
+		int32_t thresh_us = (ctrl_blk.pres_comp.state == PRES_STATE_LOCKED)
+					    ? PRES_COMP_UNLOCK_US
+					    : (BLK_PERIOD_US / 2);
+
+		ctrl_blk.pres_comp.ctr = 0;
+		ctrl_blk.pres_comp.sum_err_dly_us = 0;
+
+		if ((err_us >= thresh_us) || (err_us <= -thresh_us)) {
+			pres_adj_us = err_us;
+			pres_comp_state_set(PRES_STATE_WAIT);
+		} else {
+			pres_comp_state_set(PRES_STATE_LOCKED);
+		}
+
+		break;
+	}
+	case PRES_STATE_WAIT: {
+		/* Let the adjusted blocks play out before measuring again */
+		if (ctrl_blk.pres_comp.ctr++ >
+		    (FIFO_SMPL_PERIOD_US / CONFIG_AUDIO_FRAME_DURATION_US)) {
+			pres_comp_state_set(PRES_STATE_INIT);
+		}
+
+		break;
+	}
+	default: {
+		break;
+	}
+	}
+
+	if (pres_adj_us == 0) {
+		return;
+	}
+
+	if (pres_adj_us >= 0) {
+		pres_adj_us += (BLK_PERIOD_US / 2);
+	} else {
+		pres_adj_us += -(BLK_PERIOD_US / 2);
+	}
+
+	/* Number of adjustment blocks is 0 as long as |pres_adj_us| < BLK_PERIOD_US */
+	int32_t pres_adj_blks = pres_adj_us / BLK_PERIOD_US;
+	int32_t num_blks_in_fifo = blk_ring_fill(&ctrl_blk.out.ring);
+	/* Room for the adjustment and the frame, without catching up with the consumer */
+	int32_t max_add_blks = (int32_t)blk_ring_space(&ctrl_blk.out.ring) - NUM_BLKS_IN_FRAME;
+	/* Keep the block on I2S and the next one handed to it */
+	int32_t max_drop_blks = MAX(num_blks_in_fifo - 2, 0);
+
+	if (pres_adj_blks > max_add_blks) {
+		/* Limit adjustment */
+		pres_adj_blks = MAX(max_add_blks, 0);
+
+		LOG_WRN("Requested presentation delay out of range: pres_adj_us=%d", pres_adj_us);
+	} else if (pres_adj_blks < -max_drop_blks) {
+		/* Limit adjustment */
+		pres_adj_blks = -max_drop_blks;
+
+		LOG_WRN("Requested presentation delay out of range: pres_adj_us=%d", pres_adj_us);
+	}
+
+	if (pres_adj_blks > 0) {
+		LOG_DBG("Presentation delay inserted: pres_adj_blks=%d", pres_adj_blks);
+
+		/* Increase presentation delay */
+		for (int i = 0; i < pres_adj_blks; i++) {
+			uint32_t out_blk_idx = blk_ring_prod_idx(&ctrl_blk.out.ring, i);
+
+			/* Mute audio block */
+			memset(&ctrl_blk.out.fifo[out_blk_idx * BLK_STEREO_NUM_SAMPS], 0,
+			       BLK_STEREO_SIZE_OCTETS);
+
+			/* Record producer block start reference */
+			ctrl_blk.out.prod_blk_ts[out_blk_idx] =
+				recv_frame_ts_us - ((pres_adj_blks - i) * BLK_PERIOD_US);
+		}
+
+		blk_ring_produce(&ctrl_blk.out.ring, pres_adj_blks);
+		out_fifo_max_blks_update();
+	} else if (pres_adj_blks < 0) {
+		LOG_DBG("Presentation delay removed: pres_adj_blks=%d", pres_adj_blks);
+
+		/* Reduce presentation delay, the ISR may have played a block meanwhile */
+		blk_ring_unproduce(&ctrl_blk.out.ring, -pres_adj_blks, 1);
+	}
+
+	/* The fill level moved on purpose, not because of drift */
+	ctrl_blk.clk_rec.restart = true;
+	memset(&ctrl_blk.pres_comp.stats, 0, sizeof(ctrl_blk.pres_comp.stats));
+}
 
 static void tone_stop_worker(struct k_work *work)
 {
@@ -608,39 +758,197 @@ static void alt_buffer_free_both(void)
 	alt.buf_1_in_use = false;
 }
 
+/**
+ * @brief	Copy a stereo block while ramping its gain linearly.
+ *
+ * @note	Used for the under-run fades, so the output never jumps between
+ *		audio and silence. in and out may be the same block.
+ *
+ * @param[out]	out		Faded block.
+ * @param[in]	in		Source block.
+ * @param[in]	reverse		Read the source from its end, so it continues the
+ *				source played forwards and vice versa.
+ * @param[in]	start_gain	Gain of the first sample, FADE_GAIN_ONE is unity.
+ * @param[in]	end_gain	Gain after the last sample.
+ */
+static void out_blk_fade(__typeof__(ctrl_blk.out.fifo[0]) *out,
+			 const __typeof__(ctrl_blk.out.fifo[0]) *in, bool reverse,
+			 int32_t start_gain, int32_t end_gain)
+{
+	int32_t gain = start_gain;
+	int32_t step = (end_gain - start_gain) / BLK_MONO_NUM_SAMPS;
+
+	for (uint32_t i = 0; i < BLK_MONO_NUM_SAMPS; i++) {
+		uint32_t src = reverse ? (BLK_MONO_NUM_SAMPS - 1 - i) : i;
+
+		out[2 * i] = ((int64_t)in[2 * src] * gain) >> 15;
+		out[2 * i + 1] = ((int64_t)in[2 * src + 1] * gain) >> 15;
+		gain += step;
+	}
+}
+
+/**
+ * @brief	Fill a block played while the out FIFO is empty.
+ *
+ * @note	The last good block, still at the consumer index, is played back and
+ *		forth with a fade out over UNDERRUN_CONCEAL_BLKS, then silence.
+ *
+ * @param[out]	tx_buf	Alternative buffer handed to I2S.
+ */
+static void out_blk_conceal(uint8_t *tx_buf)
+{
+	uint16_t blk = ctrl_blk.out.empty_blks;
+
+	if (blk >= UNDERRUN_CONCEAL_BLKS) {
+		memset(tx_buf, 0, BLK_STEREO_SIZE_OCTETS);
+		ctrl_blk.out.total_silent_blks++;
+		return;
+	}
+
+	/* Never 0 here, MAX() only keeps the compiler quiet when concealment is off */
+	int32_t num_blks = MAX(UNDERRUN_CONCEAL_BLKS, 1);
+	int32_t start_gain = FADE_GAIN_ONE * (num_blks - blk) / num_blks;
+	int32_t end_gain = FADE_GAIN_ONE * (num_blks - blk - 1) / num_blks;
+
+	uint32_t last_blk_idx = blk_ring_cons_idx(&ctrl_blk.out.ring);
+
+	/* The first repeat runs backwards from where the last good block ended */
+	out_blk_fade((void *)tx_buf, &ctrl_blk.out.fifo[last_blk_idx * BLK_STEREO_NUM_SAMPS],
+		     (blk % 2) == 0, start_gain, end_gain);
+	ctrl_blk.out.total_conceal_blks++;
+}
+
+/**
+ * @brief	Crossfade from the concealment to the first block after an under-run.
+ *
+ * @note	The concealment carries on where it stopped, at the gain it had
+ *		reached, and fades out over the block while the new block fades in,
+ *		so data that returns during the concealment does not restart from
+ *		silence. Once the concealment has faded out, the block only fades in.
+ *
+ * @param[in,out]	blk		First new block, faded in place.
+ * @param[in]		last_blk	Last good block, the ring does not write it yet.
+ */
+static void out_blk_resume(__typeof__(ctrl_blk.out.fifo[0]) *blk,
+			   const __typeof__(ctrl_blk.out.fifo[0]) *last_blk)
+{
+	uint16_t empty = ctrl_blk.out.empty_blks;
+
+	if (empty >= UNDERRUN_CONCEAL_BLKS) {
+		out_blk_fade(blk, blk, false, 0, FADE_GAIN_ONE);
+		return;
+	}
+
+	/* Never 0 here, MAX() only keeps the compiler quiet when concealment is off */
+	int32_t num_blks = MAX(UNDERRUN_CONCEAL_BLKS, 1);
+	/* Gain the next concealed block would have started with */
+	int32_t conceal_gain = FADE_GAIN_ONE * (num_blks - empty) / num_blks;
+	int32_t conceal_step = conceal_gain / BLK_MONO_NUM_SAMPS;
+	int32_t gain = 0;
+	int32_t step = FADE_GAIN_ONE / BLK_MONO_NUM_SAMPS;
+	/* Same direction as the next concealed block, see out_blk_conceal() */
+	bool reverse = (empty % 2) == 0;
+
+	for (uint32_t i = 0; i < BLK_MONO_NUM_SAMPS; i++) {
+		uint32_t src = reverse ? (BLK_MONO_NUM_SAMPS - 1 - i) : i;
+
+		/* The gains add up to at most unity, so the sum cannot overflow */
+		blk[2 * i] = ((int64_t)blk[2 * i] * gain +
+			      (int64_t)last_blk[2 * src] * conceal_gain) >> 15;
+		blk[2 * i + 1] = ((int64_t)blk[2 * i + 1] * gain +
+				  (int64_t)last_blk[2 * src + 1] * conceal_gain) >> 15;
+		gain += step;
+		conceal_gain -= conceal_step;
+	}
+}
+
+/**
+ * @brief	Get the next I2S RX buffer, the next block of the frame being filled.
+ *
+ * @note	A new frame is taken from the first empty slot of in.fifo when the
+ *		previous one has been handed out. If the FIFO is full, the oldest
+ *		frame is dropped.
+ *
+ * @param[out]	rx_buf	Pointer to the block.
+ */
+static void in_blk_next_get(uint32_t **rx_buf)
+{
+	int ret;
+	static int prev_ret;
+
+	if (ctrl_blk.in.blks_out == 0) {
+		ret = data_fifo_pointer_first_vacant_get(ctrl_blk.in.fifo,
+							 (void **)&ctrl_blk.in.frame, K_NO_WAIT);
+		if (ret == 0 && prev_ret == -ENOMEM) {
+			LOG_INF("I2S RX continuing stream");
+			prev_ret = ret;
+		}
+
+		/* If RX FIFO is filled up */
+		if (ret == -ENOMEM) {
+			void *data;
+			size_t size;
+
+			if (ret != prev_ret) {
+				LOG_DBG("I2S RX overrun. Single msg");
+				prev_ret = ret;
+			}
+
+			ret = data_fifo_pointer_last_filled_get(ctrl_blk.in.fifo, &data, &size,
+								K_NO_WAIT);
+			ERR_CHK(ret);
+
+			data_fifo_block_free(ctrl_blk.in.fifo, data);
+
+			ret = data_fifo_pointer_first_vacant_get(
+				ctrl_blk.in.fifo, (void **)&ctrl_blk.in.frame, K_NO_WAIT);
+		}
+
+		ERR_CHK_MSG(ret, "RX failed to get block");
+	}
+
+	*rx_buf = (uint32_t *)(ctrl_blk.in.frame + (ctrl_blk.in.blks_out * BLOCK_SIZE_BYTES));
+	ctrl_blk.in.blks_out = (ctrl_blk.in.blks_out + 1) % CONFIG_FIFO_FRAME_SPLIT_NUM;
+}
+
 /*
  * This handler function is called every time I2S needs new buffers for
  * TX and RX data.
  *
  * The new TX data buffer is the next consumer block in out.fifo.
  *
- * The new RX data buffer is the first empty slot of in.fifo.
- * New I2S RX data is located in rx_buf_released, and is locked into
- * the in.fifo message queue.
+ * The new RX data buffer is the next block of the frame being filled in
+ * in.fifo. When I2S has released the last block of a frame, the frame is
+ * locked into the in.fifo message queue, so the encoder reads it in place.
  */
 static void audio_datapath_i2s_blk_complete(uint32_t frame_start_ts_us, uint32_t *rx_buf_released,
 					    uint32_t const *tx_buf_released)
 {
 	int ret;
 	static bool underrun_condition;
+	uint32_t isr_start_cyc = k_cycle_get_32();
 
 	alt_buffer_free(tx_buf_released);
 
-	/*** Presentation delay measurement ***/
-	ctrl_blk.current_pres_dly_us =
-		frame_start_ts_us - ctrl_blk.out.prod_blk_ts[ctrl_blk.out.cons_blk_idx];
-
 	/********** I2S TX **********/
 	static uint8_t *tx_buf;
 
 	if (IS_ENABLED(CONFIG_STREAM_BIDIRECTIONAL) || IS_ENABLED(CONFIG_AUDIO_HEADSET)) {
 		if (tx_buf_released != NULL) {
 			/* Double buffered index */
-			uint32_t next_out_blk_idx = NEXT_IDX(ctrl_blk.out.cons_blk_idx);
+			uint32_t next_out_blk_idx;
+			/* Block played last, still intact after the consumer moves on */
+			uint32_t last_out_blk_idx = blk_ring_cons_idx(&ctrl_blk.out.ring);
+
+			ctrl_blk.out.total_blks++;
+
+			if (blk_ring_consume(&ctrl_blk.out.ring, &next_out_blk_idx)) {
+				/*** Presentation delay measurement ***/
+				/* The block handed to I2S now starts after the current one */
+				ctrl_blk.current_pres_dly_us =
+					frame_start_ts_us + BLK_PERIOD_US -
+					ctrl_blk.out.prod_blk_ts[next_out_blk_idx];
 
-			if (next_out_blk_idx != ctrl_blk.out.prod_blk_idx) {
-				/* Only increment if not in under-run condition */
-				ctrl_blk.out.cons_blk_idx = next_out_blk_idx;
 				if (underrun_condition) {
 					underrun_condition = false;
 					ctrl_blk.out.total_blk_underruns = 0;
@@ -649,8 +957,28 @@ static void audio_datapath_i2s_blk_complete(uint32_t frame_start_ts_us, uint32_t
 				tx_buf = (uint8_t *)&ctrl_blk.out
 						 .fifo[next_out_blk_idx * BLK_STEREO_NUM_SAMPS];
 
+				if (ctrl_blk.out.empty_blks != 0) {
+					/* Ramp up from the concealment, the producer is done with
+					 * this block
+					 */
+					out_blk_resume((void *)tx_buf,
+						       &ctrl_blk.out.fifo[last_out_blk_idx *
+									  BLK_STEREO_NUM_SAMPS]);
+					ctrl_blk.out.empty_blks = 0;
+					ctrl_blk.out.total_fade_ins++;
+				}
 			} else {
-				if (stream_state_get() == STATE_STREAMING) {
+				ctrl_blk.clk_rec.restart = true;
+				ctrl_blk.current_pres_dly_us = 0;
+
+				if (ctrl_blk.out.dtx) {
+					/* Nothing is sent during silence */
+					ctrl_blk.out.total_dtx_blks++;
+				} else if (stream_state_get() == STATE_STREAMING) {
+					if (!underrun_condition) {
+						ctrl_blk.out.total_underruns++;
+					}
+
 					underrun_condition = true;
 					ctrl_blk.out.total_blk_underruns++;
 
@@ -667,7 +995,11 @@ static void audio_datapath_i2s_blk_complete(uint32_t frame_start_ts_us, uint32_t
 				ret = alt_buffer_get((void **)&tx_buf);
 				ERR_CHK(ret);
 
-				memset(tx_buf, 0, BLK_STEREO_SIZE_OCTETS);
+				out_blk_conceal(tx_buf);
+
+				if (ctrl_blk.out.empty_blks < UINT16_MAX) {
+					ctrl_blk.out.empty_blks++;
+				}
 			}
 
 			if (tone_active) {
@@ -678,46 +1010,23 @@ static void audio_datapath_i2s_blk_complete(uint32_t frame_start_ts_us, uint32_t
 
 	/********** I2S RX **********/
 	static uint32_t *rx_buf;
-	static int prev_ret;
 
 	if (IS_ENABLED(CONFIG_STREAM_BIDIRECTIONAL) || IS_ENABLED(CONFIG_AUDIO_GATEWAY)) {
-		/* Lock last filled buffer into message queue */
-		if (rx_buf_released != NULL) {
-			ret = data_fifo_block_lock(ctrl_blk.in.fifo, (void **)&rx_buf_released,
-						   BLOCK_SIZE_BYTES);
+		/* Blocks are released in the order they were handed out, lock a frame
+		 * into the message queue once its last block is filled
+		 */
+		if (rx_buf_released != NULL &&
+		    ++ctrl_blk.in.blks_released == CONFIG_FIFO_FRAME_SPLIT_NUM) {
+			void *frame = (uint8_t *)rx_buf_released - (FRAME_SIZE_BYTES - BLOCK_SIZE_BYTES);
+
+			ctrl_blk.in.blks_released = 0;
+			ret = data_fifo_block_lock(ctrl_blk.in.fifo, &frame, FRAME_SIZE_BYTES);
 
 			ERR_CHK_MSG(ret, "Unable to lock block RX");
 		}
 
 		/* Get new empty buffer to send to I2S HW */
-		ret = data_fifo_pointer_first_vacant_get(ctrl_blk.in.fifo, (void **)&rx_buf,
-							 K_NO_WAIT);
-		if (ret == 0 && prev_ret == -ENOMEM) {
-			LOG_INF("I2S RX continuing stream");
-			prev_ret = ret;
-		}
-
-		/* If RX FIFO is filled up */
-		if (ret == -ENOMEM) {
-			void *data;
-			size_t size;
-
-			if (ret != prev_ret) {
-				LOG_DBG("I2S RX overrun. Single msg");
-				prev_ret = ret;
-			}
-
-			ret = data_fifo_pointer_last_filled_get(ctrl_blk.in.fifo, &data, &size,
-								K_NO_WAIT);
-			ERR_CHK(ret);
-
-			data_fifo_block_free(ctrl_blk.in.fifo, data);
-
-			ret = data_fifo_pointer_first_vacant_get(ctrl_blk.in.fifo, (void **)&rx_buf,
-								 K_NO_WAIT);
-		}
-
-		ERR_CHK_MSG(ret, "RX failed to get block");
+		in_blk_next_get(&rx_buf);
 	}
 
 	/*** Data exchange ***/
@@ -727,6 +1036,12 @@ static void audio_datapath_i2s_blk_complete(uint32_t frame_start_ts_us, uint32_t
 	if (ctrl_blk.drift_comp.enabled) {
 		audio_datapath_drift_compensation(frame_start_ts_us);
 	}
+
+	uint32_t isr_cyc = k_cycle_get_32() - isr_start_cyc;
+
+	ctrl_blk.isr.cnt++;
+	ctrl_blk.isr.cyc_total += isr_cyc;
+	ctrl_blk.isr.cyc_max = MAX(ctrl_blk.isr.cyc_max, isr_cyc);
 }
 
 static void audio_datapath_i2s_start(void)
@@ -741,13 +1056,12 @@ static void audio_datapath_i2s_start(void)
 
 	/* TX */
 	if (IS_ENABLED(CONFIG_STREAM_BIDIRECTIONAL) || IS_ENABLED(CONFIG_AUDIO_HEADSET)) {
-		ctrl_blk.out.cons_blk_idx = PREV_IDX(ctrl_blk.out.cons_blk_idx);
-		tx_buf_one = (uint8_t *)&ctrl_blk.out
-				     .fifo[ctrl_blk.out.cons_blk_idx * BLK_STEREO_NUM_SAMPS];
+		/* The ring was just emptied, the consumer holds its last block */
+		uint32_t cons_blk_idx = blk_ring_cons_idx(&ctrl_blk.out.ring);
 
-		ctrl_blk.out.cons_blk_idx = PREV_IDX(ctrl_blk.out.cons_blk_idx);
-		tx_buf_two = (uint8_t *)&ctrl_blk.out
-				     .fifo[ctrl_blk.out.cons_blk_idx * BLK_STEREO_NUM_SAMPS];
+		tx_buf_one = (uint8_t *)&ctrl_blk.out
+				     .fifo[(FIFO_NUM_BLKS - 2) * BLK_STEREO_NUM_SAMPS];
+		tx_buf_two = (uint8_t *)&ctrl_blk.out.fifo[cons_blk_idx * BLK_STEREO_NUM_SAMPS];
 	}
 
 	/* RX */
@@ -760,12 +1074,10 @@ static void audio_datapath_i2s_start(void)
 			ERR_CHK_MSG(-ENOMEM, "FIFO is not empty!");
 		}
 
-		ret = data_fifo_pointer_first_vacant_get(ctrl_blk.in.fifo, (void **)&rx_buf_one,
-							 K_NO_WAIT);
-		ERR_CHK_MSG(ret, "RX failed to get block");
-		ret = data_fifo_pointer_first_vacant_get(ctrl_blk.in.fifo, (void **)&rx_buf_two,
-							 K_NO_WAIT);
-		ERR_CHK_MSG(ret, "RX failed to get block");
+		ctrl_blk.in.blks_out = 0;
+		ctrl_blk.in.blks_released = 0;
+		in_blk_next_get(&rx_buf_one);
+		in_blk_next_get(&rx_buf_two);
 	}
 
 	/* Start I2S */
@@ -782,9 +1094,10 @@ static void audio_datapath_i2s_stop(void)
 /**
  * @brief	Adjust timing to make sure audio data is sent just in time for Bluetooth LE event.
  *
- * @note	The time from last anchor point is checked and then blocks of 1 ms can be dropped
- *		to allow the sending of encoded data to be sent just before the connection interval
- *		opens up. This is done to reduce overall latency.
+ * @note	The time from last anchor point is checked and then a captured frame can be
+ *		dropped to allow the sending of encoded data to be sent just before the connection
+ *		interval opens up. This is done to reduce overall latency. Capture FIFO blocks
+ *		hold whole frames, so each drop moves the timing by a frame and not by 1 ms.
  *
  * @param[in]	tx_sync_ts_us	The timestamp from get_tx_sync.
  * @param[in]	curr_ts_us	The current time. This must be in the controller frame of reference.
@@ -820,12 +1133,12 @@ static void audio_datapath_just_in_time_check_and_adjust(uint32_t tx_sync_ts_us,
 
 	if ((diff < (JUST_IN_TIME_TARGET_DLY_US - JUST_IN_TIME_BOUND_US)) ||
 	    (diff > (JUST_IN_TIME_TARGET_DLY_US + JUST_IN_TIME_BOUND_US))) {
-		ret = audio_system_fifo_rx_block_drop();
+		ret = audio_system_fifo_rx_frame_drop();
 		if (ret) {
-			LOG_WRN("Not able to drop FIFO RX block");
+			LOG_WRN("Not able to drop FIFO RX frame");
 			return;
 		}
-		LOG_DBG("Dropped block to align with connection interval");
+		LOG_DBG("Dropped frame to align with connection interval");
 		print_count = 0;
 	}
 }
@@ -869,12 +1182,14 @@ ZBUS_LISTENER_DEFINE(sdu_ref_msg_listen, audio_datapath_sdu_ref_update);
 
 int audio_datapath_pres_delay_us_set(uint32_t delay_us)
 {
-	if (!IN_RANGE(delay_us, CONFIG_AUDIO_MIN_PRES_DLY_US, CONFIG_AUDIO_MAX_PRES_DLY_US)) {
+	if (!IN_RANGE(delay_us, CONFIG_AUDIO_MIN_PRES_DLY_US, FIFO_PRES_DLY_MAX_US)) {
 		LOG_WRN("Presentation delay not supported: %d", delay_us);
 		return -EINVAL;
 	}
 
 	ctrl_blk.pres_comp.pres_delay_us = delay_us;
+	/* Measure again against the new target */
+	pres_comp_state_set(PRES_STATE_INIT);
 
 	LOG_DBG("Presentation delay set to %d us", delay_us);
 
@@ -886,9 +1201,82 @@ void audio_datapath_pres_delay_us_get(uint32_t *delay_us)
 	*delay_us = ctrl_blk.pres_comp.pres_delay_us;
 }
 
-// void audio_datapath_stream_out(const uint8_t *buf, size_t size, uint32_t sdu_ref_us, bool
-// bad_frame, 			       uint32_t recv_frame_ts_us)
-void audio_datapath_stream_out(const uint8_t *buf, size_t size)
+/**
+ * @brief	Copy one block of mono PCM into the out FIFO, writing each sample
+ *		to both the left and the right channel.
+ *
+ * @param[out]	out	Start of the stereo block in the out FIFO.
+ * @param[in]	in	Mono PCM block of BLK_MONO_NUM_SAMPS samples.
+ */
+static void out_blk_mono_to_stereo(__typeof__(ctrl_blk.out.fifo[0]) *out, const void *in)
+{
+	const __typeof__(ctrl_blk.out.fifo[0]) *mono = in;
+
+	for (uint32_t i = 0; i < BLK_MONO_NUM_SAMPS; i++) {
+		out[2 * i] = mono[i];
+		out[2 * i + 1] = mono[i];
+	}
+}
+
+/**
+ * @brief	Expand a mono frame at the start of a FIFO span to stereo, in place.
+ *
+ * @note	Runs backwards so no sample is overwritten before it is read.
+ *
+ * @param[in,out]	out	Start of the span, holding NUM_BLKS_IN_FRAME mono blocks.
+ */
+static void out_frame_mono_to_stereo_in_place(__typeof__(ctrl_blk.out.fifo[0]) *out)
+{
+	for (int32_t i = (BLK_MONO_NUM_SAMPS * NUM_BLKS_IN_FRAME) - 1; i >= 0; i--) {
+		out[2 * i + 1] = out[i];
+		out[2 * i] = out[i];
+	}
+}
+
+#if (CONFIG_AUDIO_ASRC)
+/**
+ * @brief	Resample a decoded frame by the clock drift and add the whole blocks
+ *		to the out FIFO.
+ *
+ * @note	What is left of a block waits for the next frame, so now and then a
+ *		frame adds one block more or one less.
+ *
+ * @param[in]	pcm			Decoded frame.
+ * @param[in]	pcm_mono		The frame is mono and goes to both channels.
+ * @param[in]	recv_frame_ts_us	Timestamp of when frame was received.
+ */
+static void out_frame_asrc(const void *pcm, bool pcm_mono, uint32_t recv_frame_ts_us)
+{
+	uint32_t out_blk_idx = blk_ring_prod_idx(&ctrl_blk.out.ring, 0);
+	/* The blocks start with the samples left from the previous frame */
+	uint32_t first_blk_ts_us =
+		recv_frame_ts_us - (asrc_buf_frames * BLK_PERIOD_US / BLK_MONO_NUM_SAMPS);
+	size_t frames = asrc_buf_frames +
+			asrc_process(&asrc, pcm, BLK_MONO_NUM_SAMPS * NUM_BLKS_IN_FRAME, pcm_mono,
+				     &asrc_buf[asrc_buf_frames * ASRC_CH_NUM],
+				     (ARRAY_SIZE(asrc_buf) / ASRC_CH_NUM) - asrc_buf_frames);
+	uint32_t num_blks = frames / BLK_MONO_NUM_SAMPS;
+
+	for (uint32_t i = 0; i < num_blks; i++) {
+		memcpy(&ctrl_blk.out.fifo[out_blk_idx * BLK_STEREO_NUM_SAMPS],
+		       &asrc_buf[i * BLK_STEREO_NUM_SAMPS], BLK_STEREO_SIZE_OCTETS);
+
+		/* Record producer block start reference */
+		ctrl_blk.out.prod_blk_ts[out_blk_idx] = first_blk_ts_us + (i * BLK_PERIOD_US);
+
+		out_blk_idx = NEXT_IDX(out_blk_idx);
+	}
+
+	asrc_buf_frames = frames - (num_blks * BLK_MONO_NUM_SAMPS);
+	memmove(asrc_buf, &asrc_buf[num_blks * BLK_STEREO_NUM_SAMPS],
+		asrc_buf_frames * ASRC_CH_NUM * sizeof(asrc_buf[0]));
+
+	ctrl_blk.out.total_copied_bytes += num_blks * BLK_STEREO_SIZE_OCTETS;
+	blk_ring_produce(&ctrl_blk.out.ring, num_blks);
+}
+#endif /* (CONFIG_AUDIO_ASRC) */
+
+void audio_datapath_stream_out(const uint8_t *buf, size_t size, uint32_t recv_frame_ts_us)
 {
 	if (!ctrl_blk.stream_started) {
 		LOG_WRN("Stream not started");
@@ -901,60 +1289,35 @@ void audio_datapath_stream_out(const uint8_t *buf, size_t size)
 		LOG_ERR("Buffer pointer is NULL");
 	}
 
-	// if (sdu_ref_us == ctrl_blk.prev_pres_sdu_ref_us && sdu_ref_us != 0) {
-	// 	LOG_WRN("Duplicate sdu_ref_us (%d) - Dropping audio frame", sdu_ref_us);
-	// 	return;
-	// }
-
-	// bool sdu_ref_not_consecutive = false;
-
-	// if (ctrl_blk.prev_pres_sdu_ref_us) {
-	// 	uint32_t sdu_ref_delta_us = sdu_ref_us - ctrl_blk.prev_pres_sdu_ref_us;
-
-	// 	/* Check if the delta is from two consecutive frames */
-	// 	if (sdu_ref_delta_us <
-	// 	    (CONFIG_AUDIO_FRAME_DURATION_US + (CONFIG_AUDIO_FRAME_DURATION_US / 2))) {
-	// 		/* Check for invalid delta */
-	// 		if ((sdu_ref_delta_us >
-	// 		     (CONFIG_AUDIO_FRAME_DURATION_US + SDU_REF_DELTA_MAX_ERR_US)) ||
-	// 		    (sdu_ref_delta_us <
-	// 		     (CONFIG_AUDIO_FRAME_DURATION_US - SDU_REF_DELTA_MAX_ERR_US))) {
-	// 			LOG_DBG("Invalid sdu_ref_us delta (%d) - Estimating sdu_ref_us",
-	// 				sdu_ref_delta_us);
-
-	// 			/* Estimate sdu_ref_us */
-	// 			sdu_ref_us = ctrl_blk.prev_pres_sdu_ref_us +
-	// 				     CONFIG_AUDIO_FRAME_DURATION_US;
-	// 		}
-	// 	} else {
-	// 		LOG_INF("sdu_ref_us not from consecutive frames (diff: %d us)",
-	// 			sdu_ref_delta_us);
-	// 		sdu_ref_not_consecutive = true;
-	// 	}
-	// }
-
-	// ctrl_blk.prev_pres_sdu_ref_us = sdu_ref_us;
-
-	// /*** Presentation compensation ***/
-	// if (ctrl_blk.pres_comp.enabled) {
-	// 	audio_datapath_presentation_compensation(recv_frame_ts_us, sdu_ref_us,
-	// 						 sdu_ref_not_consecutive);
-	// }
+	/*** Presentation compensation ***/
+	if (ctrl_blk.pres_comp.enabled) {
+		audio_datapath_presentation_compensation(recv_frame_ts_us);
+	}
 
 	// /*** Decode ***/
 
-	size_t pcm_size = 0;
-
-#if (CONFIG_SW_CODEC_OPUS)
 	int ret;
+	size_t pcm_size = 0;
+	/* Resampling can add one block more than a frame */
+	uint32_t max_blks_in_frame = NUM_BLKS_IN_FRAME + (IS_ENABLED(CONFIG_AUDIO_ASRC) ? 1 : 0);
+	bool fifo_full = max_blks_in_frame > blk_ring_space(&ctrl_blk.out.ring);
+	uint32_t out_blk_idx = blk_ring_prod_idx(&ctrl_blk.out.ring, 0);
+	void *out_span = &ctrl_blk.out.fifo[out_blk_idx * BLK_STEREO_NUM_SAMPS];
+
+	ctrl_blk.out.dtx = false;
+
+	/* Decode straight into the FIFO unless the frame wraps around its end or is resampled */
+	if (!fifo_full && !IS_ENABLED(CONFIG_AUDIO_ASRC) &&
+	    (out_blk_idx + NUM_BLKS_IN_FRAME) <= FIFO_NUM_BLKS) {
+		ctrl_blk.decoded_data = out_span;
+	} else {
+		ctrl_blk.decoded_data = NULL;
+	}
 
-	ret = sw_codec_decode(buf, size, 0, &ctrl_blk.decoded_data, &pcm_size);
+	ret = sw_codec_decode(buf, size, false, &ctrl_blk.decoded_data, &pcm_size);
 	if (ret) {
 		LOG_WRN("SW codec decode error: %d", ret);
 	}
-#else
-	pcm_size = BLK_STEREO_SIZE_OCTETS * NUM_BLKS_IN_FRAME;
-#endif
 
 	// if (IS_ENABLED(CONFIG_SD_CARD_PLAYBACK)) {
 	// 	if (sd_card_playback_is_active()) {
@@ -962,53 +1325,95 @@ void audio_datapath_stream_out(const uint8_t *buf, size_t size)
 	// 	}
 	// }
 
-	if (pcm_size != (BLK_STEREO_SIZE_OCTETS * NUM_BLKS_IN_FRAME)) {
+	/* A mono decoder outputs half a stereo frame, it is expanded while filling the FIFO */
+	bool pcm_mono = (pcm_size == (BLK_MONO_SIZE_OCTETS * NUM_BLKS_IN_FRAME));
+
+	if (!pcm_mono && (pcm_size != (BLK_STEREO_SIZE_OCTETS * NUM_BLKS_IN_FRAME))) {
 		LOG_WRN("Decoded audio has wrong size: %d. Expected: %d", pcm_size,
 			(BLK_STEREO_SIZE_OCTETS * NUM_BLKS_IN_FRAME));
 		/* Discard frame */
 		return;
 	}
-	// // pcm_size = 1920
-	// pcm_size = BLK_STEREO_SIZE_OCTETS * NUM_BLKS_IN_FRAME;
+
 	/*** Add audio data to FIFO buffer ***/
 
-	int32_t num_blks_in_fifo = ctrl_blk.out.prod_blk_idx - ctrl_blk.out.cons_blk_idx;
-	// FIFO_NUM_BLKS = 120
-	// NUM_BLKS_IN_FRAME = 10
-	if ((num_blks_in_fifo + NUM_BLKS_IN_FRAME) > FIFO_NUM_BLKS) {
+	// FIFO_NUM_BLKS = 50
+	// NUM_BLKS_IN_FRAME = 10 for a 10 ms frame
+	if (fifo_full) {
 		LOG_WRN("Output audio stream overrun - Discarding audio frame");
+		ctrl_blk.clk_rec.restart = true;
 
 		/* Discard frame to allow consumer to catch up */
 		return;
 	}
 
-	uint32_t out_blk_idx = ctrl_blk.out.prod_blk_idx;
+#if (CONFIG_AUDIO_ASRC)
+	out_frame_asrc(ctrl_blk.decoded_data, pcm_mono, recv_frame_ts_us);
+	out_fifo_max_blks_update();
+	return;
+#endif /* (CONFIG_AUDIO_ASRC) */
+
+	if (ctrl_blk.decoded_data == out_span) {
+		/* Already in place, only mono needs to be spread over both channels */
+		if (pcm_mono) {
+			out_frame_mono_to_stereo_in_place(out_span);
+		}
+
+		ctrl_blk.out.total_direct_bytes += pcm_size;
+
+		for (uint32_t i = 0; i < NUM_BLKS_IN_FRAME; i++) {
+			/* Record producer block start reference */
+			ctrl_blk.out.prod_blk_ts[out_blk_idx] = recv_frame_ts_us + (i * BLK_PERIOD_US);
+			out_blk_idx = NEXT_IDX(out_blk_idx);
+		}
+
+		blk_ring_produce(&ctrl_blk.out.ring, NUM_BLKS_IN_FRAME);
+		out_fifo_max_blks_update();
+		return;
+	}
+
+	const uint8_t *pcm = ctrl_blk.decoded_data;
+
+	ctrl_blk.out.total_copied_bytes += pcm_size;
 
 	// BLK_STEREO_NUM_SAMPS = 96
 	// BLK_STEREO_SIZE_OCTETS = 192
 	for (uint32_t i = 0; i < NUM_BLKS_IN_FRAME; i++) {
-		if (IS_ENABLED(CONFIG_AUDIO_BIT_DEPTH_16)) {
-#if (CONFIG_SW_CODEC_OPUS)
-			memcpy(&ctrl_blk.out.fifo[out_blk_idx * BLK_STEREO_NUM_SAMPS],
-			       &((int16_t *)ctrl_blk.decoded_data)[i * BLK_STEREO_NUM_SAMPS],
-			       BLK_STEREO_SIZE_OCTETS);
-#else
-			memcpy(&ctrl_blk.out.fifo[out_blk_idx * BLK_STEREO_NUM_SAMPS],
-			       &((int16_t *)buf)[i * BLK_STEREO_NUM_SAMPS], BLK_STEREO_SIZE_OCTETS);
-#endif // CONFIG_SW_CODEC_OPUS
-		} else if (IS_ENABLED(CONFIG_AUDIO_BIT_DEPTH_32)) {
+		if (pcm_mono) {
+			out_blk_mono_to_stereo(&ctrl_blk.out.fifo[out_blk_idx * BLK_STEREO_NUM_SAMPS],
+					       pcm + (i * BLK_MONO_SIZE_OCTETS));
+		} else {
 			memcpy(&ctrl_blk.out.fifo[out_blk_idx * BLK_STEREO_NUM_SAMPS],
-			       &((int32_t *)ctrl_blk.decoded_data)[i * BLK_STEREO_NUM_SAMPS],
-			       BLK_STEREO_SIZE_OCTETS);
+			       pcm + (i * BLK_STEREO_SIZE_OCTETS), BLK_STEREO_SIZE_OCTETS);
 		}
 
 		/* Record producer block start reference */
-		// ctrl_blk.out.prod_blk_ts[out_blk_idx] = recv_frame_ts_us + (i * BLK_PERIOD_US);
+		ctrl_blk.out.prod_blk_ts[out_blk_idx] = recv_frame_ts_us + (i * BLK_PERIOD_US);
 
 		out_blk_idx = NEXT_IDX(out_blk_idx);
 	}
 
-	ctrl_blk.out.prod_blk_idx = out_blk_idx;
+	blk_ring_produce(&ctrl_blk.out.ring, NUM_BLKS_IN_FRAME);
+	out_fifo_max_blks_update();
+}
+
+void audio_datapath_dtx_start(void)
+{
+	if (!ctrl_blk.stream_started) {
+		return;
+	}
+
+	if (!ctrl_blk.out.dtx) {
+		LOG_DBG("Sender is silent, playing silence");
+	}
+
+	ctrl_blk.out.dtx = true;
+}
+
+void audio_datapath_dtx_stats_get(uint32_t *num_blks, uint32_t *num_dtx_blks)
+{
+	*num_blks = ctrl_blk.out.total_blks;
+	*num_dtx_blks = ctrl_blk.out.total_dtx_blks;
 }
 
 int audio_datapath_start(struct data_fifo *fifo_rx)
@@ -1025,6 +1430,16 @@ int audio_datapath_start(struct data_fifo *fifo_rx)
 
 		/* Clear counters and mute initial audio */
 		memset(&ctrl_blk.out, 0, sizeof(ctrl_blk.out));
+		blk_ring_init(&ctrl_blk.out.ring, FIFO_NUM_BLKS);
+
+#if (CONFIG_AUDIO_ASRC)
+		int32_t corr_mppm = ctrl_blk.clk_rec.loop.corr_mppm;
+
+		/* Keep the ratio, the drift has not changed */
+		asrc_init(&asrc);
+		asrc_ratio_set(&asrc, corr_mppm);
+		asrc_buf_frames = 0;
+#endif /* (CONFIG_AUDIO_ASRC) */
 
 		audio_datapath_i2s_start();
 		ctrl_blk.stream_started = true;
@@ -1044,6 +1459,7 @@ int audio_datapath_stop(void)
 		ctrl_blk.prev_drift_sdu_ref_us = 0;
 
 		pres_comp_state_set(PRES_STATE_INIT);
+		memset(&ctrl_blk.pres_comp.stats, 0, sizeof(ctrl_blk.pres_comp.stats));
 
 		return 0;
 	} else {
@@ -1054,11 +1470,13 @@ int audio_datapath_stop(void)
 int audio_datapath_init(void)
 {
 	memset(&ctrl_blk, 0, sizeof(ctrl_blk));
+	blk_ring_init(&ctrl_blk.out.ring, FIFO_NUM_BLKS);
 	audio_i2s_blk_comp_cb_register(audio_datapath_i2s_blk_complete);
 	audio_i2s_init();
 	ctrl_blk.datapath_initialized = true;
 	ctrl_blk.drift_comp.enabled = true;
 	ctrl_blk.pres_comp.enabled = true;
+	clock_recovery_init(&ctrl_blk.clk_rec.loop);
 
 	if (IS_ENABLED(CONFIG_STREAM_BIDIRECTIONAL) && IS_ENABLED(CONFIG_AUDIO_GATEWAY)) {
 		/* Disable presentation compensation feature for microphone return on gateway,
@@ -1070,7 +1488,9 @@ int audio_datapath_init(void)
 		ctrl_blk.pres_comp.enabled = true;
 	}
 
-	ctrl_blk.pres_comp.pres_delay_us = CONFIG_BT_AUDIO_PRESENTATION_DELAY_US;
+	ctrl_blk.pres_comp.pres_delay_us = CONFIG_AUDIO_PRES_DLY_US;
+
+	LOG_INF("Out FIFO: %d blocks, %zu bytes", FIFO_NUM_BLKS, sizeof(ctrl_blk.out.fifo));
 
 	return 0;
 }
@@ -1164,6 +1584,10 @@ static int cmd_hfclkaudio_drift_comp_disable(const struct shell *shell, size_t a
 		ctrl_blk.drift_comp.enabled = false;
 		ctrl_blk.drift_comp.ctr = 0;
 		drift_comp_state_set(DRIFT_STATE_INIT);
+		clock_recovery_init(&ctrl_blk.clk_rec.loop);
+#if (CONFIG_AUDIO_ASRC)
+		asrc_ratio_set(&asrc, 0);
+#endif /* (CONFIG_AUDIO_ASRC) */
 
 		shell_print(shell, "Audio PLL drift compensation disabled");
 	}
@@ -1200,6 +1624,152 @@ static int cmd_audio_pres_comp_disable(const struct shell *shell, size_t argc, c
 	return 0;
 }
 
+static int cmd_audio_pres_dly(const struct shell *shell, size_t argc, const char **argv)
+{
+	int ret;
+
+	if (argc > 2) {
+		shell_error(shell, "Usage: pres_dly [target us]");
+		return -EINVAL;
+	}
+
+	if (argc == 2) {
+		ret = audio_datapath_pres_delay_us_set(strtoul(argv[1], NULL, 10));
+		if (ret) {
+			shell_error(shell, "Presentation delay must be %d to %d us",
+				    CONFIG_AUDIO_MIN_PRES_DLY_US, FIFO_PRES_DLY_MAX_US);
+			return ret;
+		}
+	}
+
+	shell_print(shell, "Presentation delay: %s, target %d us",
+		    pres_comp_state_names[ctrl_blk.pres_comp.state],
+		    ctrl_blk.pres_comp.pres_delay_us);
+
+	/* Copy, the datapath thread keeps adding to the stats */
+	__typeof__(ctrl_blk.pres_comp.stats) stats = ctrl_blk.pres_comp.stats;
+
+	if (stats.cnt == 0) {
+		shell_print(shell, "No delay measured while locked");
+		return 0;
+	}
+
+	int64_t mean_us = stats.sum_us / stats.cnt;
+	int64_t var_us2 = (int64_t)(stats.sum_sq_us / stats.cnt) - (mean_us * mean_us);
+
+	shell_print(shell, "Achieved: mean %lld us, std dev %d us, min %d us, max %d us (%d frames)",
+		    mean_us, (int)sqrt((double)MAX(var_us2, 0)), stats.min_us, stats.max_us,
+		    stats.cnt);
+
+	return 0;
+}
+
+static int cmd_i2s_isr_load(const struct shell *shell, size_t argc, const char **argv)
+{
+	ARG_UNUSED(argc);
+	ARG_UNUSED(argv);
+
+	unsigned int key = irq_lock();
+	__typeof__(ctrl_blk.isr) isr = ctrl_blk.isr;
+	int64_t now_ms = k_uptime_get();
+
+	/* Start a new measurement */
+	memset(&ctrl_blk.isr, 0, sizeof(ctrl_blk.isr));
+	ctrl_blk.isr.start_ms = now_ms;
+	irq_unlock(key);
+
+	int64_t elapsed_ms = now_ms - isr.start_ms;
+
+	if (isr.cnt == 0 || elapsed_ms <= 0) {
+		shell_print(shell, "No I2S blocks since the last call");
+		return 0;
+	}
+
+	uint64_t isr_us = k_cyc_to_us_floor64(isr.cyc_total);
+	/* Share of the CPU in 1/100 % */
+	uint32_t share = isr_us * 10000 / (elapsed_ms * USEC_PER_MSEC);
+
+	shell_print(shell, "Block period %d us: %lld interrupts/s, ISR avg %d us, max %d us",
+		    BLK_PERIOD_US, isr.cnt * MSEC_PER_SEC / elapsed_ms, (uint32_t)(isr_us / isr.cnt),
+		    k_cyc_to_us_floor32(isr.cyc_max));
+	shell_print(shell, "ISR CPU share %d.%02d %% over %lld ms", share / 100, share % 100,
+		    elapsed_ms);
+
+	return 0;
+}
+
+static int cmd_audio_out_fifo_copy(const struct shell *shell, size_t argc, const char **argv)
+{
+	ARG_UNUSED(argc);
+	ARG_UNUSED(argv);
+
+	uint64_t total = ctrl_blk.out.total_direct_bytes + ctrl_blk.out.total_copied_bytes;
+
+	shell_print(shell, "Out FIFO: %llu bytes decoded in place, %llu bytes copied (%d%% in place)",
+		    ctrl_blk.out.total_direct_bytes, ctrl_blk.out.total_copied_bytes,
+		    total ? (uint32_t)(ctrl_blk.out.total_direct_bytes * 100 / total) : 0);
+
+	return 0;
+}
+
+static int cmd_audio_out_fifo(const struct shell *shell, size_t argc, const char **argv)
+{
+	ARG_UNUSED(argc);
+	ARG_UNUSED(argv);
+
+	uint16_t max_blks = ctrl_blk.out.max_blks_in_fifo;
+
+	/* Start a new measurement */
+	ctrl_blk.out.max_blks_in_fifo = blk_ring_fill(&ctrl_blk.out.ring);
+
+	shell_print(shell, "Out FIFO: %d blocks of %d us (%d us, %zu bytes), now %d blocks",
+		    FIFO_NUM_BLKS, BLK_PERIOD_US, FIFO_SMPL_PERIOD_US, sizeof(ctrl_blk.out.fifo),
+		    blk_ring_fill(&ctrl_blk.out.ring));
+	shell_print(shell, "High water since the last call: %d blocks (%d us)", max_blks,
+		    max_blks * BLK_PERIOD_US);
+	shell_print(shell, "Presentation delay target %d us, at most %d us",
+		    ctrl_blk.pres_comp.pres_delay_us, FIFO_PRES_DLY_MAX_US);
+
+	return 0;
+}
+
+static int cmd_audio_underrun(const struct shell *shell, size_t argc, const char **argv)
+{
+	ARG_UNUSED(argc);
+	ARG_UNUSED(argv);
+
+	shell_print(shell, "Under-runs: %d, concealed over %d blocks of %d us",
+		    ctrl_blk.out.total_underruns, UNDERRUN_CONCEAL_BLKS, BLK_PERIOD_US);
+	shell_print(shell, "Blocks: %d concealed, %d silent, %d during DTX",
+		    ctrl_blk.out.total_conceal_blks, ctrl_blk.out.total_silent_blks,
+		    ctrl_blk.out.total_dtx_blks);
+	shell_print(shell, "Fade ins: %d", ctrl_blk.out.total_fade_ins);
+
+	return 0;
+}
+
+static int cmd_clk_rec(const struct shell *shell, size_t argc, const char **argv)
+{
+	ARG_UNUSED(argc);
+	ARG_UNUSED(argv);
+
+	if (!IS_ENABLED(CONFIG_AUDIO_HEADSET)) {
+		shell_error(shell, "Clock recovery only runs on the headset");
+		return -ENOTSUP;
+	}
+
+	struct clock_recovery *loop = &ctrl_blk.clk_rec.loop;
+
+	shell_print(shell, "Clock recovery: %s, drift %.01f ppm, correction %.01f ppm",
+		    clk_rec_state_names[loop->state],
+		    (double)clock_recovery_drift_mppm(loop) / 1000,
+		    (double)loop->corr_mppm / 1000);
+	shell_print(shell, "Out FIFO fill: target %d us, error %d us", loop->target_us,
+		    clock_recovery_err_us(loop));
+
+	return 0;
+}
+
 SHELL_STATIC_SUBCMD_SET_CREATE(test_cmd,
 			       SHELL_COND_CMD(CONFIG_SHELL, nrf_tone_start, NULL,
 					      "Start local tone from nRF5340", cmd_i2s_tone_play),
@@ -1217,6 +1787,24 @@ SHELL_STATIC_SUBCMD_SET_CREATE(test_cmd,
 			       SHELL_COND_CMD(CONFIG_SHELL, pll_pres_comp_disable, NULL,
 					      "Disable audio presentation compensation",
 					      cmd_audio_pres_comp_disable),
+			       SHELL_COND_CMD(CONFIG_SHELL, pres_dly, NULL,
+					      "Show presentation delay and its spread, or set [us]",
+					      cmd_audio_pres_dly),
+			       SHELL_COND_CMD(CONFIG_SHELL, i2s_isr, NULL,
+					      "I2S interrupt rate and CPU share since the last call",
+					      cmd_i2s_isr_load),
+			       SHELL_COND_CMD(CONFIG_SHELL, out_fifo, NULL,
+					      "Out FIFO size and high water mark since the last call",
+					      cmd_audio_out_fifo),
+			       SHELL_COND_CMD(CONFIG_SHELL, out_fifo_copy, NULL,
+					      "Decoded bytes written in place vs copied to I2S",
+					      cmd_audio_out_fifo_copy),
+			       SHELL_COND_CMD(CONFIG_SHELL, underrun, NULL,
+					      "Under-run, concealment and fade in counts",
+					      cmd_audio_underrun),
+			       SHELL_COND_CMD(CONFIG_SHELL, clk_rec, NULL,
+					      "Show clock recovery lock state and drift",
+					      cmd_clk_rec),
 			       SHELL_SUBCMD_SET_END);
 
 SHELL_CMD_REGISTER(test, &test_cmd, "Test mode commands", NULL);
@@ -50,18 +50,33 @@ void audio_datapath_pres_delay_us_get(uint32_t *delay_us);
  * @brief Input an audio data frame which is processed and outputted over I2S
  *
  * @note A frame of raw encoded audio data is inputted, and this data then is decoded
- *       and processed before being outputted over I2S. The audio is synchronized
- *       using sdu_ref_us
+ *       and processed before being outputted over I2S. Blocks are added or dropped
+ *       so the first block of a frame starts on I2S the presentation delay after
+ *       recv_frame_ts_us
  *
  * @param buf Pointer to audio data frame
  * @param size Size of audio data frame in bytes
- * @param sdu_ref_us ISO timestamp reference from BLE controller
- * @param bad_frame Indicating if the audio frame is bad or not
- * @param recv_frame_ts_us Timestamp of when audio frame was received
+ * @param recv_frame_ts_us Timestamp of when audio frame was received,
+ *                         from audio_sync_timer_capture()
  */
-// void audio_datapath_stream_out(const uint8_t *buf, size_t size, uint32_t sdu_ref_us, bool
-// bad_frame, 			       uint32_t recv_frame_ts_us);
-void audio_datapath_stream_out(const uint8_t *buf, size_t size);
+void audio_datapath_stream_out(const uint8_t *buf, size_t size, uint32_t recv_frame_ts_us);
+
+/**
+ * @brief Signal that the sender stopped sending because of silence (DTX)
+ *
+ * @note Once the frames in the out FIFO are played, I2S plays silence until the
+ *       next call to audio_datapath_stream_out(), and this is not counted as an
+ *       under-run.
+ */
+void audio_datapath_dtx_start(void);
+
+/**
+ * @brief Get the number of I2S blocks played, and how many of them were DTX silence
+ *
+ * @param num_blks Number of blocks played since the datapath was started
+ * @param num_dtx_blks Number of these blocks played as DTX silence
+ */
+void audio_datapath_dtx_stats_get(uint32_t *num_blks, uint32_t *num_dtx_blks);
 
 /**
  * @brief Start the audio datapath module
@@ -9,6 +9,7 @@
 #include "audio_datapath.h"
 #include "audio_i2s.h"
 #include "audio_usb.h"
+#include "channel_assignment.h"
 #include "hw_codec.h"
 #include "macros_common.h"
 #include "streamctrl.h"
@@ -25,7 +26,10 @@
 LOG_MODULE_REGISTER(audio_system, CONFIG_AUDIO_SYSTEM_LOG_LEVEL);
 
 #define FIFO_TX_BLOCK_COUNT (CONFIG_FIFO_FRAME_SPLIT_NUM * CONFIG_FIFO_TX_FRAME_COUNT)
-#define FIFO_RX_BLOCK_COUNT (CONFIG_FIFO_FRAME_SPLIT_NUM * CONFIG_FIFO_RX_FRAME_COUNT)
+/* One frame per block. I2S fills up to two frames at a frame boundary and the encoder
+ * holds one, on top of the frames queued for the encoder
+ */
+#define FIFO_RX_BLOCK_COUNT (CONFIG_FIFO_RX_FRAME_COUNT + 3)
 
 #define DEBUG_INTERVAL_NUM     1000
 #define TEST_TONE_BASE_FREQ_HZ 1000
@@ -33,7 +37,7 @@ LOG_MODULE_REGISTER(audio_system, CONFIG_AUDIO_SYSTEM_LOG_LEVEL);
 K_THREAD_STACK_DEFINE(encoder_thread_stack, CONFIG_ENCODER_STACK_SIZE);
 
 DATA_FIFO_DEFINE(fifo_tx, FIFO_TX_BLOCK_COUNT, WB_UP(BLOCK_SIZE_BYTES));
-DATA_FIFO_DEFINE(fifo_rx, FIFO_RX_BLOCK_COUNT, WB_UP(BLOCK_SIZE_BYTES));
+DATA_FIFO_DEFINE(fifo_rx, FIFO_RX_BLOCK_COUNT, WB_UP(FRAME_SIZE_BYTES));
 
 static K_SEM_DEFINE(sem_encoder_start, 0, 1);
 
@@ -46,10 +50,55 @@ static struct k_poll_event encoder_evt =
 	K_POLL_EVENT_INITIALIZER(K_POLL_TYPE_SIGNAL, K_POLL_MODE_NOTIFY_ONLY, &encoder_sig);
 
 static struct sw_codec_config sw_codec_cfg;
+/* Set once a codec has been picked at run time, the Kconfig default is used until then */
+static bool sw_codec_selected;
+/* Held while the codec is set up, switched, encoding or decoding, so a switch from the
+ * shell or from a received frame never happens in the middle of a frame of the encoder
+ * or the audio datapath thread
+ */
+static K_MUTEX_DEFINE(sw_codec_mtx);
+/* Between audio_system_start() and audio_system_stop(), the codec may still be down
+ * after a failed switch
+ */
+static bool audio_system_started;
+/* Received frames dropped because the decoder could not follow their codec */
+static uint32_t codec_switch_drops;
+static bool codec_switch_dropping;
 /* Buffer which can hold max 1 period test tone at 1000 Hz */
+#if (CONFIG_AUDIO_BIT_DEPTH_16)
 static int16_t test_tone_buf[CONFIG_AUDIO_SAMPLE_RATE_HZ / 1000];
+#else
+static int32_t test_tone_buf[CONFIG_AUDIO_SAMPLE_RATE_HZ / 1000];
+#endif /* (CONFIG_AUDIO_BIT_DEPTH_16) */
 static size_t test_tone_size;
 
+#if (CONFIG_AUDIO_DTX)
+#define DTX_HANGOVER_FRAMES (CONFIG_AUDIO_DTX_HANGOVER_MS * 1000 / CONFIG_AUDIO_FRAME_DURATION_US)
+#define DTX_KEEPALIVE_FRAMES                                                                       \
+	MAX(CONFIG_AUDIO_DTX_KEEPALIVE_MS * 1000 / CONFIG_AUDIO_FRAME_DURATION_US, 1)
+#if (CONFIG_AUDIO_BIT_DEPTH_16)
+#define DTX_LEVEL CONFIG_AUDIO_DTX_LEVEL
+#else
+#define DTX_LEVEL (CONFIG_AUDIO_DTX_LEVEL << 16)
+#endif /* (CONFIG_AUDIO_BIT_DEPTH_16) */
+#endif /* (CONFIG_AUDIO_DTX) */
+
+/* Frames encoded in place from fifo_rx, and the time from getting a frame to encoded */
+static struct {
+	uint32_t frames;
+	uint32_t cycles_last;
+	uint32_t cycles_max;
+	uint64_t cycles_total;
+} capture_stats;
+
+/* Discontinuous transmission, nothing is encoded or sent while the input is silent */
+static struct {
+	uint32_t silent_frames; /* Consecutive silent frames */
+	uint32_t frames;
+	uint32_t dtx_frames;
+	uint32_t keepalives;
+} dtx;
+
 static bool sample_rate_valid(uint32_t sample_rate_hz)
 {
 	if (sample_rate_hz == 16000 || sample_rate_hz == 24000 || sample_rate_hz == 48000) {
@@ -59,13 +108,28 @@ static bool sample_rate_valid(uint32_t sample_rate_hz)
 	return false;
 }
 
+static enum sw_codec_select sw_codec_default_get(void)
+{
+	if (IS_ENABLED(CONFIG_SW_CODEC_DEFAULT_LC3)) {
+		return SW_CODEC_LC3;
+	} else if (IS_ENABLED(CONFIG_SW_CODEC_DEFAULT_OPUS)) {
+		return SW_CODEC_OPUS;
+	} else if (IS_ENABLED(CONFIG_SW_CODEC_DEFAULT_LOSSLESS)) {
+		return SW_CODEC_LOSSLESS;
+	} else if (IS_ENABLED(CONFIG_SW_CODEC_DEFAULT_ADPCM)) {
+		return SW_CODEC_ADPCM;
+	}
+
+	return SW_CODEC_NONE;
+}
+
 static void audio_gateway_configure(void)
 {
-	if (IS_ENABLED(CONFIG_SW_CODEC_LC3)) {
-		sw_codec_cfg.sw_codec = SW_CODEC_LC3;
-	} else if (IS_ENABLED(CONFIG_SW_CODEC_OPUS)) {
-		sw_codec_cfg.sw_codec = SW_CODEC_OPUS;
-	} else {
+	if (!sw_codec_selected) {
+		sw_codec_cfg.sw_codec = sw_codec_default_get();
+	}
+
+	if (sw_codec_cfg.sw_codec == SW_CODEC_NONE) {
 		LOG_INF("No codec selected, transfering uncompressed PCM audio data.");
 	}
 
@@ -86,13 +150,9 @@ static void audio_gateway_configure(void)
 
 static void audio_headset_configure(void)
 {
-	if (IS_ENABLED(CONFIG_SW_CODEC_LC3)) {
-		sw_codec_cfg.sw_codec = SW_CODEC_LC3;
-	} else if (IS_ENABLED(CONFIG_SW_CODEC_OPUS)) {
-		sw_codec_cfg.sw_codec = SW_CODEC_OPUS;
-	} else {
-
-		LOG_INF("No codec selected, transfering uncompressed PCM audio data.");
+	/* Switched to the codec of the received stream by audio_system_codec_set() */
+	if (!sw_codec_selected) {
+		sw_codec_cfg.sw_codec = sw_codec_default_get();
 	}
 
 #if (CONFIG_STREAM_BIDIRECTIONAL)
@@ -100,8 +160,19 @@ static void audio_headset_configure(void)
 	sw_codec_cfg.encoder.channel_mode = SW_CODEC_MONO;
 #endif /* (CONFIG_STREAM_BIDIRECTIONAL) */
 
-	sw_codec_cfg.decoder.num_ch = 2;
-	sw_codec_cfg.decoder.channel_mode = SW_CODEC_STEREO;
+	if (IS_ENABLED(CONFIG_OPUS_MULTISTREAM)) {
+		/* Only the stream of this headset's channel is decoded */
+		channel_assignment_get(&sw_codec_cfg.decoder.audio_ch);
+		sw_codec_cfg.decoder.num_ch = 1;
+		sw_codec_cfg.decoder.channel_mode = SW_CODEC_MONO;
+	} else if (IS_ENABLED(CONFIG_MONO_TO_ALL_RECEIVERS)) {
+		/* Decoded mono is duplicated to both I2S channels by the audio datapath */
+		sw_codec_cfg.decoder.num_ch = 1;
+		sw_codec_cfg.decoder.channel_mode = SW_CODEC_MONO;
+	} else {
+		sw_codec_cfg.decoder.num_ch = 2;
+		sw_codec_cfg.decoder.channel_mode = SW_CODEC_STEREO;
+	}
 
 	if (IS_ENABLED(CONFIG_SD_CARD_PLAYBACK)) {
 		/* Need an extra decoder channel to decode data from SD card */
@@ -109,10 +180,67 @@ static void audio_headset_configure(void)
 	}
 }
 
-#if (CONFIG_SW_CODEC_OPUS)
-size_t encoded_bytes; // Variable to hold the size of encoded data
-uint8_t opus_output[48];
-#endif // CONFIG_CODEC_OPUS
+#if (CONFIG_AUDIO_DTX)
+static bool pcm_frame_is_silent(void const *const pcm, size_t size)
+{
+#if (CONFIG_AUDIO_BIT_DEPTH_16)
+	int16_t const *samples = pcm;
+#else
+	int32_t const *samples = pcm;
+#endif /* (CONFIG_AUDIO_BIT_DEPTH_16) */
+
+	for (size_t i = 0; i < size / sizeof(samples[0]); i++) {
+		if (samples[i] > DTX_LEVEL || samples[i] < -DTX_LEVEL) {
+			return false;
+		}
+	}
+
+	return true;
+}
+#endif /* (CONFIG_AUDIO_DTX) */
+
+/**
+ * @brief	Check if a PCM frame can be left out because the input is silent.
+ *
+ * @param[in]	pcm		PCM frame to check.
+ * @param[in]	size		Size of the PCM frame.
+ * @param[out]	keepalive	Set if an empty frame is to be sent instead.
+ *
+ * @return	true if the frame is not to be encoded and sent.
+ */
+static bool dtx_frame_skip(void const *const pcm, size_t size, bool *keepalive)
+{
+	*keepalive = false;
+
+#if (CONFIG_AUDIO_DTX)
+	dtx.frames++;
+
+	if (!pcm_frame_is_silent(pcm, size)) {
+		dtx.silent_frames = 0;
+		return false;
+	}
+
+	dtx.silent_frames++;
+	if (dtx.silent_frames <= DTX_HANGOVER_FRAMES) {
+		return false;
+	}
+
+	/* The first skipped frame tells the headset, later ones repeat it */
+	if (((dtx.silent_frames - DTX_HANGOVER_FRAMES - 1) % DTX_KEEPALIVE_FRAMES) == 0) {
+		*keepalive = true;
+		dtx.keepalives++;
+	}
+
+	dtx.dtx_frames++;
+
+	return true;
+#else
+	ARG_UNUSED(pcm);
+	ARG_UNUSED(size);
+
+	return false;
+#endif /* (CONFIG_AUDIO_DTX) */
+}
 
 static void encoder_thread(void *arg1, void *arg2, void *arg3)
 {
@@ -123,35 +251,32 @@ static void encoder_thread(void *arg1, void *arg2, void *arg3)
 	int debug_trans_count = 0;
 	size_t encoded_data_size = 0;
 
-	void *tmp_pcm_raw_data[CONFIG_FIFO_FRAME_SPLIT_NUM];
-	static uint8_t pcm_raw_data[FRAME_SIZE_BYTES];
+	void *pcm_raw_data;
+	uint32_t start;
 
 	static uint8_t *encoded_data;
 	static size_t pcm_block_size;
 	static uint32_t test_tone_finite_pos;
+	bool dtx_skip = false;
+	bool dtx_keepalive = false;
 
 	while (1) {
 		/* Don't start encoding until the stream needing it has started */
 		ret = k_poll(&encoder_evt, 1, K_FOREVER);
 
 		/* Get PCM data from I2S/USB */
-		/* Since one audio frame is divided into a number of
-		 * blocks, we need to fetch the pointers to all of these
-		 * blocks before copying it to a continuous area of memory
-		 * before sending it to the encoder
+		/* I2S and USB fill one FIFO block per frame, so the frame is
+		 * encoded in place and the block is freed once it has been sent
 		 */
-		for (int i = 0; i < CONFIG_FIFO_FRAME_SPLIT_NUM; i++) {
-			ret = data_fifo_pointer_last_filled_get(&fifo_rx, &tmp_pcm_raw_data[i],
-								&pcm_block_size, K_FOREVER);
-			ERR_CHK(ret);
+		ret = data_fifo_pointer_last_filled_get(&fifo_rx, &pcm_raw_data, &pcm_block_size,
+							K_FOREVER);
+		ERR_CHK(ret);
 
-			memcpy(pcm_raw_data + (i * BLOCK_SIZE_BYTES), tmp_pcm_raw_data[i],
-			       pcm_block_size);
+		start = k_cycle_get_32();
 
-			data_fifo_block_free(&fifo_rx, tmp_pcm_raw_data[i]);
-		}
+		/* Held until the frame is sent, the encoded data is owned by the codec */
+		k_mutex_lock(&sw_codec_mtx, K_FOREVER);
 
-#ifdef CONFIG_SW_CODEC_OPUS
 		if (sw_codec_cfg.encoder.enabled) {
 			if (test_tone_size) {
 				/* Test tone takes over audio stream */
@@ -168,12 +293,36 @@ static void encoder_thread(void *arg1, void *arg2, void *arg3)
 				ERR_CHK(ret);
 			}
 
-			ret = sw_codec_encode(pcm_raw_data, FRAME_SIZE_BYTES, &encoded_data,
-					      &encoded_data_size);
+			dtx_skip = dtx_frame_skip(pcm_raw_data, FRAME_SIZE_BYTES, &dtx_keepalive);
+			if (!sw_codec_cfg.initialized) {
+				/* No codec after a failed switch, the frame is dropped */
+				dtx_skip = true;
+				dtx_keepalive = false;
+			} else if (!dtx_skip) {
+				ret = sw_codec_encode(pcm_raw_data, FRAME_SIZE_BYTES, &encoded_data,
+						      &encoded_data_size);
 
-			ERR_CHK_MSG(ret, "Encode failed");
+				ERR_CHK_MSG(ret, "Encode failed");
+			}
+
+			capture_stats.cycles_last = k_cycle_get_32() - start;
+			capture_stats.cycles_max =
+				MAX(capture_stats.cycles_max, capture_stats.cycles_last);
+			capture_stats.cycles_total += capture_stats.cycles_last;
+			capture_stats.frames++;
 		}
-#endif /* CONFIG_SW_CODEC_OPUS */
+
+		if (sw_codec_cfg.encoder.enabled) {
+			if (!dtx_skip) {
+				send_audio_frame(sw_codec_cfg.sw_codec, encoded_data,
+						 encoded_data_size);
+			} else if (dtx_keepalive) {
+				/* Empty frame, the headset plays silence until audio resumes */
+				send_audio_frame(sw_codec_cfg.sw_codec, NULL, 0);
+			}
+		}
+
+		k_mutex_unlock(&sw_codec_mtx);
 
 		/* Print block usage */
 		if (debug_trans_count == DEBUG_INTERVAL_NUM) {
@@ -187,14 +336,8 @@ static void encoder_thread(void *arg1, void *arg2, void *arg3)
 			debug_trans_count++;
 		}
 
-		if (sw_codec_cfg.encoder.enabled) {
-#if (CONFIG_SW_CODEC_OPUS)
-			send_audio_frame(encoded_data, encoded_data_size);
-#else
-			// send_audio_frame(uint8_t *audio_data, size_t data_length);
-			send_audio_frame(pcm_raw_data, FRAME_SIZE_BYTES);
-#endif // CONFIG_CODEC_OPUS
-		}
+		/* Uncompressed PCM is sent straight from the block */
+		data_fifo_block_free(&fifo_rx, pcm_raw_data);
 
 		STACK_USAGE_PRINT("encoder_thread", &encoder_thread_data);
 	}
@@ -203,6 +346,8 @@ static void encoder_thread(void *arg1, void *arg2, void *arg3)
 void audio_system_encoder_start(void)
 {
 	LOG_INF("Encoder started");
+	memset(&dtx, 0, sizeof(dtx));
+	memset(&capture_stats, 0, sizeof(capture_stats));
 	k_poll_signal_raise(&encoder_sig, 0);
 }
 
@@ -222,14 +367,22 @@ int audio_system_encode_test_tone_set(uint32_t freq)
 	}
 
 	if (IS_ENABLED(CONFIG_AUDIO_TEST_TONE)) {
-		ret = tone_gen(test_tone_buf, &test_tone_size, freq, CONFIG_AUDIO_SAMPLE_RATE_HZ,
-			       1);
+		ret = tone_gen((int16_t *)test_tone_buf, &test_tone_size, freq,
+			       CONFIG_AUDIO_SAMPLE_RATE_HZ, 1);
 		ERR_CHK(ret);
 	} else {
 		LOG_ERR("Test tone is not enabled");
 		return -ENXIO;
 	}
 
+#if (CONFIG_AUDIO_BIT_DEPTH_32)
+	/* Widen the 16 bit tone in place, from the end so no sample is overwritten unread */
+	for (int i = test_tone_size / sizeof(int16_t) - 1; i >= 0; i--) {
+		test_tone_buf[i] = (int32_t)((const int16_t *)test_tone_buf)[i] << 16;
+	}
+	test_tone_size *= 2;
+#endif /* (CONFIG_AUDIO_BIT_DEPTH_32) */
+
 	if (test_tone_size > sizeof(test_tone_buf)) {
 		return -ENOMEM;
 	}
@@ -242,11 +395,6 @@ int audio_system_encode_test_tone_step(void)
 	int ret;
 	static uint32_t test_tone_hz;
 
-	if (CONFIG_AUDIO_BIT_DEPTH_BITS != 16) {
-		LOG_WRN("Tone gen only supports 16 bits");
-		return -ECANCELED;
-	}
-
 	if (test_tone_hz == 0) {
 		test_tone_hz = TEST_TONE_BASE_FREQ_HZ;
 	} else if (test_tone_hz >= TEST_TONE_BASE_FREQ_HZ * 4) {
@@ -270,6 +418,88 @@ int audio_system_encode_test_tone_step(void)
 	return 0;
 }
 
+/* Called with sw_codec_mtx held */
+static int codec_switch(enum sw_codec_select sw_codec)
+{
+	int ret;
+	const struct sw_codec_ops *ops;
+
+	if (sw_codec == sw_codec_cfg.sw_codec) {
+		sw_codec_selected = true;
+		return 0;
+	}
+
+	ops = sw_codec_ops_get(sw_codec);
+	if (ops == NULL) {
+		LOG_ERR("SW codec %d is not compiled in", sw_codec);
+		return -ENOTSUP;
+	}
+
+	if (!audio_system_started) {
+		/* Set up by audio_system_start() */
+		sw_codec_cfg.sw_codec = sw_codec;
+		sw_codec_selected = true;
+		return 0;
+	}
+
+	/* The encoder thread encodes under sw_codec_mtx as well, so the encoder of a
+	 * bidirectional stream is switched between two frames along with the decoder
+	 */
+	ret = sw_codec_switch(&sw_codec_cfg, sw_codec);
+	if (ret) {
+		if (!codec_switch_dropping) {
+			LOG_ERR("Failed to set up %s: %d", ops->name, ret);
+		}
+
+		/* The stream goes on with the previous codec, or with nothing if that
+		 * failed too. Either way the next frame with this codec tries again, and
+		 * a restart falls back to the Kconfig default if nothing is set up
+		 */
+		sw_codec_selected = sw_codec_cfg.initialized;
+		return ret;
+	}
+
+	sw_codec_selected = true;
+	LOG_INF("Switched to %s", ops->name);
+
+	return 0;
+}
+
+int audio_system_codec_set(enum sw_codec_select sw_codec)
+{
+	int ret;
+
+	k_mutex_lock(&sw_codec_mtx, K_FOREVER);
+	ret = codec_switch(sw_codec);
+	k_mutex_unlock(&sw_codec_mtx);
+
+	return ret;
+}
+
+int audio_system_stream_out(enum sw_codec_select sw_codec, const uint8_t *buf, size_t size,
+			    uint32_t recv_frame_ts_us)
+{
+	int ret;
+
+	k_mutex_lock(&sw_codec_mtx, K_FOREVER);
+
+	ret = codec_switch(sw_codec);
+	if (ret) {
+		codec_switch_drops++;
+		if (!codec_switch_dropping) {
+			LOG_WRN("Dropping frames with codec %d: %d", sw_codec, ret);
+			codec_switch_dropping = true;
+		}
+	} else {
+		codec_switch_dropping = false;
+		audio_datapath_stream_out(buf, size, recv_frame_ts_us);
+	}
+
+	k_mutex_unlock(&sw_codec_mtx);
+
+	return ret;
+}
+
 int audio_system_config_set(uint32_t encoder_sample_rate_hz, uint32_t encoder_bitrate,
 			    uint32_t decoder_sample_rate_hz)
 {
@@ -291,6 +521,7 @@ int audio_system_config_set(uint32_t encoder_sample_rate_hz, uint32_t encoder_bi
 	if (encoder_bitrate) {
 		sw_codec_cfg.encoder.enabled = true;
 		sw_codec_cfg.encoder.bitrate = encoder_bitrate;
+		sw_codec_cfg.encoder.complexity = CONFIG_OPUS_COMPLEXITY;
 	}
 
 	return 0;
@@ -310,7 +541,11 @@ int audio_system_decode(void const *const encoded_data, size_t encoded_data_size
 	static void *pcm_raw_data;
 	size_t pcm_block_size;
 
-	if (!sw_codec_cfg.initialized) {
+	k_mutex_lock(&sw_codec_mtx, K_FOREVER);
+	ret = sw_codec_cfg.initialized ? 0 : -EPERM;
+	k_mutex_unlock(&sw_codec_mtx);
+
+	if (ret) {
 		/* Throw away data */
 		/* This can happen when using play/pause since there might be
 		 * some packages left in the buffers
@@ -350,8 +585,12 @@ int audio_system_decode(void const *const encoded_data, size_t encoded_data_size
 		}
 	}
 
+	/* Output is split into FIFO blocks below, let the codec pick the buffer */
+	pcm_raw_data = NULL;
+	k_mutex_lock(&sw_codec_mtx, K_FOREVER);
 	ret = sw_codec_decode(encoded_data, encoded_data_size, bad_frame, &pcm_raw_data,
 			      &pcm_block_size);
+	k_mutex_unlock(&sw_codec_mtx);
 	if (ret) {
 		LOG_ERR("Failed to decode");
 		return ret;
@@ -408,10 +647,13 @@ void audio_system_start(void)
 		ERR_CHK_MSG(ret, "Failed to set up rx FIFO");
 	}
 
+	k_mutex_lock(&sw_codec_mtx, K_FOREVER);
 	ret = sw_codec_init(sw_codec_cfg);
 	ERR_CHK_MSG(ret, "Failed to set up codec");
 
 	sw_codec_cfg.initialized = true;
+	audio_system_started = true;
+	k_mutex_unlock(&sw_codec_mtx);
 
 	if (sw_codec_cfg.encoder.enabled && encoder_thread_id == NULL) {
 		encoder_thread_id = k_thread_create(
@@ -438,8 +680,8 @@ void audio_system_stop(void)
 {
 	int ret;
 
-	if (!sw_codec_cfg.initialized) {
-		LOG_WRN("Codec already unitialized");
+	if (!audio_system_started) {
+		LOG_WRN("Audio system already stopped");
 		return;
 	}
 
@@ -455,9 +697,15 @@ void audio_system_stop(void)
 	ERR_CHK(ret);
 #endif /* ((CONFIG_AUDIO_GATEWAY) && CONFIG_AUDIO_SOURCE_USB) */
 
-	ret = sw_codec_uninit(sw_codec_cfg);
-	ERR_CHK_MSG(ret, "Failed to uninit codec");
-	sw_codec_cfg.initialized = false;
+	k_mutex_lock(&sw_codec_mtx, K_FOREVER);
+	/* A failed codec switch may have left no codec to tear down */
+	if (sw_codec_cfg.initialized) {
+		ret = sw_codec_uninit(sw_codec_cfg);
+		ERR_CHK_MSG(ret, "Failed to uninit codec");
+		sw_codec_cfg.initialized = false;
+	}
+	audio_system_started = false;
+	k_mutex_unlock(&sw_codec_mtx);
 
 	ret = data_fifo_empty(&fifo_rx);
 	ERR_CHK(ret);
@@ -466,7 +714,7 @@ void audio_system_stop(void)
 	ERR_CHK(ret);
 }
 
-int audio_system_fifo_rx_block_drop(void)
+int audio_system_fifo_rx_frame_drop(void)
 {
 	int ret;
 	void *temp;
@@ -474,13 +722,13 @@ int audio_system_fifo_rx_block_drop(void)
 
 	ret = data_fifo_pointer_last_filled_get(&fifo_rx, &temp, &temp_size, K_NO_WAIT);
 	if (ret) {
-		LOG_WRN("Failed to get last filled block");
+		LOG_WRN("Failed to get last filled frame");
 		return -ECANCELED;
 	}
 
 	data_fifo_block_free(&fifo_rx, temp);
 
-	LOG_DBG("Block dropped");
+	LOG_DBG("Frame dropped");
 	return 0;
 }
 
@@ -557,11 +805,108 @@ static int cmd_audio_system_stop(const struct shell *shell, size_t argc, const c
 	return 0;
 }
 
+static int cmd_audio_system_codec(const struct shell *shell, size_t argc, const char **argv)
+{
+	int ret;
+	const struct sw_codec_ops *ops;
+
+	if (argc == 1) {
+		ops = sw_codec_ops_get(sw_codec_cfg.sw_codec);
+		shell_print(shell, "SW codec: %s", ops ? ops->name : "none");
+		if (sw_codec_cfg.decoder.enabled) {
+			shell_print(shell, "Frames dropped on codec switch: %d",
+				    codec_switch_drops);
+		}
+		return 0;
+	}
+
+	for (int i = 0; i < SW_CODEC_NUM; i++) {
+		ops = sw_codec_ops_get(i);
+		if (ops == NULL || strcmp(argv[1], ops->name) != 0) {
+			continue;
+		}
+
+		ret = audio_system_codec_set(i);
+		if (ret) {
+			shell_error(shell, "Failed to select %s: %d", ops->name, ret);
+			return ret;
+		}
+
+		shell_print(shell, "SW codec: %s", ops->name);
+		return 0;
+	}
+
+	shell_error(shell, "Unknown or not compiled in codec: %s", argv[1]);
+
+	return -EINVAL;
+}
+
+static int cmd_audio_system_dtx(const struct shell *shell, size_t argc, const char **argv)
+{
+	ARG_UNUSED(argc);
+	ARG_UNUSED(argv);
+
+	if (!IS_ENABLED(CONFIG_AUDIO_DTX) && !IS_ENABLED(CONFIG_AUDIO_HEADSET)) {
+		shell_error(shell, "DTX is not enabled");
+		return -ENOTSUP;
+	}
+
+	if (IS_ENABLED(CONFIG_AUDIO_DTX) && sw_codec_cfg.encoder.enabled) {
+		shell_print(shell, "TX: %d of %d frames not sent (%d%%), %d keepalives",
+			    dtx.dtx_frames, dtx.frames,
+			    dtx.frames ? (uint32_t)((uint64_t)dtx.dtx_frames * 100 / dtx.frames) : 0,
+			    dtx.keepalives);
+	}
+
+	if (sw_codec_cfg.decoder.enabled) {
+		uint32_t num_blks;
+		uint32_t num_dtx_blks;
+
+		audio_datapath_dtx_stats_get(&num_blks, &num_dtx_blks);
+		shell_print(shell, "RX: %d of %d blocks silent (%d%%)", num_dtx_blks, num_blks,
+			    num_blks ? (uint32_t)((uint64_t)num_dtx_blks * 100 / num_blks) : 0);
+	}
+
+	return 0;
+}
+
+static int cmd_audio_system_capture(const struct shell *shell, size_t argc, const char **argv)
+{
+	ARG_UNUSED(argc);
+	ARG_UNUSED(argv);
+
+	if (!sw_codec_cfg.encoder.enabled) {
+		shell_error(shell, "Encoder is not enabled");
+		return -EPERM;
+	}
+
+	shell_print(shell, "%d frames encoded in place, %llu bytes of gather copy avoided",
+		    capture_stats.frames, (uint64_t)capture_stats.frames * FRAME_SIZE_BYTES);
+	shell_print(shell, "Frame to encoded: last %d us, max %d us, avg %d us",
+		    k_cyc_to_us_floor32(capture_stats.cycles_last),
+		    k_cyc_to_us_floor32(capture_stats.cycles_max),
+		    capture_stats.frames
+			    ? k_cyc_to_us_floor32(capture_stats.cycles_total / capture_stats.frames)
+			    : 0);
+
+	return 0;
+}
+
 SHELL_STATIC_SUBCMD_SET_CREATE(audio_system_cmd,
 			       SHELL_COND_CMD(CONFIG_SHELL, start, NULL, "Start the audio system",
 					      cmd_audio_system_start),
 			       SHELL_COND_CMD(CONFIG_SHELL, stop, NULL, "Stop the audio system",
 					      cmd_audio_system_stop),
+			       SHELL_COND_CMD_ARG(CONFIG_SHELL, codec, NULL,
+						  "Get or set the SW codec "
+						  "<pcm|lc3|opus|lossless|adpcm>",
+						  cmd_audio_system_codec, 1, 1),
+			       SHELL_COND_CMD(CONFIG_SHELL, capture, NULL,
+					      "In place encoding from the capture FIFO",
+					      cmd_audio_system_capture),
+			       SHELL_COND_CMD(CONFIG_SHELL, dtx, NULL,
+					      "Discontinuous transmission duty cycle",
+					      cmd_audio_system_dtx),
 			       SHELL_SUBCMD_SET_END);
 
 SHELL_CMD_REGISTER(audio_system, &audio_system_cmd, "Audio system commands", NULL);
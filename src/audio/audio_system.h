@@ -11,6 +11,8 @@
 #include <stdbool.h>
 #include <stdint.h>
 
+#include "sw_codec_select.h"
+
 #define VALUE_NOT_SET 0
 
 /**
@@ -48,6 +50,40 @@ int audio_system_encode_test_tone_set(uint32_t freq);
  */
 int audio_system_encode_test_tone_step(void);
 
+/**
+ * @brief	Select the software codec.
+ *
+ * @note	Takes effect at the next audio_system_start() if the audio system is
+ *		stopped. A running encoder and decoder are switched at once, between
+ *		two frames, which is how the headset follows the codec of the
+ *		received stream. If the new codec fails to set up, the previous one
+ *		is set up again. If that fails too, no frames are coded until a
+ *		switch succeeds or the audio system is restarted.
+ *
+ * @param[in]	sw_codec	Codec to use.
+ *
+ * @retval	-ENOTSUP	Codec is not compiled in.
+ * @retval	0		On success, else the error of setting up the codec.
+ */
+int audio_system_codec_set(enum sw_codec_select sw_codec);
+
+/**
+ * @brief	Switch the decoder to the codec of a received frame and decode it.
+ *
+ * @note	The codec cannot be switched by audio_system_codec_set() while the frame
+ *		is decoded. Frames that cannot be decoded with their codec are dropped and
+ *		counted, see the audio_system codec shell command.
+ *
+ * @param[in]	sw_codec		Codec the frame is encoded with.
+ * @param[in]	buf			Encoded frame.
+ * @param[in]	size			Size of the encoded frame.
+ * @param[in]	recv_frame_ts_us	Time the frame was received.
+ *
+ * @return	0 on success, error from audio_system_codec_set() if the frame was dropped.
+ */
+int audio_system_stream_out(enum sw_codec_select sw_codec, const uint8_t *buf, size_t size,
+			    uint32_t recv_frame_ts_us);
+
 /**
  * @brief	Set the sample rates for the encoder and the decoder, and the bit rate for encoder.
  *
@@ -85,14 +121,15 @@ void audio_system_start(void);
 void audio_system_stop(void);
 
 /**
- * @brief	Drop oldest block from the fifo_rx buffer.
+ * @brief	Drop the oldest frame from the fifo_rx buffer.
  *
- * @note	This can be used to reduce latency by adjusting the timing of the completed frame
- *		that was sampled in relation to the connection interval in Bluetooth LE.
+ * @note	fifo_rx blocks hold a whole frame, so this drops AUDIO_FRAME_DURATION_US of
+ *		captured audio, not one I2S block. It removes one frame of queued capture
+ *		latency, but the frame boundaries stay where the capture put them.
  *
  * @return	0 on success, -ECANCELED otherwise.
  */
-int audio_system_fifo_rx_block_drop(void);
+int audio_system_fifo_rx_frame_drop(void);
 
 /**
  * @brief	Get number of decoder channels.
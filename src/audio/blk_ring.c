@@ -0,0 +1,96 @@
+/*
+ * Copyright (c) 2025 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#include "blk_ring.h"
+
+#include <zephyr/kernel.h>
+#include <zephyr/sys/barrier.h>
+#include <zephyr/sys/util.h>
+
+/* Indices wrap at the ring size, which does not have to be a power of two */
+static uint32_t idx_add(const struct blk_ring *ring, uint32_t idx, uint32_t num)
+{
+	idx += num;
+
+	return (idx >= ring->size) ? (idx - ring->size) : idx;
+}
+
+static uint32_t idx_diff(const struct blk_ring *ring, uint32_t to, uint32_t from)
+{
+	return (to >= from) ? (to - from) : (to + ring->size - from);
+}
+
+void blk_ring_init(struct blk_ring *ring, uint32_t size)
+{
+	__ASSERT_NO_MSG(size >= 3);
+
+	ring->size = size;
+	atomic_set(&ring->prod, 0);
+	atomic_set(&ring->cons, size - 1);
+}
+
+uint32_t blk_ring_fill(const struct blk_ring *ring)
+{
+	/* Consumer first, it can only move towards the producer meanwhile */
+	uint32_t cons = atomic_get(&ring->cons);
+	uint32_t prod = atomic_get(&ring->prod);
+
+	return idx_diff(ring, prod, cons);
+}
+
+uint32_t blk_ring_space(const struct blk_ring *ring)
+{
+	return ring->size - 1 - blk_ring_fill(ring);
+}
+
+uint32_t blk_ring_prod_idx(const struct blk_ring *ring, uint32_t offset)
+{
+	return idx_add(ring, atomic_get(&ring->prod), offset % ring->size);
+}
+
+uint32_t blk_ring_cons_idx(const struct blk_ring *ring)
+{
+	return atomic_get(&ring->cons);
+}
+
+void blk_ring_produce(struct blk_ring *ring, uint32_t num)
+{
+	__ASSERT_NO_MSG(num <= blk_ring_space(ring));
+
+	/* Samples are in memory before the consumer can see the blocks */
+	barrier_dmem_fence_full();
+	atomic_set(&ring->prod, idx_add(ring, atomic_get(&ring->prod), num));
+}
+
+uint32_t blk_ring_unproduce(struct blk_ring *ring, uint32_t num, uint32_t keep)
+{
+	unsigned int key = irq_lock();
+	uint32_t fill = blk_ring_fill(ring);
+	uint32_t prod = atomic_get(&ring->prod);
+
+	/* The consumer's block is not counted in keep */
+	num = MIN(num, (fill > keep + 1) ? (fill - keep - 1) : 0);
+	atomic_set(&ring->prod, idx_add(ring, prod, ring->size - num));
+	irq_unlock(key);
+
+	return num;
+}
+
+bool blk_ring_consume(struct blk_ring *ring, uint32_t *idx)
+{
+	uint32_t next = idx_add(ring, atomic_get(&ring->cons), 1);
+
+	if (next == (uint32_t)atomic_get(&ring->prod)) {
+		return false;
+	}
+
+	/* Samples are read after the index that published them */
+	barrier_dmem_fence_full();
+	atomic_set(&ring->cons, next);
+	*idx = next;
+
+	return true;
+}
@@ -0,0 +1,116 @@
+/*
+ * Copyright (c) 2025 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#ifndef _BLK_RING_H_
+#define _BLK_RING_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <zephyr/sys/atomic.h>
+
+/**
+ * @brief Block indices of a single producer, single consumer ring.
+ *
+ * @note  The storage belongs to the user, the ring only hands out block
+ *	  indices. The consumer keeps the block it handed out last, which is
+ *	  still being read, and the one before it is not written either, so
+ *	  at most size - 1 blocks are queued and a full ring never looks
+ *	  empty. The producer runs in a thread and the consumer in an ISR or
+ *	  a thread, none of them waits for the other.
+ */
+struct blk_ring {
+	atomic_t prod; /* Next block the producer writes */
+	atomic_t cons; /* Block the consumer handed out last */
+	uint32_t size; /* Number of blocks */
+};
+
+/**
+ * @brief	Reset the ring to empty.
+ *
+ * @note	The consumer holds the last block, the producer writes the first.
+ *
+ * @param[out]	ring	Ring state.
+ * @param[in]	size	Number of blocks, at least 3.
+ */
+void blk_ring_init(struct blk_ring *ring, uint32_t size);
+
+/**
+ * @brief	Number of blocks from the one the consumer handed out last to the
+ *		producer.
+ *
+ * @note	Safe in both contexts. Exact for the consumer, and at most the
+ *		blocks consumed meanwhile too high for the producer.
+ *
+ * @param[in]	ring	Ring state.
+ *
+ * @return	1 when empty, up to size - 1.
+ */
+uint32_t blk_ring_fill(const struct blk_ring *ring);
+
+/**
+ * @brief	Blocks the producer can write without reaching the consumer.
+ *
+ * @param[in]	ring	Ring state.
+ *
+ * @return	size - 1 - fill.
+ */
+uint32_t blk_ring_space(const struct blk_ring *ring);
+
+/**
+ * @brief	Index of a block after the last one produced, for the producer.
+ *
+ * @param[in]	ring	Ring state.
+ * @param[in]	offset	Blocks after the producer index.
+ *
+ * @return	Block index.
+ */
+uint32_t blk_ring_prod_idx(const struct blk_ring *ring, uint32_t offset);
+
+/**
+ * @brief	Index of the block the consumer handed out last.
+ *
+ * @param[in]	ring	Ring state.
+ *
+ * @return	Block index.
+ */
+uint32_t blk_ring_cons_idx(const struct blk_ring *ring);
+
+/**
+ * @brief	Hand written blocks over to the consumer.
+ *
+ * @note	The blocks are written before the index moves, so the consumer
+ *		never sees a block before its samples.
+ *
+ * @param[in,out]	ring	Ring state.
+ * @param[in]		num	Blocks written, at most blk_ring_space().
+ */
+void blk_ring_produce(struct blk_ring *ring, uint32_t num);
+
+/**
+ * @brief	Take back blocks produced but not consumed yet.
+ *
+ * @note	Locks interrupts for a few instructions, so the consumer cannot
+ *		move while the producer index goes back.
+ *
+ * @param[in,out]	ring	Ring state.
+ * @param[in]		num	Blocks to take back.
+ * @param[in]		keep	Blocks left queued after the consumer's.
+ *
+ * @return	Blocks taken back.
+ */
+uint32_t blk_ring_unproduce(struct blk_ring *ring, uint32_t num, uint32_t keep);
+
+/**
+ * @brief	Move the consumer to the next block if there is one.
+ *
+ * @param[in,out]	ring	Ring state.
+ * @param[out]		idx	Index of the block to read.
+ *
+ * @return	true if a block was taken, false if the ring is empty.
+ */
+bool blk_ring_consume(struct blk_ring *ring, uint32_t *idx);
+
+#endif /* _BLK_RING_H_ */
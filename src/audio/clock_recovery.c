@@ -0,0 +1,99 @@
+/*
+ * Copyright (c) 2025 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#include "clock_recovery.h"
+
+#include <zephyr/sys/util.h>
+
+/* Fill level smoothing, new windows weigh 1/2^FILL_SHIFT */
+#define FILL_SHIFT	    3
+/* Windows averaged before the target is taken, covers the smoothing */
+#define CALIB_WINDOWS	    20
+/* Proportional gain, 1/1000 ppm per us of fill error */
+#define KP_MPPM_PER_US	    200
+/* Integral gain, 1/1000 ppm per us of fill error and window. With the FIFO
+ * moving 0.1 us per ppm and window, this damps the loop by about 0.7 and
+ * locks on 200 ppm of drift in about 25 s.
+ */
+#define KI_MPPM_PER_US	    2
+/* Largest correction, about a third of the audio PLL range */
+#define CORR_MAX_MPPM	    (3000 * 1000)
+/* Lock when the error stays below LOCK_US for LOCK_WINDOWS, unlock above UNLOCK_US */
+#define LOCK_US		    250
+#define LOCK_WINDOWS	    20
+#define UNLOCK_US	    1000
+
+void clock_recovery_init(struct clock_recovery *cr)
+{
+	*cr = (struct clock_recovery){0};
+}
+
+void clock_recovery_restart(struct clock_recovery *cr)
+{
+	cr->state = CLOCK_RECOVERY_STATE_INIT;
+	cr->ctr = 0;
+}
+
+int32_t clock_recovery_drift_mppm(const struct clock_recovery *cr)
+{
+	return (int32_t)(cr->err_sum * KI_MPPM_PER_US);
+}
+
+int32_t clock_recovery_err_us(const struct clock_recovery *cr)
+{
+	if (cr->state < CLOCK_RECOVERY_STATE_TRACK) {
+		return 0;
+	}
+
+	return (cr->fill_q4_us >> 4) - cr->target_us;
+}
+
+int32_t clock_recovery_update(struct clock_recovery *cr, int32_t fill_us)
+{
+	int32_t err_us;
+	int64_t sum_max = CORR_MAX_MPPM / KI_MPPM_PER_US;
+
+	switch (cr->state) {
+	case CLOCK_RECOVERY_STATE_INIT:
+		cr->fill_q4_us = fill_us << 4;
+		cr->ctr = 0;
+		cr->state = CLOCK_RECOVERY_STATE_CALIB;
+		/* Hold the drift estimate until there is a target */
+		return clock_recovery_drift_mppm(cr);
+	case CLOCK_RECOVERY_STATE_CALIB:
+		cr->fill_q4_us += ((fill_us << 4) - cr->fill_q4_us) >> FILL_SHIFT;
+		if (++cr->ctr < CALIB_WINDOWS) {
+			return clock_recovery_drift_mppm(cr);
+		}
+
+		cr->target_us = cr->fill_q4_us >> 4;
+		cr->ctr = 0;
+		cr->state = CLOCK_RECOVERY_STATE_TRACK;
+		return clock_recovery_drift_mppm(cr);
+	default:
+		break;
+	}
+
+	cr->fill_q4_us += ((fill_us << 4) - cr->fill_q4_us) >> FILL_SHIFT;
+	err_us = clock_recovery_err_us(cr);
+
+	/* A fill level above the target means the sender is faster, speed up */
+	cr->err_sum = CLAMP(cr->err_sum + err_us, -sum_max, sum_max);
+	cr->corr_mppm = CLAMP((int64_t)err_us * KP_MPPM_PER_US + clock_recovery_drift_mppm(cr),
+			      -CORR_MAX_MPPM, CORR_MAX_MPPM);
+
+	if (cr->state == CLOCK_RECOVERY_STATE_TRACK) {
+		cr->ctr = (err_us < LOCK_US && err_us > -LOCK_US) ? cr->ctr + 1 : 0;
+		if (cr->ctr >= LOCK_WINDOWS) {
+			cr->state = CLOCK_RECOVERY_STATE_LOCKED;
+		}
+	} else if (err_us > UNLOCK_US || err_us < -UNLOCK_US) {
+		cr->ctr = 0;
+		cr->state = CLOCK_RECOVERY_STATE_TRACK;
+	}
+
+	return cr->corr_mppm;
+}
@@ -0,0 +1,84 @@
+/*
+ * Copyright (c) 2025 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#ifndef _CLOCK_RECOVERY_H_
+#define _CLOCK_RECOVERY_H_
+
+#include <stdint.h>
+
+/* Time between two updates of the loop */
+#define CLOCK_RECOVERY_WINDOW_US 100000
+
+enum clock_recovery_state {
+	CLOCK_RECOVERY_STATE_INIT,   /* Waiting for the first fill level */
+	CLOCK_RECOVERY_STATE_CALIB,  /* Taking the settled fill level as the target */
+	CLOCK_RECOVERY_STATE_TRACK,  /* Steering the fill level towards the target */
+	CLOCK_RECOVERY_STATE_LOCKED, /* Fill level held close to the target */
+};
+
+/**
+ * @brief PI loop recovering the sender clock from the fill level of a FIFO.
+ *
+ * @note  The FIFO is filled at the sender rate and drained at the local rate,
+ *	  so its fill level integrates the rate difference. Positive corrections
+ *	  ask for a faster local clock.
+ */
+struct clock_recovery {
+	enum clock_recovery_state state;
+	uint16_t ctr;	      /* Windows spent in the current state */
+	int32_t target_us;    /* Fill level the loop holds */
+	int32_t fill_q4_us;   /* Smoothed fill level, 1/16 us */
+	int64_t err_sum;      /* Integral of the fill error, us times windows */
+	int32_t corr_mppm;    /* Last correction, 1/1000 ppm */
+};
+
+/**
+ * @brief	Reset the loop, forgetting the drift estimate.
+ *
+ * @param[out]	cr	Loop state.
+ */
+void clock_recovery_init(struct clock_recovery *cr);
+
+/**
+ * @brief	Learn a new target fill level, keeping the drift estimate.
+ *
+ * @note	Call when the fill level jumps for another reason than drift,
+ *		after an under-run or when the sender resumes after silence.
+ *
+ * @param[in,out]	cr	Loop state.
+ */
+void clock_recovery_restart(struct clock_recovery *cr);
+
+/**
+ * @brief	Run the loop once per CLOCK_RECOVERY_WINDOW_US.
+ *
+ * @param[in,out]	cr	Loop state.
+ * @param[in]		fill_us	Average fill level over the last window.
+ *
+ * @return	Clock correction in 1/1000 ppm, positive for a faster local clock.
+ */
+int32_t clock_recovery_update(struct clock_recovery *cr, int32_t fill_us);
+
+/**
+ * @brief	Drift of the sender clock against the local one, the integral part
+ *		of the correction.
+ *
+ * @param[in]	cr	Loop state.
+ *
+ * @return	Drift in 1/1000 ppm, positive if the sender runs faster.
+ */
+int32_t clock_recovery_drift_mppm(const struct clock_recovery *cr);
+
+/**
+ * @brief	Fill level error against the target.
+ *
+ * @param[in]	cr	Loop state.
+ *
+ * @return	Smoothed fill level minus target in us.
+ */
+int32_t clock_recovery_err_us(const struct clock_recovery *cr);
+
+#endif /* _CLOCK_RECOVERY_H_ */
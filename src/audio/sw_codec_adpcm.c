@@ -0,0 +1,269 @@
+/*
+ * Copyright (c) 2025 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+/** @file
+ * @brief IMA ADPCM codec
+ *
+ * Codes each 16 bit sample to 4 bits, with no look-ahead and no framing
+ * constraint, so a frame can hold any number of samples. Every frame starts
+ * with the predictor state of each channel, so it decodes on its own and a
+ * lost frame does not corrupt the next one.
+ *
+ * Frame: one block per channel, each a 4 byte header (predictor, little
+ * endian, step index and channel count) followed by two samples per byte,
+ * the first one in the low nibble.
+ */
+
+#include "sw_codec_select.h"
+
+#include <zephyr/kernel.h>
+#include <errno.h>
+#include <string.h>
+
+#include <zephyr/logging/log.h>
+LOG_MODULE_DECLARE(sw_codec_select, CONFIG_SW_CODEC_SELECT_LOG_LEVEL);
+
+#define ADPCM_HDR_SIZE  4
+#define ADPCM_INDEX_MAX 88
+/* Encoded size of one channel with the given number of samples */
+#define ADPCM_BLOCK_SIZE(samples) (ADPCM_HDR_SIZE + (samples) / 2)
+
+struct adpcm_state {
+	int16_t predictor;
+	uint8_t index;
+};
+
+static const int8_t index_table[8] = {-1, -1, -1, -1, 2, 4, 6, 8};
+
+static const uint16_t step_table[ADPCM_INDEX_MAX + 1] = {
+	7,     8,     9,     10,    11,    12,    13,    14,    16,    17,    19,    21,    23,
+	25,    28,    31,    34,    37,    41,    45,    50,    55,    60,    66,    73,    80,
+	88,    97,    107,   118,   130,   143,   157,   173,   190,   209,   230,   253,   279,
+	307,   337,   371,   408,   449,   494,   544,   598,   658,   724,   796,   876,   963,
+	1060,  1166,  1282,  1411,  1552,  1707,  1878,  2066,  2272,  2499,  2749,  3024,  3327,
+	3660,  4026,  4428,  4871,  5358,  5894,  6484,  7132,  7845,  8630,  9493,  10442, 11487,
+	12635, 13899, 15289, 16818, 18500, 20350, 22385, 24623, 27086, 29794, 32767};
+
+static struct adpcm_state enc_state[AUDIO_CH_NUM];
+static uint8_t enc_buf[ADPCM_BLOCK_SIZE(PCM_NUM_BYTES_MONO / sizeof(int16_t)) * AUDIO_CH_NUM];
+static int16_t dec_buf[PCM_NUM_BYTES_STEREO / sizeof(int16_t)];
+static char pcm_data_plc[PCM_NUM_BYTES_STEREO];
+
+/**
+ * @brief Update the predictor and step index with one coded sample.
+ */
+static inline void adpcm_state_update(struct adpcm_state *st, uint8_t nibble)
+{
+	uint16_t step = step_table[st->index];
+	int32_t delta = step >> 3;
+	int32_t predictor;
+	int32_t index;
+
+	if (nibble & 4) {
+		delta += step;
+	}
+	if (nibble & 2) {
+		delta += step >> 1;
+	}
+	if (nibble & 1) {
+		delta += step >> 2;
+	}
+
+	predictor = st->predictor + ((nibble & 8) ? -delta : delta);
+	st->predictor = CLAMP(predictor, INT16_MIN, INT16_MAX);
+
+	index = st->index + index_table[nibble & 7];
+	st->index = CLAMP(index, 0, ADPCM_INDEX_MAX);
+}
+
+static inline uint8_t adpcm_sample_encode(struct adpcm_state *st, int16_t sample)
+{
+	int32_t diff = sample - st->predictor;
+	uint16_t step = step_table[st->index];
+	uint8_t nibble = 0;
+
+	if (diff < 0) {
+		nibble = 8;
+		diff = -diff;
+	}
+
+	/* Quantize the difference to step, step / 2 and step / 4 */
+	for (uint8_t bit = 4; bit; bit >>= 1) {
+		if (diff >= step) {
+			nibble |= bit;
+			diff -= step;
+		}
+		step >>= 1;
+	}
+
+	/* Track the decoder, so both sides stay in step */
+	adpcm_state_update(st, nibble);
+
+	return nibble;
+}
+
+static void adpcm_block_encode(struct adpcm_state *st, const int16_t *pcm, uint8_t stride,
+			       uint32_t samples, uint8_t num_ch, uint8_t *out)
+{
+	out[0] = (uint8_t)st->predictor;
+	out[1] = (uint8_t)((uint16_t)st->predictor >> 8);
+	out[2] = st->index;
+	out[3] = num_ch;
+	out += ADPCM_HDR_SIZE;
+
+	for (uint32_t n = 0; n < samples; n += 2) {
+		uint8_t lo = adpcm_sample_encode(st, pcm[n * stride]);
+		uint8_t hi = adpcm_sample_encode(st, pcm[(n + 1) * stride]);
+
+		*out++ = lo | (hi << 4);
+	}
+}
+
+static int adpcm_block_decode(const uint8_t *in, uint32_t samples, uint8_t stride,
+			      int16_t *pcm)
+{
+	struct adpcm_state st = {
+		.predictor = (int16_t)(in[0] | (in[1] << 8)),
+		.index = in[2],
+	};
+
+	if (st.index > ADPCM_INDEX_MAX) {
+		return -EINVAL;
+	}
+
+	in += ADPCM_HDR_SIZE;
+
+	for (uint32_t n = 0; n < samples; n += 2) {
+		adpcm_state_update(&st, *in & 0x0F);
+		pcm[n * stride] = st.predictor;
+		adpcm_state_update(&st, *in++ >> 4);
+		pcm[(n + 1) * stride] = st.predictor;
+	}
+
+	return 0;
+}
+
+static int adpcm_init(const struct sw_codec_config *cfg)
+{
+	ARG_UNUSED(cfg);
+
+	memset(enc_state, 0, sizeof(enc_state));
+
+	LOG_INF("IMA ADPCM, 4 bits per sample");
+
+	return 0;
+}
+
+static int adpcm_uninit(const struct sw_codec_config *cfg)
+{
+	ARG_UNUSED(cfg);
+
+	return 0;
+}
+
+static int adpcm_encode(const struct sw_codec_config *cfg, void *pcm_data, size_t pcm_size,
+			uint8_t **encoded_data, size_t *encoded_size)
+{
+	const int16_t *pcm = pcm_data;
+	uint32_t samples = pcm_size / (AUDIO_CH_NUM * sizeof(int16_t));
+
+	if (samples > PCM_NUM_BYTES_MONO / sizeof(int16_t) || (samples % 2)) {
+		LOG_ERR("PCM frame has wrong size: %d", pcm_size);
+		return -EINVAL;
+	}
+
+	switch (cfg->encoder.channel_mode) {
+	case SW_CODEC_MONO: {
+		adpcm_block_encode(&enc_state[0], pcm + cfg->encoder.audio_ch, AUDIO_CH_NUM,
+				   samples, 1, enc_buf);
+		*encoded_size = ADPCM_BLOCK_SIZE(samples);
+		break;
+	}
+	case SW_CODEC_STEREO: {
+		for (uint8_t c = 0; c < AUDIO_CH_NUM; c++) {
+			adpcm_block_encode(&enc_state[c], pcm + c, AUDIO_CH_NUM, samples,
+					   AUDIO_CH_NUM, &enc_buf[c * ADPCM_BLOCK_SIZE(samples)]);
+		}
+		*encoded_size = ADPCM_BLOCK_SIZE(samples) * AUDIO_CH_NUM;
+		break;
+	}
+	default:
+		LOG_ERR("Unsupported channel mode for encoder: %d", cfg->encoder.channel_mode);
+		return -ENODEV;
+	}
+
+	*encoded_data = enc_buf;
+
+	return 0;
+}
+
+static int adpcm_decode(const struct sw_codec_config *cfg, uint8_t const *const encoded_data,
+			size_t encoded_size, void **pcm_data, size_t *pcm_size)
+{
+	int ret;
+	int16_t *out = (*pcm_data != NULL) ? *pcm_data : dec_buf;
+	uint8_t num_ch;
+	size_t block_size;
+	uint32_t samples;
+
+	ARG_UNUSED(cfg);
+
+	if (encoded_size < ADPCM_HDR_SIZE) {
+		LOG_ERR("ADPCM frame has wrong size: %d", encoded_size);
+		return -EINVAL;
+	}
+
+	/* Any frame length works, the size gives the number of samples */
+	num_ch = encoded_data[3];
+	block_size = (num_ch != 0) ? (encoded_size / num_ch) : 0;
+	samples = (block_size - ADPCM_HDR_SIZE) * 2;
+	if (num_ch == 0 || num_ch > AUDIO_CH_NUM || (encoded_size % num_ch) ||
+	    block_size <= ADPCM_HDR_SIZE ||
+	    samples * num_ch * sizeof(int16_t) > PCM_NUM_BYTES_STEREO) {
+		LOG_ERR("ADPCM frame has wrong size: %d", encoded_size);
+		return -EINVAL;
+	}
+
+	for (uint8_t c = 0; c < num_ch; c++) {
+		ret = adpcm_block_decode(&encoded_data[c * block_size], samples, num_ch, out + c);
+		if (ret) {
+			LOG_WRN("Corrupt ADPCM frame");
+			return ret;
+		}
+	}
+
+	*pcm_data = out;
+	*pcm_size = samples * num_ch * sizeof(int16_t);
+
+	return 0;
+}
+
+static int adpcm_plc(const struct sw_codec_config *cfg, void **pcm_data, size_t *pcm_size)
+{
+	/* Nothing to conceal from, play silence */
+	*pcm_data = pcm_data_plc;
+	*pcm_size =
+		PCM_NUM_BYTES_MONO_RATE(cfg->decoder.sample_rate_hz) * cfg->decoder.num_ch;
+
+	return 0;
+}
+
+static size_t adpcm_frame_size_get(const struct sw_codec_config *cfg)
+{
+	return ADPCM_BLOCK_SIZE(PCM_NUM_BYTES_MONO_RATE(cfg->encoder.sample_rate_hz) /
+				sizeof(int16_t)) *
+	       cfg->encoder.num_ch;
+}
+
+const struct sw_codec_ops sw_codec_adpcm_ops = {
+	.name = "adpcm",
+	.init = adpcm_init,
+	.uninit = adpcm_uninit,
+	.encode = adpcm_encode,
+	.decode = adpcm_decode,
+	.plc = adpcm_plc,
+	.frame_size_get = adpcm_frame_size_get,
+};
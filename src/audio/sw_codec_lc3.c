@@ -0,0 +1,499 @@
+/*
+ * Copyright (c) 2024 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#include "sw_codec_lc3.h"
+#include "sw_codec_select.h"
+
+#include <zephyr/kernel.h>
+#include <errno.h>
+#include <pcm_stream_channel_modifier.h>
+#include <LC3API.h>
+
+#include <zephyr/logging/log.h>
+LOG_MODULE_DECLARE(sw_codec_select, CONFIG_SW_CODEC_SELECT_LOG_LEVEL);
+
+/* Sessions are per channel, one extra decoder channel for SD card playback */
+#define LC3_SESSIONS_MAX (AUDIO_CH_NUM + 1)
+
+static LC3EncoderHandle_t enc_handle_ch[LC3_SESSIONS_MAX];
+static LC3DecoderHandle_t dec_handle_ch[LC3_SESSIONS_MAX];
+static uint32_t enc_bitrate_init;
+static bool lc3_initialized;
+
+static int lc3_framesize_get(uint16_t framesize_us, LC3FrameSize_t *framesize)
+{
+	switch (framesize_us) {
+	case 7500:
+		*framesize = LC3FrameSize7_5Ms;
+		return 0;
+	case 10000:
+		*framesize = LC3FrameSize10Ms;
+		return 0;
+	default:
+		LOG_ERR("Unsupported LC3 frame size: %d us", framesize_us);
+		return -EINVAL;
+	}
+}
+
+int sw_codec_lc3_init(uint8_t *sw_codec_lc3_buffer, uint32_t *sw_codec_lc3_buffer_size,
+		      uint16_t framesize_us)
+{
+	LC3Result_t result;
+	LC3FrameSizeConfig_t framesize;
+	uint8_t enc_sample_rates;
+	uint8_t dec_sample_rates;
+
+	if (lc3_initialized) {
+		return 0;
+	}
+
+	switch (framesize_us) {
+	case 7500:
+		framesize = LC3FrameSize7_5MsConfig;
+		break;
+	case 10000:
+		framesize = LC3FrameSize10MsConfig;
+		break;
+	default:
+		LOG_ERR("Unsupported LC3 frame size: %d us", framesize_us);
+		return -EINVAL;
+	}
+
+	/* Codec rates are configured later, support all the system accepts */
+	enc_sample_rates = LC3_SAMPLE_RATE_16_KHZ | LC3_SAMPLE_RATE_24_KHZ | LC3_SAMPLE_RATE_48_KHZ;
+	dec_sample_rates = enc_sample_rates;
+
+	/* Unique sessions set to 0 to let encoder and decoder share memory */
+	result = LC3Initialize(enc_sample_rates, dec_sample_rates, framesize, 0,
+			       sw_codec_lc3_buffer, sw_codec_lc3_buffer_size);
+	if (result != LC3_RESULT_OK) {
+		LOG_ERR("LC3 init failed: %d", result);
+		return -EIO;
+	}
+
+	lc3_initialized = true;
+
+	return 0;
+}
+
+int sw_codec_lc3_deinit(void)
+{
+	LC3Result_t result;
+
+	if (!lc3_initialized) {
+		return 0;
+	}
+
+	result = LC3Deinitialize();
+	if (result != LC3_RESULT_OK) {
+		LOG_ERR("LC3 deinit failed: %d", result);
+		return -EIO;
+	}
+
+	lc3_initialized = false;
+
+	return 0;
+}
+
+int sw_codec_lc3_enc_init(uint16_t pcm_sample_rate, uint8_t pcm_bit_depth, uint16_t framesize_us,
+			  uint32_t enc_bitrate, uint8_t num_channels, uint16_t *const pcm_bytes_req)
+{
+	int ret;
+	LC3Result_t result;
+	LC3FrameSize_t framesize;
+
+	if (num_channels > LC3_SESSIONS_MAX) {
+		return -EINVAL;
+	}
+
+	ret = lc3_framesize_get(framesize_us, &framesize);
+	if (ret) {
+		return ret;
+	}
+
+	*pcm_bytes_req = LC3PCMBuffSize(pcm_sample_rate, framesize_us, pcm_bit_depth);
+
+	for (uint8_t i = 0; i < num_channels; i++) {
+		if (enc_handle_ch[i] != NULL) {
+			LOG_WRN("LC3 enc ch: %d already initialized", i);
+			return -EALREADY;
+		}
+
+		enc_handle_ch[i] = LC3EncodeSessionOpen(pcm_sample_rate, pcm_bit_depth, framesize,
+							NULL, NULL, &result);
+		if (result != LC3_RESULT_OK) {
+			LOG_ERR("LC3 enc ch: %d open failed: %d", i, result);
+			sw_codec_lc3_enc_uninit_all();
+			return -EIO;
+		}
+	}
+
+	enc_bitrate_init = enc_bitrate;
+
+	return 0;
+}
+
+int sw_codec_lc3_dec_init(uint16_t pcm_sample_rate, uint8_t pcm_bit_depth, uint16_t framesize_us,
+			  uint8_t num_channels)
+{
+	int ret;
+	LC3Result_t result;
+	LC3FrameSize_t framesize;
+
+	if (num_channels > LC3_SESSIONS_MAX) {
+		return -EINVAL;
+	}
+
+	ret = lc3_framesize_get(framesize_us, &framesize);
+	if (ret) {
+		return ret;
+	}
+
+	for (uint8_t i = 0; i < num_channels; i++) {
+		if (dec_handle_ch[i] != NULL) {
+			LOG_WRN("LC3 dec ch: %d already initialized", i);
+			return -EALREADY;
+		}
+
+		dec_handle_ch[i] = LC3DecodeSessionOpen(pcm_sample_rate, pcm_bit_depth, framesize,
+							NULL, NULL, &result);
+		if (result != LC3_RESULT_OK) {
+			LOG_ERR("LC3 dec ch: %d open failed: %d", i, result);
+			sw_codec_lc3_dec_uninit_all();
+			return -EIO;
+		}
+	}
+
+	return 0;
+}
+
+int sw_codec_lc3_enc_run(void const *const pcm_in, uint32_t pcm_in_size, uint32_t enc_bitrate,
+			 uint8_t audio_ch, uint16_t lc3_out_size, uint8_t *const lc3_out,
+			 uint16_t *const lc3_out_wr_size)
+{
+	LC3Result_t result;
+	LC3EncodeInput_t enc_input;
+	LC3EncodeOutput_t enc_output;
+
+	if (audio_ch >= LC3_SESSIONS_MAX || enc_handle_ch[audio_ch] == NULL) {
+		LOG_DBG("LC3 enc ch: %d is not initialized", audio_ch);
+		return -EPERM;
+	}
+
+	if (enc_bitrate == LC3_USE_BITRATE_FROM_INIT) {
+		enc_bitrate = enc_bitrate_init;
+	}
+
+	enc_input.PCMData = (void *)pcm_in;
+	enc_input.PCMDataLength = pcm_in_size;
+	enc_input.encodeBitrate = enc_bitrate;
+	enc_output.outputData = lc3_out;
+	enc_output.outputDataLength = lc3_out_size;
+
+	result = LC3EncodeSessionData(enc_handle_ch[audio_ch], &enc_input, &enc_output);
+	if (result != LC3_RESULT_OK) {
+		LOG_WRN("LC3 enc ch: %d failed: %d", audio_ch, result);
+		return -EIO;
+	}
+
+	*lc3_out_wr_size = enc_output.bytesWritten;
+
+	return 0;
+}
+
+int sw_codec_lc3_dec_run(uint8_t const *const lc3_frame, uint16_t lc3_frame_size,
+			 uint16_t pcm_data_buf_size, uint8_t audio_ch, void *const pcm_data,
+			 uint16_t *const pcm_data_wr_size, bool bad_frame)
+{
+	LC3Result_t result;
+	LC3DecodeInput_t dec_input;
+	LC3DecodeOutput_t dec_output;
+
+	if (audio_ch >= LC3_SESSIONS_MAX || dec_handle_ch[audio_ch] == NULL) {
+		LOG_DBG("LC3 dec ch: %d is not initialized", audio_ch);
+		return -EPERM;
+	}
+
+	dec_input.inputData = (void *)lc3_frame;
+	dec_input.inputDataLength = lc3_frame_size;
+	dec_input.frameStatus = bad_frame ? BadFrame : GoodFrame;
+	dec_output.PCMData = pcm_data;
+	dec_output.PCMDataLength = pcm_data_buf_size;
+
+	result = LC3DecodeSessionData(dec_handle_ch[audio_ch], &dec_input, &dec_output);
+	if (result != LC3_RESULT_OK) {
+		LOG_WRN("LC3 dec ch: %d failed: %d", audio_ch, result);
+		return -EIO;
+	}
+
+	*pcm_data_wr_size = dec_output.bytesWritten;
+
+	return 0;
+}
+
+int sw_codec_lc3_enc_uninit_all(void)
+{
+	for (uint8_t i = 0; i < LC3_SESSIONS_MAX; i++) {
+		if (enc_handle_ch[i] != NULL) {
+			LC3EncodeSessionClose(enc_handle_ch[i]);
+			enc_handle_ch[i] = NULL;
+		}
+	}
+
+	return 0;
+}
+
+int sw_codec_lc3_dec_uninit_all(void)
+{
+	for (uint8_t i = 0; i < LC3_SESSIONS_MAX; i++) {
+		if (dec_handle_ch[i] != NULL) {
+			LC3DecodeSessionClose(dec_handle_ch[i]);
+			dec_handle_ch[i] = NULL;
+		}
+	}
+
+	return 0;
+}
+
+/* LC3 codes each channel on its own, the bitrate is split between them */
+static uint32_t lc3_bitrate_per_ch(const struct sw_codec_config *cfg)
+{
+	return CLAMP(cfg->encoder.bitrate / cfg->encoder.num_ch, CONFIG_LC3_BITRATE_MIN,
+		     CONFIG_LC3_BITRATE_MAX);
+}
+
+/* Decoder channels of the stream, SD card playback decodes on one more session after them */
+static uint8_t lc3_dec_stream_ch(const struct sw_codec_config *cfg)
+{
+	return cfg->decoder.num_ch - (IS_ENABLED(CONFIG_SD_CARD_PLAYBACK) ? 1 : 0);
+}
+
+static int lc3_init(const struct sw_codec_config *cfg)
+{
+	int ret;
+
+	ret = sw_codec_lc3_init(NULL, NULL, CONFIG_AUDIO_FRAME_DURATION_US);
+	if (ret) {
+		return ret;
+	}
+
+	if (cfg->encoder.enabled) {
+		uint16_t pcm_bytes_req_enc;
+
+		if (lc3_bitrate_per_ch(cfg) * cfg->encoder.num_ch != cfg->encoder.bitrate) {
+			LOG_WRN("LC3 bitrate limited to %d bps per channel",
+				lc3_bitrate_per_ch(cfg));
+		}
+
+		LOG_INF("Encode: %dHz %dbits %dus %dbps %d channel(s)",
+			cfg->encoder.sample_rate_hz, CONFIG_AUDIO_BIT_DEPTH_BITS,
+			CONFIG_AUDIO_FRAME_DURATION_US, lc3_bitrate_per_ch(cfg),
+			cfg->encoder.num_ch);
+
+		ret = sw_codec_lc3_enc_init(cfg->encoder.sample_rate_hz,
+					    CONFIG_AUDIO_BIT_DEPTH_BITS,
+					    CONFIG_AUDIO_FRAME_DURATION_US, lc3_bitrate_per_ch(cfg),
+					    cfg->encoder.num_ch, &pcm_bytes_req_enc);
+		if (ret) {
+			sw_codec_lc3_deinit();
+			return ret;
+		}
+	}
+
+	if (cfg->decoder.enabled) {
+		LOG_INF("Decode: %dHz %dbits %dus %d channel(s)", cfg->decoder.sample_rate_hz,
+			CONFIG_AUDIO_BIT_DEPTH_BITS, CONFIG_AUDIO_FRAME_DURATION_US,
+			cfg->decoder.num_ch);
+
+		ret = sw_codec_lc3_dec_init(cfg->decoder.sample_rate_hz,
+					    CONFIG_AUDIO_BIT_DEPTH_BITS,
+					    CONFIG_AUDIO_FRAME_DURATION_US, cfg->decoder.num_ch);
+		if (ret) {
+			sw_codec_lc3_enc_uninit_all();
+			sw_codec_lc3_deinit();
+			return ret;
+		}
+	}
+
+	return 0;
+}
+
+static int lc3_uninit(const struct sw_codec_config *cfg)
+{
+	int ret;
+
+	if (cfg->encoder.enabled) {
+		ret = sw_codec_lc3_enc_uninit_all();
+		if (ret) {
+			return ret;
+		}
+	}
+
+	if (cfg->decoder.enabled) {
+		ret = sw_codec_lc3_dec_uninit_all();
+		if (ret) {
+			return ret;
+		}
+	}
+
+	return sw_codec_lc3_deinit();
+}
+
+static int lc3_encode(const struct sw_codec_config *cfg, void *pcm_data, size_t pcm_size,
+		      uint8_t **encoded_data, size_t *encoded_size)
+{
+	int ret;
+	/* Temp storage for split stereo PCM signal */
+	static char pcm_data_mono[AUDIO_CH_NUM][PCM_NUM_BYTES_MONO];
+	static uint8_t m_encoded_data[ENC_MAX_FRAME_SIZE * AUDIO_CH_NUM];
+	size_t pcm_block_size_mono;
+	uint16_t encoded_bytes_written;
+	size_t encoded_bytes_total = 0;
+
+	if (cfg->encoder.num_ch == 0 || cfg->encoder.num_ch > AUDIO_CH_NUM) {
+		LOG_ERR("Unsupported number of encoder channels: %d", cfg->encoder.num_ch);
+		return -EINVAL;
+	}
+
+	switch (cfg->encoder.channel_mode) {
+	case SW_CODEC_MONO: {
+		ret = pscm_one_channel_split(pcm_data, pcm_size, cfg->encoder.audio_ch,
+					     CONFIG_AUDIO_BIT_DEPTH_BITS, pcm_data_mono[AUDIO_CH_L],
+					     &pcm_block_size_mono);
+		if (ret) {
+			return ret;
+		}
+		break;
+	}
+	case SW_CODEC_STEREO: {
+		ret = pscm_two_channel_split(pcm_data, pcm_size, CONFIG_AUDIO_BIT_DEPTH_BITS,
+					     pcm_data_mono[AUDIO_CH_L], pcm_data_mono[AUDIO_CH_R],
+					     &pcm_block_size_mono);
+		if (ret) {
+			return ret;
+		}
+		break;
+	}
+	default:
+		LOG_ERR("Unsupported channel mode for encoder: %d", cfg->encoder.channel_mode);
+		return -ENODEV;
+	}
+
+	/* Channels are sent back to back, each frame has the same size with CBR */
+	for (int i = 0; i < cfg->encoder.num_ch; i++) {
+		ret = sw_codec_lc3_enc_run(pcm_data_mono[i], pcm_block_size_mono,
+					   LC3_USE_BITRATE_FROM_INIT, i,
+					   sizeof(m_encoded_data) - encoded_bytes_total,
+					   m_encoded_data + encoded_bytes_total,
+					   &encoded_bytes_written);
+		if (ret) {
+			return ret;
+		}
+
+		encoded_bytes_total += encoded_bytes_written;
+	}
+
+	*encoded_data = m_encoded_data;
+	*encoded_size = encoded_bytes_total;
+
+	return 0;
+}
+
+static int lc3_decode_frame(const struct sw_codec_config *cfg, uint8_t const *const encoded_data,
+			    size_t encoded_size, bool bad_frame, void **pcm_data,
+			    size_t *pcm_size)
+{
+	int ret;
+	static char pcm_data_mono[AUDIO_CH_NUM][PCM_NUM_BYTES_MONO];
+	static char pcm_data_stereo[PCM_NUM_BYTES_STEREO];
+	uint8_t num_ch = lc3_dec_stream_ch(cfg);
+	size_t ch_size;
+	uint16_t pcm_size_mono;
+	/* Mono is decoded and stereo is combined in place if the caller gave a buffer */
+	char *pcm_out = *pcm_data;
+
+	if (cfg->decoder.channel_mode != SW_CODEC_MONO &&
+	    cfg->decoder.channel_mode != SW_CODEC_STEREO) {
+		LOG_ERR("Unsupported channel mode for decoder: %d", cfg->decoder.channel_mode);
+		return -ENODEV;
+	}
+
+	if (num_ch == 0 || num_ch > AUDIO_CH_NUM) {
+		LOG_ERR("Unsupported number of decoder channels: %d", num_ch);
+		return -EINVAL;
+	}
+
+	ch_size = encoded_size / num_ch;
+
+	for (int i = 0; i < num_ch; i++) {
+		char *pcm_ch = pcm_data_mono[i];
+
+		if (cfg->decoder.channel_mode == SW_CODEC_MONO && pcm_out != NULL) {
+			pcm_ch = pcm_out;
+		}
+
+		if (bad_frame && IS_ENABLED(CONFIG_SW_CODEC_PLC_DISABLED)) {
+			memset(pcm_ch, 0, PCM_NUM_BYTES_MONO);
+			pcm_size_mono = PCM_NUM_BYTES_MONO;
+			continue;
+		}
+
+		ret = sw_codec_lc3_dec_run(encoded_data + (i * ch_size), ch_size,
+					   PCM_NUM_BYTES_MONO, i, pcm_ch, &pcm_size_mono,
+					   bad_frame);
+		if (ret) {
+			return ret;
+		}
+	}
+
+	if (cfg->decoder.channel_mode == SW_CODEC_MONO) {
+		/* Expanded to both I2S channels by the audio datapath */
+		*pcm_data = (pcm_out != NULL) ? pcm_out : pcm_data_mono[AUDIO_CH_L];
+		*pcm_size = pcm_size_mono;
+		return 0;
+	}
+
+	if (pcm_out == NULL) {
+		pcm_out = pcm_data_stereo;
+	}
+
+	ret = pscm_combine(pcm_data_mono[AUDIO_CH_L], pcm_data_mono[AUDIO_CH_R], pcm_size_mono,
+			   CONFIG_AUDIO_BIT_DEPTH_BITS, pcm_out, pcm_size);
+	if (ret) {
+		return ret;
+	}
+
+	*pcm_data = pcm_out;
+
+	return 0;
+}
+
+static int lc3_decode(const struct sw_codec_config *cfg, uint8_t const *const encoded_data,
+		      size_t encoded_size, void **pcm_data, size_t *pcm_size)
+{
+	return lc3_decode_frame(cfg, encoded_data, encoded_size, false, pcm_data, pcm_size);
+}
+
+static int lc3_plc(const struct sw_codec_config *cfg, void **pcm_data, size_t *pcm_size)
+{
+	return lc3_decode_frame(cfg, NULL, 0, true, pcm_data, pcm_size);
+}
+
+static size_t lc3_frame_size_get(const struct sw_codec_config *cfg)
+{
+	return (lc3_bitrate_per_ch(cfg) / 8) * CONFIG_AUDIO_FRAME_DURATION_US / USEC_PER_SEC *
+	       cfg->encoder.num_ch;
+}
+
+const struct sw_codec_ops sw_codec_lc3_ops = {
+	.name = "lc3",
+	.init = lc3_init,
+	.uninit = lc3_uninit,
+	.encode = lc3_encode,
+	.decode = lc3_decode,
+	.plc = lc3_plc,
+	.frame_size_get = lc3_frame_size_get,
+};
@@ -0,0 +1,111 @@
+/*
+ * Copyright (c) 2024 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#ifndef _SW_CODEC_LC3_H_
+#define _SW_CODEC_LC3_H_
+
+#include <zephyr/kernel.h>
+
+/* Use the bitrate given to sw_codec_lc3_enc_init() */
+#define LC3_USE_BITRATE_FROM_INIT 0
+
+/**
+ * @brief	Initialize the LC3 codec library.
+ *
+ * @param[in]		sw_codec_lc3_buffer		Buffer for the library, NULL to use
+ *							the heap.
+ * @param[in,out]	sw_codec_lc3_buffer_size	Size of the buffer, NULL if no buffer.
+ * @param[in]		framesize_us			Frame duration, 7500 or 10000 us.
+ *
+ * @return	0 if success, error otherwise.
+ */
+int sw_codec_lc3_init(uint8_t *sw_codec_lc3_buffer, uint32_t *sw_codec_lc3_buffer_size,
+		      uint16_t framesize_us);
+
+/**
+ * @brief	Uninitialize the LC3 codec library.
+ *
+ * @return	0 if success, error otherwise.
+ */
+int sw_codec_lc3_deinit(void);
+
+/**
+ * @brief	Open one LC3 encoder session per channel.
+ *
+ * @param[in]	pcm_sample_rate	Sample rate of the PCM input.
+ * @param[in]	pcm_bit_depth	Bit depth of the PCM input.
+ * @param[in]	framesize_us	Frame duration, 7500 or 10000 us.
+ * @param[in]	enc_bitrate	Bitrate per channel.
+ * @param[in]	num_channels	Number of encoder channels.
+ * @param[out]	pcm_bytes_req	PCM bytes needed per channel and frame.
+ *
+ * @return	0 if success, error otherwise.
+ */
+int sw_codec_lc3_enc_init(uint16_t pcm_sample_rate, uint8_t pcm_bit_depth, uint16_t framesize_us,
+			  uint32_t enc_bitrate, uint8_t num_channels, uint16_t *const pcm_bytes_req);
+
+/**
+ * @brief	Open one LC3 decoder session per channel.
+ *
+ * @param[in]	pcm_sample_rate	Sample rate of the PCM output.
+ * @param[in]	pcm_bit_depth	Bit depth of the PCM output.
+ * @param[in]	framesize_us	Frame duration, 7500 or 10000 us.
+ * @param[in]	num_channels	Number of decoder channels.
+ *
+ * @return	0 if success, error otherwise.
+ */
+int sw_codec_lc3_dec_init(uint16_t pcm_sample_rate, uint8_t pcm_bit_depth, uint16_t framesize_us,
+			  uint8_t num_channels);
+
+/**
+ * @brief	Encode one mono frame.
+ *
+ * @param[in]	pcm_in		Mono PCM input.
+ * @param[in]	pcm_in_size	Size of the PCM input.
+ * @param[in]	enc_bitrate	Bitrate, or LC3_USE_BITRATE_FROM_INIT.
+ * @param[in]	audio_ch	Encoder channel (session) to use.
+ * @param[in]	lc3_out_size	Size of the output buffer.
+ * @param[out]	lc3_out		Encoded output.
+ * @param[out]	lc3_out_wr_size	Number of bytes written to lc3_out.
+ *
+ * @return	0 if success, error otherwise.
+ */
+int sw_codec_lc3_enc_run(void const *const pcm_in, uint32_t pcm_in_size, uint32_t enc_bitrate,
+			 uint8_t audio_ch, uint16_t lc3_out_size, uint8_t *const lc3_out,
+			 uint16_t *const lc3_out_wr_size);
+
+/**
+ * @brief	Decode one mono frame.
+ *
+ * @param[in]	lc3_frame		Encoded input, ignored if bad_frame is set.
+ * @param[in]	lc3_frame_size		Size of the encoded input.
+ * @param[in]	pcm_data_buf_size	Size of the output buffer.
+ * @param[in]	audio_ch		Decoder channel (session) to use.
+ * @param[out]	pcm_data		Mono PCM output.
+ * @param[out]	pcm_data_wr_size	Number of bytes written to pcm_data.
+ * @param[in]	bad_frame		Run packet loss concealment instead of decoding.
+ *
+ * @return	0 if success, error otherwise.
+ */
+int sw_codec_lc3_dec_run(uint8_t const *const lc3_frame, uint16_t lc3_frame_size,
+			 uint16_t pcm_data_buf_size, uint8_t audio_ch, void *const pcm_data,
+			 uint16_t *const pcm_data_wr_size, bool bad_frame);
+
+/**
+ * @brief	Close all LC3 encoder sessions.
+ *
+ * @return	0 if success, error otherwise.
+ */
+int sw_codec_lc3_enc_uninit_all(void);
+
+/**
+ * @brief	Close all LC3 decoder sessions.
+ *
+ * @return	0 if success, error otherwise.
+ */
+int sw_codec_lc3_dec_uninit_all(void);
+
+#endif /* _SW_CODEC_LC3_H_ */
@@ -0,0 +1,511 @@
+/*
+ * Copyright (c) 2025 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+/** @file
+ * @brief Lossless PCM codec
+ *
+ * Codes each channel with the fixed polynomial predictor (order 0 to 4) that
+ * leaves the smallest residual and Rice codes the residual, as FLAC does for
+ * its fixed subframes. Stereo frames are coded as left/right, left/side or
+ * side/right, whichever is smaller. A frame that does not get smaller than
+ * the PCM it came from is sent as plain PCM, so a frame never exceeds the
+ * uncompressed size.
+ *
+ * Coded frame: one byte with the channel count and stereo mode, then per
+ * channel 3 bits of predictor order, the warm-up samples and
+ * LOSSLESS_PARTITIONS Rice partitions, each with a 5 bit parameter. A PCM
+ * frame has no header and is told apart by its size.
+ */
+
+#include "sw_codec_select.h"
+
+#include <zephyr/kernel.h>
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <zephyr/logging/log.h>
+LOG_MODULE_DECLARE(sw_codec_select, CONFIG_SW_CODEC_SELECT_LOG_LEVEL);
+
+#define LOSSLESS_SAMPLES_MAX  (PCM_NUM_BYTES_MONO / sizeof(int16_t))
+#define LOSSLESS_ORDER_MAX    4
+#define LOSSLESS_ORDER_BITS   3
+#define LOSSLESS_PARTITIONS   4
+#define LOSSLESS_RICE_BITS    5
+#define LOSSLESS_RICE_MAX     20
+#define LOSSLESS_SAMPLE_BITS  16
+/* Side channel needs one bit more than left and right */
+#define LOSSLESS_SIDE_BITS    (LOSSLESS_SAMPLE_BITS + 1)
+#define LOSSLESS_HDR_STEREO   BIT(7)
+#define LOSSLESS_HDR_MODE_MSK 0x03
+
+enum lossless_stereo_mode {
+	LOSSLESS_LEFT_RIGHT,
+	LOSSLESS_LEFT_SIDE,
+	LOSSLESS_SIDE_RIGHT,
+};
+
+struct bit_writer {
+	uint8_t *buf;
+	size_t size;
+	size_t pos;
+	uint64_t acc;
+	uint8_t bits;
+	bool overflow;
+};
+
+struct bit_reader {
+	const uint8_t *buf;
+	size_t size;
+	size_t pos;
+	uint64_t acc;
+	uint8_t bits;
+	bool underflow;
+};
+
+static uint8_t enc_buf[PCM_NUM_BYTES_STEREO];
+static int16_t dec_buf[PCM_NUM_BYTES_STEREO / sizeof(int16_t)];
+static char pcm_data_plc[PCM_NUM_BYTES_STEREO];
+/* Left, right and side of the frame being coded */
+static int32_t enc_ch[3][LOSSLESS_SAMPLES_MAX];
+static int32_t dec_ch[2][LOSSLESS_SAMPLES_MAX];
+
+static inline uint32_t bit_mask(uint8_t n)
+{
+	return (n >= 32) ? UINT32_MAX : (BIT(n) - 1);
+}
+
+static void bw_put(struct bit_writer *bw, uint32_t val, uint8_t n)
+{
+	bw->acc = (bw->acc << n) | (val & bit_mask(n));
+	bw->bits += n;
+
+	while (bw->bits >= 8) {
+		bw->bits -= 8;
+		if (bw->pos >= bw->size) {
+			bw->overflow = true;
+			return;
+		}
+		bw->buf[bw->pos++] = (uint8_t)(bw->acc >> bw->bits);
+	}
+}
+
+static void bw_put_rice(struct bit_writer *bw, int32_t val, uint8_t k)
+{
+	/* Zigzag, small magnitudes of either sign give small codes */
+	uint32_t u = ((uint32_t)val << 1) ^ (uint32_t)(val >> 31);
+	uint32_t q = u >> k;
+
+	while (q >= 32 && !bw->overflow) {
+		bw_put(bw, 0, 32);
+		q -= 32;
+	}
+	bw_put(bw, 1, q + 1);
+	bw_put(bw, u, k);
+}
+
+static void bw_flush(struct bit_writer *bw)
+{
+	if (bw->bits) {
+		bw_put(bw, 0, 8 - bw->bits);
+	}
+}
+
+static uint32_t br_get(struct bit_reader *br, uint8_t n)
+{
+	while (br->bits < n) {
+		uint8_t byte = 0;
+
+		if (br->pos < br->size) {
+			byte = br->buf[br->pos++];
+		} else {
+			br->underflow = true;
+		}
+		br->acc = (br->acc << 8) | byte;
+		br->bits += 8;
+	}
+
+	br->bits -= n;
+
+	return (uint32_t)(br->acc >> br->bits) & bit_mask(n);
+}
+
+static int32_t br_get_signed(struct bit_reader *br, uint8_t n)
+{
+	return (int32_t)(br_get(br, n) << (32 - n)) >> (32 - n);
+}
+
+static int32_t br_get_rice(struct bit_reader *br, uint8_t k)
+{
+	uint32_t q = 0;
+	uint32_t u;
+
+	while (br_get(br, 1) == 0) {
+		if (br->underflow) {
+			return 0;
+		}
+		q++;
+	}
+
+	u = (q << k) | br_get(br, k);
+
+	return (int32_t)(u >> 1) ^ -(int32_t)(u & 1);
+}
+
+/**
+ * @brief Residual of the fixed polynomial predictor of the given order at sample n.
+ */
+static inline int32_t fixed_residual(const int32_t *x, uint32_t n, uint8_t order)
+{
+	switch (order) {
+	case 0:
+		return x[n];
+	case 1:
+		return x[n] - x[n - 1];
+	case 2:
+		return x[n] - 2 * x[n - 1] + x[n - 2];
+	case 3:
+		return x[n] - 3 * x[n - 1] + 3 * x[n - 2] - x[n - 3];
+	default:
+		return x[n] - 4 * x[n - 1] + 6 * x[n - 2] - 4 * x[n - 3] + x[n - 4];
+	}
+}
+
+static inline int32_t fixed_predict(const int32_t *x, uint32_t n, uint8_t order)
+{
+	switch (order) {
+	case 0:
+		return 0;
+	case 1:
+		return x[n - 1];
+	case 2:
+		return 2 * x[n - 1] - x[n - 2];
+	case 3:
+		return 3 * x[n - 1] - 3 * x[n - 2] + x[n - 3];
+	default:
+		return 4 * x[n - 1] - 6 * x[n - 2] + 4 * x[n - 3] - x[n - 4];
+	}
+}
+
+/**
+ * @brief Pick the predictor order with the smallest sum of absolute residuals.
+ *
+ * @return Sum of absolute residuals of the chosen order.
+ */
+static uint64_t order_select(const int32_t *x, uint32_t samples, uint8_t *order)
+{
+	uint64_t sum[LOSSLESS_ORDER_MAX + 1] = {0};
+	uint64_t best = UINT64_MAX;
+
+	for (uint32_t n = LOSSLESS_ORDER_MAX; n < samples; n++) {
+		int32_t e0 = x[n];
+		int32_t e1 = e0 - x[n - 1];
+		int32_t e2 = e1 - (x[n - 1] - x[n - 2]);
+		int32_t e3 = e2 - (x[n - 1] - 2 * x[n - 2] + x[n - 3]);
+		int32_t e4 = e3 - (x[n - 1] - 3 * x[n - 2] + 3 * x[n - 3] - x[n - 4]);
+
+		sum[0] += abs(e0);
+		sum[1] += abs(e1);
+		sum[2] += abs(e2);
+		sum[3] += abs(e3);
+		sum[4] += abs(e4);
+	}
+
+	for (uint8_t i = 0; i <= LOSSLESS_ORDER_MAX; i++) {
+		if (sum[i] < best) {
+			best = sum[i];
+			*order = i;
+		}
+	}
+
+	return best;
+}
+
+/**
+ * @brief Rice parameter that minimizes the estimated size of a partition.
+ */
+static uint8_t rice_param_get(const int32_t *x, uint32_t start, uint32_t end, uint8_t order)
+{
+	uint64_t sum = 0;
+	uint64_t best_bits = UINT64_MAX;
+	uint32_t n = end - start;
+	uint8_t best = 0;
+
+	for (uint32_t i = start; i < end; i++) {
+		int32_t e = fixed_residual(x, i, order);
+
+		sum += ((uint32_t)e << 1) ^ (uint32_t)(e >> 31);
+	}
+
+	for (uint8_t k = 0; k <= LOSSLESS_RICE_MAX; k++) {
+		uint64_t bits = (uint64_t)n * (k + 1) + (sum >> k);
+
+		if (bits < best_bits) {
+			best_bits = bits;
+			best = k;
+		}
+	}
+
+	return best;
+}
+
+static void subframe_write(struct bit_writer *bw, const int32_t *x, uint32_t samples,
+			   uint8_t order, uint8_t sample_bits)
+{
+	uint32_t part_len = samples / LOSSLESS_PARTITIONS;
+
+	bw_put(bw, order, LOSSLESS_ORDER_BITS);
+
+	for (uint32_t n = 0; n < order; n++) {
+		bw_put(bw, (uint32_t)x[n], sample_bits);
+	}
+
+	for (uint32_t p = 0; (p < LOSSLESS_PARTITIONS) && !bw->overflow; p++) {
+		/* The warm-up samples are not part of the first partition */
+		uint32_t start = MAX(p * part_len, order);
+		uint32_t end = (p == LOSSLESS_PARTITIONS - 1) ? samples : (p + 1) * part_len;
+		uint8_t k = rice_param_get(x, start, end, order);
+
+		bw_put(bw, k, LOSSLESS_RICE_BITS);
+		for (uint32_t n = start; (n < end) && !bw->overflow; n++) {
+			bw_put_rice(bw, fixed_residual(x, n, order), k);
+		}
+	}
+}
+
+static int subframe_read(struct bit_reader *br, int32_t *x, uint32_t samples,
+			 uint8_t sample_bits)
+{
+	uint32_t part_len = samples / LOSSLESS_PARTITIONS;
+	uint8_t order = br_get(br, LOSSLESS_ORDER_BITS);
+
+	if (order > LOSSLESS_ORDER_MAX) {
+		return -EINVAL;
+	}
+
+	for (uint32_t n = 0; n < order; n++) {
+		x[n] = br_get_signed(br, sample_bits);
+	}
+
+	for (uint32_t p = 0; p < LOSSLESS_PARTITIONS; p++) {
+		uint32_t start = MAX(p * part_len, order);
+		uint32_t end = (p == LOSSLESS_PARTITIONS - 1) ? samples : (p + 1) * part_len;
+		uint8_t k = br_get(br, LOSSLESS_RICE_BITS);
+
+		for (uint32_t n = start; n < end; n++) {
+			x[n] = fixed_predict(x, n, order) + br_get_rice(br, k);
+		}
+
+		if (br->underflow) {
+			return -EINVAL;
+		}
+	}
+
+	return 0;
+}
+
+static int lossless_init(const struct sw_codec_config *cfg)
+{
+	if (PCM_NUM_BYTES_MONO_RATE(cfg->encoder.sample_rate_hz) / sizeof(int16_t) <
+	    LOSSLESS_PARTITIONS * LOSSLESS_ORDER_MAX) {
+		LOG_ERR("Frame too short for the lossless codec");
+		return -EINVAL;
+	}
+
+	LOG_INF("Lossless PCM, fixed predictor and Rice coding");
+
+	return 0;
+}
+
+static int lossless_uninit(const struct sw_codec_config *cfg)
+{
+	ARG_UNUSED(cfg);
+
+	return 0;
+}
+
+static int lossless_encode(const struct sw_codec_config *cfg, void *pcm_data, size_t pcm_size,
+			   uint8_t **encoded_data, size_t *encoded_size)
+{
+	const int16_t *pcm = pcm_data;
+	uint32_t samples = pcm_size / (AUDIO_CH_NUM * sizeof(int16_t));
+	uint8_t num_ch = cfg->encoder.num_ch;
+	size_t raw_size = samples * sizeof(int16_t) * num_ch;
+	struct bit_writer bw = {.buf = enc_buf, .size = raw_size};
+	enum lossless_stereo_mode mode = LOSSLESS_LEFT_RIGHT;
+	uint8_t order[3] = {0};
+
+	if (samples > LOSSLESS_SAMPLES_MAX || samples < LOSSLESS_PARTITIONS * LOSSLESS_ORDER_MAX) {
+		LOG_ERR("PCM frame has wrong size: %d", pcm_size);
+		return -EINVAL;
+	}
+
+	if (num_ch == 1) {
+		for (uint32_t n = 0; n < samples; n++) {
+			enc_ch[0][n] = pcm[n * AUDIO_CH_NUM + cfg->encoder.audio_ch];
+		}
+
+		order_select(enc_ch[0], samples, &order[0]);
+	} else {
+		uint64_t cost[3];
+
+		for (uint32_t n = 0; n < samples; n++) {
+			enc_ch[0][n] = pcm[n * AUDIO_CH_NUM + AUDIO_CH_L];
+			enc_ch[1][n] = pcm[n * AUDIO_CH_NUM + AUDIO_CH_R];
+			enc_ch[2][n] = enc_ch[0][n] - enc_ch[1][n];
+		}
+
+		for (int c = 0; c < 3; c++) {
+			cost[c] = order_select(enc_ch[c], samples, &order[c]);
+		}
+
+		if (cost[0] + cost[2] < MIN(cost[0] + cost[1], cost[2] + cost[1])) {
+			mode = LOSSLESS_LEFT_SIDE;
+		} else if (cost[2] + cost[1] < cost[0] + cost[1]) {
+			mode = LOSSLESS_SIDE_RIGHT;
+		}
+	}
+
+	bw_put(&bw, ((num_ch == 2) ? LOSSLESS_HDR_STEREO : 0) | mode, 8);
+
+	switch (mode) {
+	case LOSSLESS_LEFT_SIDE:
+		subframe_write(&bw, enc_ch[0], samples, order[0], LOSSLESS_SAMPLE_BITS);
+		subframe_write(&bw, enc_ch[2], samples, order[2], LOSSLESS_SIDE_BITS);
+		break;
+	case LOSSLESS_SIDE_RIGHT:
+		subframe_write(&bw, enc_ch[2], samples, order[2], LOSSLESS_SIDE_BITS);
+		subframe_write(&bw, enc_ch[1], samples, order[1], LOSSLESS_SAMPLE_BITS);
+		break;
+	default:
+		for (uint8_t c = 0; c < num_ch; c++) {
+			subframe_write(&bw, enc_ch[c], samples, order[c], LOSSLESS_SAMPLE_BITS);
+		}
+		break;
+	}
+
+	bw_flush(&bw);
+
+	if (bw.overflow || bw.pos >= raw_size) {
+		/* Incompressible, e.g. full scale noise, send the samples as they are */
+		for (uint32_t n = 0; n < samples; n++) {
+			for (uint8_t c = 0; c < num_ch; c++) {
+				((int16_t *)enc_buf)[n * num_ch + c] =
+					(num_ch == 1) ? enc_ch[0][n] : pcm[n * AUDIO_CH_NUM + c];
+			}
+		}
+		*encoded_data = enc_buf;
+		*encoded_size = raw_size;
+		return 0;
+	}
+
+	if (num_ch == 2 && bw.pos == raw_size / 2) {
+		/* Would be taken for a mono PCM frame, pad it */
+		enc_buf[bw.pos++] = 0;
+	}
+
+	*encoded_data = enc_buf;
+	*encoded_size = bw.pos;
+
+	return 0;
+}
+
+static int lossless_decode(const struct sw_codec_config *cfg, uint8_t const *const encoded_data,
+			   size_t encoded_size, void **pcm_data, size_t *pcm_size)
+{
+	int ret;
+	size_t mono_size = PCM_NUM_BYTES_MONO_RATE(cfg->decoder.sample_rate_hz);
+	uint32_t samples = mono_size / sizeof(int16_t);
+	struct bit_reader br = {.buf = encoded_data, .size = encoded_size};
+	int16_t *out = (*pcm_data != NULL) ? *pcm_data : dec_buf;
+	uint8_t hdr;
+	uint8_t num_ch;
+
+	if (encoded_size == 0 || encoded_size > PCM_NUM_BYTES_STEREO) {
+		LOG_ERR("Lossless frame has wrong size: %d", encoded_size);
+		return -EINVAL;
+	}
+
+	if (encoded_size == mono_size || encoded_size == 2 * mono_size) {
+		/* Sent as PCM */
+		*pcm_data = (void *)encoded_data;
+		*pcm_size = encoded_size;
+		return 0;
+	}
+
+	hdr = br_get(&br, 8);
+	num_ch = (hdr & LOSSLESS_HDR_STEREO) ? 2 : 1;
+
+	switch (hdr & LOSSLESS_HDR_MODE_MSK) {
+	case LOSSLESS_LEFT_SIDE:
+		ret = subframe_read(&br, dec_ch[0], samples, LOSSLESS_SAMPLE_BITS);
+		ret = ret ? ret : subframe_read(&br, dec_ch[1], samples, LOSSLESS_SIDE_BITS);
+		for (uint32_t n = 0; !ret && (n < samples); n++) {
+			/* Right = left - side */
+			dec_ch[1][n] = dec_ch[0][n] - dec_ch[1][n];
+		}
+		break;
+	case LOSSLESS_SIDE_RIGHT:
+		ret = subframe_read(&br, dec_ch[0], samples, LOSSLESS_SIDE_BITS);
+		ret = ret ? ret : subframe_read(&br, dec_ch[1], samples, LOSSLESS_SAMPLE_BITS);
+		for (uint32_t n = 0; !ret && (n < samples); n++) {
+			/* Left = side + right */
+			dec_ch[0][n] += dec_ch[1][n];
+		}
+		break;
+	case LOSSLESS_LEFT_RIGHT:
+		ret = 0;
+		for (uint8_t c = 0; !ret && (c < num_ch); c++) {
+			ret = subframe_read(&br, dec_ch[c], samples, LOSSLESS_SAMPLE_BITS);
+		}
+		break;
+	default:
+		ret = -EINVAL;
+		break;
+	}
+
+	if (ret) {
+		LOG_WRN("Corrupt lossless frame");
+		return ret;
+	}
+
+	for (uint32_t n = 0; n < samples; n++) {
+		for (uint8_t c = 0; c < num_ch; c++) {
+			out[n * num_ch + c] = (int16_t)dec_ch[c][n];
+		}
+	}
+
+	*pcm_data = out;
+	*pcm_size = mono_size * num_ch;
+
+	return 0;
+}
+
+static int lossless_plc(const struct sw_codec_config *cfg, void **pcm_data, size_t *pcm_size)
+{
+	/* Nothing to conceal from, play silence */
+	*pcm_data = pcm_data_plc;
+	*pcm_size =
+		PCM_NUM_BYTES_MONO_RATE(cfg->decoder.sample_rate_hz) * cfg->decoder.num_ch;
+
+	return 0;
+}
+
+static size_t lossless_frame_size_get(const struct sw_codec_config *cfg)
+{
+	/* Never more than the PCM frame, which is sent instead */
+	return PCM_NUM_BYTES_MONO_RATE(cfg->encoder.sample_rate_hz) * cfg->encoder.num_ch;
+}
+
+const struct sw_codec_ops sw_codec_lossless_ops = {
+	.name = "lossless",
+	.init = lossless_init,
+	.uninit = lossless_uninit,
+	.encode = lossless_encode,
+	.decode = lossless_decode,
+	.plc = lossless_plc,
+	.frame_size_get = lossless_frame_size_get,
+};
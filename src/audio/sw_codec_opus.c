@@ -0,0 +1,548 @@
+/*
+ * Copyright (c) 2024 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#include "sw_codec_select.h"
+
+#include <zephyr/kernel.h>
+#include <zephyr/shell/shell.h>
+#include <errno.h>
+#include <string.h>
+#include <pcm_stream_channel_modifier.h>
+
+#include "sw_codec_opus.h"
+
+#include <zephyr/logging/log.h>
+LOG_MODULE_DECLARE(sw_codec_select, CONFIG_SW_CODEC_SELECT_LOG_LEVEL);
+
+static ENC_Opus_ConfigTypeDef EncConfigOpus; /*!< opus encode configuration.*/
+static DEC_Opus_ConfigTypeDef DecConfigOpus; /*!< opus decode configuration.*/
+
+static const char *const rate_control_str[] = {"CBR", "CVBR", "VBR"};
+
+#if (CONFIG_AUDIO_BIT_DEPTH_32)
+/* I2S words hold the sample in the upper 24 bits, opus_encode24 takes it in the lower ones */
+static void pcm_res24_from_i2s(int32_t *pcm, size_t num_samples)
+{
+	for (size_t i = 0; i < num_samples; i++) {
+		pcm[i] >>= 8;
+	}
+}
+
+static void pcm_res24_to_i2s(int32_t *pcm, size_t num_samples)
+{
+	for (size_t i = 0; i < num_samples; i++) {
+		pcm[i] = (int32_t)((uint32_t)pcm[i] << 8);
+	}
+}
+#endif /* (CONFIG_AUDIO_BIT_DEPTH_32) */
+
+static const struct sw_codec_opus_profile profiles[] = {
+	{
+		.name = "speech-low-latency",
+		.bitrate_per_ch = 32000,
+		.bandwidth = OPUS_BANDWIDTH_SUPERWIDEBAND,
+		.rate_control = OPUS_RATE_CVBR,
+		.complexity = 0,
+		.signal = OPUS_SIGNAL_VOICE,
+		.lsb_depth = 14,
+		.packet_loss_perc = 10,
+	},
+	{
+		.name = "music-hq",
+		.bitrate_per_ch = 160000,
+		.bandwidth = OPUS_BANDWIDTH_FULLBAND,
+		.rate_control = OPUS_RATE_VBR,
+		.complexity = 5,
+		.signal = OPUS_SIGNAL_MUSIC,
+		.lsb_depth = 0,
+		.packet_loss_perc = 5,
+	},
+	{
+		.name = "robust-lossy",
+		.bitrate_per_ch = 96000,
+		.bandwidth = OPUS_BANDWIDTH_SUPERWIDEBAND,
+		.rate_control = OPUS_RATE_CBR,
+		.complexity = 0,
+		.signal = OPUS_SIGNAL_MUSIC,
+		.lsb_depth = 0,
+		.packet_loss_perc = 25,
+	},
+};
+
+#if CONFIG_OPUS_PROFILE_SPEECH_LOW_LATENCY
+static const struct sw_codec_opus_profile *profile_sel = &profiles[0];
+#elif CONFIG_OPUS_PROFILE_MUSIC_HQ
+static const struct sw_codec_opus_profile *profile_sel = &profiles[1];
+#elif CONFIG_OPUS_PROFILE_ROBUST_LOSSY
+static const struct sw_codec_opus_profile *profile_sel = &profiles[2];
+#else
+static const struct sw_codec_opus_profile *profile_sel;
+#endif
+
+/* Lowest bitrate per channel where CELT codes a bandwidth without audible artifacts */
+static const struct {
+	uint32_t bitrate_per_ch_min;
+	int32_t bandwidth;
+} bandwidth_by_bitrate[] = {
+	{48000, OPUS_BANDWIDTH_FULLBAND},
+	{32000, OPUS_BANDWIDTH_SUPERWIDEBAND},
+	{20000, OPUS_BANDWIDTH_WIDEBAND},
+	{0, OPUS_BANDWIDTH_NARROWBAND},
+};
+
+static int32_t opus_bandwidth_max(uint32_t sample_rate_hz)
+{
+	for (int32_t bw = OPUS_BANDWIDTH_FULLBAND; bw > OPUS_BANDWIDTH_NARROWBAND; bw--) {
+		if (sample_rate_hz >= 2 * sw_codec_opus_bandwidth_hz(bw)) {
+			return bw;
+		}
+	}
+
+	return OPUS_BANDWIDTH_NARROWBAND;
+}
+
+uint32_t sw_codec_opus_bandwidth_hz(int32_t bandwidth)
+{
+	switch (bandwidth) {
+	case OPUS_BANDWIDTH_NARROWBAND:
+		return 4000;
+	case OPUS_BANDWIDTH_MEDIUMBAND:
+		return 6000;
+	case OPUS_BANDWIDTH_WIDEBAND:
+		return 8000;
+	case OPUS_BANDWIDTH_SUPERWIDEBAND:
+		return 12000;
+	default:
+		return 20000;
+	}
+}
+
+const struct sw_codec_opus_profile *sw_codec_opus_profile_find(const char *name)
+{
+	for (int i = 0; i < ARRAY_SIZE(profiles); i++) {
+		if (strcmp(profiles[i].name, name) == 0) {
+			return &profiles[i];
+		}
+	}
+
+	return NULL;
+}
+
+const struct sw_codec_opus_profile *sw_codec_opus_profile_get(void)
+{
+	return profile_sel;
+}
+
+void sw_codec_opus_profile_set(const struct sw_codec_opus_profile *profile)
+{
+	profile_sel = profile;
+}
+
+void sw_codec_opus_profile_apply(const struct sw_codec_opus_profile *profile,
+				 ENC_Opus_ConfigTypeDef *enc_cfg)
+{
+	int32_t bandwidth = OPUS_BANDWIDTH_NARROWBAND;
+
+	if (profile == NULL) {
+		uint32_t bitrate_per_ch = enc_cfg->bitrate / MAX(enc_cfg->channels, 1);
+
+		for (int i = 0; i < ARRAY_SIZE(bandwidth_by_bitrate); i++) {
+			if (bitrate_per_ch >= bandwidth_by_bitrate[i].bitrate_per_ch_min) {
+				bandwidth = bandwidth_by_bitrate[i].bandwidth;
+				break;
+			}
+		}
+
+		enc_cfg->signal = OPUS_SIGNAL_MUSIC;
+		enc_cfg->lsb_depth = 0;
+		enc_cfg->packet_loss_perc = 15;
+	} else {
+		enc_cfg->bitrate = profile->bitrate_per_ch * enc_cfg->channels;
+		enc_cfg->rate_control = profile->rate_control;
+		if (!IS_ENABLED(CONFIG_SW_CODEC_COMPLEXITY_AUTO)) {
+			enc_cfg->complexity = profile->complexity;
+		}
+
+		bandwidth = profile->bandwidth;
+		enc_cfg->signal = profile->signal;
+		enc_cfg->lsb_depth = profile->lsb_depth;
+		enc_cfg->packet_loss_perc = profile->packet_loss_perc;
+	}
+
+	/* Nothing to code above the Nyquist frequency */
+	enc_cfg->bandwidth = MIN(bandwidth, opus_bandwidth_max(enc_cfg->sample_freq));
+}
+
+static int opus_codec_enc_init(const struct sw_codec_config *cfg)
+{
+	Opus_Status status;
+	int opus_err;
+
+	if (ENC_Opus_IsConfigured()) {
+		LOG_WRN("The OPUS encoder is already initialized");
+		return -EALREADY;
+	}
+
+	EncConfigOpus.ms_frame = OPUS_FRAME_DURATION_US / 1000.0f;
+	EncConfigOpus.sample_freq = cfg->encoder.sample_rate_hz;
+	EncConfigOpus.channels = cfg->encoder.num_ch;
+	EncConfigOpus.application = (uint16_t)OPUS_APPLICATION_AUDIO;
+	EncConfigOpus.bitrate = cfg->encoder.bitrate;
+	EncConfigOpus.complexity = cfg->encoder.complexity;
+	EncConfigOpus.res24 = IS_ENABLED(CONFIG_AUDIO_BIT_DEPTH_32);
+	if (IS_ENABLED(CONFIG_OPUS_RATE_CONTROL_CVBR)) {
+		EncConfigOpus.rate_control = OPUS_RATE_CVBR;
+	} else if (IS_ENABLED(CONFIG_OPUS_RATE_CONTROL_VBR)) {
+		EncConfigOpus.rate_control = OPUS_RATE_VBR;
+	} else {
+		EncConfigOpus.rate_control = OPUS_RATE_CBR;
+	}
+	sw_codec_opus_profile_apply(profile_sel, &EncConfigOpus);
+	if (IS_ENABLED(CONFIG_OPUS_CUSTOM_MODE)) {
+		/* Opus Custom has no bandwidth ctl, it codes up to half the sample rate */
+		EncConfigOpus.custom = 1;
+		EncConfigOpus.bandwidth = opus_bandwidth_max(EncConfigOpus.sample_freq);
+	}
+
+	/* The receiver drops packets larger than an uncompressed stereo frame */
+	EncConfigOpus.peak_bitrate =
+		(uint64_t)PCM_NUM_BYTES_STEREO * 8 * USEC_PER_SEC / OPUS_FRAME_DURATION_US;
+#if (CONFIG_OPUS_PEAK_BITRATE)
+	EncConfigOpus.peak_bitrate = MIN(CONFIG_OPUS_PEAK_BITRATE, EncConfigOpus.peak_bitrate);
+#endif /* (CONFIG_OPUS_PEAK_BITRATE) */
+
+	LOG_INF("Encode: %dHz %dbits %dus %dbps %d channel(s) complexity %d", EncConfigOpus.sample_freq,
+		CONFIG_AUDIO_BIT_DEPTH_BITS, OPUS_FRAME_DURATION_US, EncConfigOpus.bitrate,
+		EncConfigOpus.channels, EncConfigOpus.complexity);
+	LOG_INF("Profile %s: %s, %d Hz bandwidth, loss %d%%",
+		profile_sel ? profile_sel->name : "none",
+		rate_control_str[EncConfigOpus.rate_control],
+		sw_codec_opus_bandwidth_hz(EncConfigOpus.bandwidth), EncConfigOpus.packet_loss_perc);
+
+	if (IS_ENABLED(CONFIG_OPUS_MULTISTREAM)) {
+		/* One uncoupled stream per channel */
+		EncConfigOpus.streams = cfg->encoder.num_ch;
+		EncConfigOpus.coupled_streams = 0;
+	}
+
+	uint32_t enc_max_opus_frame_size = ENC_Opus_getMemorySize(&EncConfigOpus);
+
+	LOG_INF("enc_max_opus_frame_size: %d", enc_max_opus_frame_size);
+	EncConfigOpus.pInternalMemory = (uint8_t *)k_malloc(enc_max_opus_frame_size);
+	if (EncConfigOpus.pInternalMemory == NULL) {
+		LOG_ERR("Memory allocation failed for Opus encoder.");
+		return -ENOMEM;
+	}
+
+	status = ENC_Opus_Init(&EncConfigOpus, &opus_err);
+	if (status != OPUS_SUCCESS) {
+		k_free(EncConfigOpus.pInternalMemory);
+		EncConfigOpus.pInternalMemory = NULL;
+		return opus_err;
+	}
+
+	return 0;
+}
+
+static int opus_codec_dec_init(const struct sw_codec_config *cfg)
+{
+	Opus_Status status;
+	int opus_err;
+
+	LOG_INF("Decode: %dHz %dbits %dus %d channel(s)", cfg->decoder.sample_rate_hz,
+		CONFIG_AUDIO_BIT_DEPTH_BITS, OPUS_FRAME_DURATION_US, cfg->decoder.num_ch);
+
+	if (DEC_Opus_IsConfigured()) {
+		LOG_WRN("The OPUS decoder is already initialized");
+		return -EALREADY;
+	}
+
+	DecConfigOpus.ms_frame = OPUS_FRAME_DURATION_US / 1000.0f;
+	DecConfigOpus.sample_freq = cfg->decoder.sample_rate_hz;
+	DecConfigOpus.channels = cfg->decoder.num_ch;
+	DecConfigOpus.custom = IS_ENABLED(CONFIG_OPUS_CUSTOM_MODE);
+	DecConfigOpus.res24 = IS_ENABLED(CONFIG_AUDIO_BIT_DEPTH_32);
+	if (IS_ENABLED(CONFIG_OPUS_MULTISTREAM)) {
+		/* Gateway sends one stream per channel, decode ours only */
+		DecConfigOpus.streams = AUDIO_CH_NUM;
+		DecConfigOpus.stream_id = cfg->decoder.audio_ch;
+	}
+
+	uint32_t dec_max_opus_frame_size = DEC_Opus_getMemorySize(&DecConfigOpus);
+
+	LOG_INF("dec_max_opus_frame_size: %d", dec_max_opus_frame_size);
+	DecConfigOpus.pInternalMemory = (uint8_t *)k_malloc(dec_max_opus_frame_size);
+	if (DecConfigOpus.pInternalMemory == NULL) {
+		LOG_ERR("Memory allocation failed for Opus decoder.");
+		return -ENOMEM;
+	}
+
+	status = DEC_Opus_Init(&DecConfigOpus, &opus_err);
+	if (status != OPUS_SUCCESS) {
+		k_free(DecConfigOpus.pInternalMemory);
+		DecConfigOpus.pInternalMemory = NULL;
+		return opus_err;
+	}
+
+	return 0;
+}
+
+static int opus_codec_uninit(const struct sw_codec_config *cfg)
+{
+	if (cfg->encoder.enabled) {
+		k_free(EncConfigOpus.pInternalMemory);
+		EncConfigOpus.pInternalMemory = NULL;
+		ENC_Opus_Deinit();
+	}
+
+	if (cfg->decoder.enabled) {
+		k_free(DecConfigOpus.pInternalMemory);
+		DecConfigOpus.pInternalMemory = NULL;
+		DEC_Opus_Deinit();
+	}
+
+	return 0;
+}
+
+static int opus_codec_init(const struct sw_codec_config *cfg)
+{
+	int ret;
+
+	if (cfg->encoder.enabled) {
+		ret = opus_codec_enc_init(cfg);
+		if (ret) {
+			return ret;
+		}
+	}
+
+	if (cfg->decoder.enabled) {
+		ret = opus_codec_dec_init(cfg);
+		if (ret) {
+			if (cfg->encoder.enabled) {
+				k_free(EncConfigOpus.pInternalMemory);
+				EncConfigOpus.pInternalMemory = NULL;
+				ENC_Opus_Deinit();
+			}
+			return ret;
+		}
+	}
+
+	return 0;
+}
+
+static int opus_codec_encode(const struct sw_codec_config *cfg, void *pcm_data, size_t pcm_size,
+			     uint8_t **encoded_data, size_t *encoded_size)
+{
+	int encoded_bytes_written = 0;
+
+	switch (cfg->encoder.channel_mode) {
+	case SW_CODEC_MONO: {
+		int ret;
+		/* Temp storage for the selected channel of the stereo PCM signal */
+		static char pcm_data_mono[PCM_NUM_BYTES_MONO] __aligned(sizeof(int32_t));
+		size_t pcm_size_mono;
+
+		ret = pscm_one_channel_split(pcm_data, pcm_size, cfg->encoder.audio_ch,
+					     CONFIG_AUDIO_BIT_DEPTH_BITS, pcm_data_mono,
+					     &pcm_size_mono);
+		if (ret) {
+			return ret;
+		}
+
+#if (CONFIG_AUDIO_BIT_DEPTH_32)
+		pcm_res24_from_i2s((int32_t *)pcm_data_mono, pcm_size_mono / sizeof(int32_t));
+#endif /* (CONFIG_AUDIO_BIT_DEPTH_32) */
+		encoded_bytes_written =
+			ENC_Opus_Encode((uint8_t *)pcm_data_mono, EncConfigOpus.pInternalMemory);
+		break;
+	}
+	case SW_CODEC_STEREO: {
+#if (CONFIG_AUDIO_BIT_DEPTH_32)
+		/* The captured frame is freed after encoding, shift it in place */
+		pcm_res24_from_i2s(pcm_data, pcm_size / sizeof(int32_t));
+#endif /* (CONFIG_AUDIO_BIT_DEPTH_32) */
+		encoded_bytes_written =
+			ENC_Opus_Encode((uint8_t *)pcm_data, EncConfigOpus.pInternalMemory);
+		break;
+	}
+	default:
+		LOG_ERR("Unsupported channel mode for encoder: %d", cfg->encoder.channel_mode);
+		return -ENODEV;
+	}
+
+	if (encoded_bytes_written < 0) {
+		LOG_ERR("Opus encoding failed: %s", opus_strerror(encoded_bytes_written));
+		return encoded_bytes_written;
+	}
+
+	LOG_DBG("Opus encoded output data size: %d bytes", encoded_bytes_written);
+
+	*encoded_data = EncConfigOpus.pInternalMemory;
+	*encoded_size = encoded_bytes_written;
+
+	return 0;
+}
+
+static int opus_codec_decode(const struct sw_codec_config *cfg, uint8_t const *const encoded_data,
+			     size_t encoded_size, void **pcm_data, size_t *pcm_size)
+{
+	int num_samples;
+	/* Decode in place if the caller gave a buffer */
+	uint8_t *pcm_out = (*pcm_data != NULL) ? *pcm_data : DecConfigOpus.pInternalMemory;
+
+	switch (cfg->decoder.channel_mode) {
+	case SW_CODEC_MONO:
+	case SW_CODEC_STEREO: {
+		/* The decoder was created with the configured number of channels, mono
+		 * output is expanded to both I2S channels by the audio datapath
+		 */
+		num_samples = DEC_Opus_Decode((uint8_t *)encoded_data, encoded_size, pcm_out);
+		if (num_samples < 0) {
+			LOG_ERR("Opus decoding failed: %s", opus_strerror(num_samples));
+			return num_samples;
+		}
+
+		LOG_DBG("pcm frame samples size: %d", num_samples);
+		break;
+	}
+	default:
+		LOG_ERR("Unsupported channel mode for decoder: %d", cfg->decoder.channel_mode);
+		return -ENODEV;
+	}
+
+#if (CONFIG_AUDIO_BIT_DEPTH_32)
+	pcm_res24_to_i2s((int32_t *)pcm_out, num_samples * cfg->decoder.num_ch);
+#endif /* (CONFIG_AUDIO_BIT_DEPTH_32) */
+
+	*pcm_size = num_samples * cfg->decoder.num_ch * CONFIG_AUDIO_BIT_DEPTH_OCTETS;
+	*pcm_data = pcm_out;
+
+	return 0;
+}
+
+static int opus_codec_plc(const struct sw_codec_config *cfg, void **pcm_data, size_t *pcm_size)
+{
+	/* Decoding without a packet runs the Opus packet loss concealment */
+	return opus_codec_decode(cfg, NULL, 0, pcm_data, pcm_size);
+}
+
+static size_t opus_codec_frame_size_get(const struct sw_codec_config *cfg)
+{
+	if (EncConfigOpus.rate_control == OPUS_RATE_CBR) {
+		/* Every packet has the size given by the bitrate */
+		return EncConfigOpus.bitrate / 8 * OPUS_FRAME_DURATION_US / USEC_PER_SEC;
+	}
+
+	/* Packet size varies, the encoder output buffer bounds it */
+	return ENC_Opus_getMemorySize(&EncConfigOpus);
+}
+
+static int opus_codec_complexity_set(const struct sw_codec_config *cfg)
+{
+	Opus_Status status;
+	int opus_err;
+
+	status = ENC_Opus_Set_Complexity(cfg->encoder.complexity, &opus_err);
+	if (status != OPUS_SUCCESS) {
+		LOG_ERR("Failed to set Opus complexity %d: %s", cfg->encoder.complexity,
+			opus_strerror(opus_err));
+		return opus_err;
+	}
+
+	EncConfigOpus.complexity = cfg->encoder.complexity;
+
+	return 0;
+}
+
+const struct sw_codec_ops sw_codec_opus_ops = {
+	.name = "opus",
+	.init = opus_codec_init,
+	.uninit = opus_codec_uninit,
+	.encode = opus_codec_encode,
+	.decode = opus_codec_decode,
+	.plc = opus_codec_plc,
+	.frame_size_get = opus_codec_frame_size_get,
+	.complexity_set = opus_codec_complexity_set,
+};
+
+static int cmd_opus_profile(const struct shell *shell, size_t argc, const char **argv)
+{
+	const struct sw_codec_opus_profile *profile = NULL;
+
+	if (argc == 1) {
+		shell_print(shell, "Profile: %s", profile_sel ? profile_sel->name : "none");
+		for (int i = 0; i < ARRAY_SIZE(profiles); i++) {
+			profile = &profiles[i];
+			shell_print(shell, "  %s: %d bps/ch %s, %d Hz, complexity %d, loss %d%%",
+				    profile->name, profile->bitrate_per_ch,
+				    rate_control_str[profile->rate_control],
+				    sw_codec_opus_bandwidth_hz(profile->bandwidth),
+				    profile->complexity, profile->packet_loss_perc);
+		}
+
+		if (ENC_Opus_IsConfigured()) {
+			shell_print(shell, "Encoder: %d bps %s, %d Hz, complexity %d",
+				    EncConfigOpus.bitrate,
+				    rate_control_str[EncConfigOpus.rate_control],
+				    sw_codec_opus_bandwidth_hz(EncConfigOpus.bandwidth),
+				    EncConfigOpus.complexity);
+		}
+
+		return 0;
+	}
+
+	if (strcmp(argv[1], "none") != 0) {
+		profile = sw_codec_opus_profile_find(argv[1]);
+		if (profile == NULL) {
+			shell_error(shell, "Unknown profile: %s", argv[1]);
+			return -EINVAL;
+		}
+	}
+
+	sw_codec_opus_profile_set(profile);
+	shell_print(shell, "Profile %s is used at the next encoder start", argv[1]);
+
+	return 0;
+}
+
+static int cmd_opus_scratch(const struct shell *shell, size_t argc, const char **argv)
+{
+	uint32_t size;
+	uint32_t used;
+
+	if (argc == 2) {
+		if (strcmp(argv[1], "reset") != 0) {
+			shell_error(shell, "Usage: opus scratch [reset]");
+			return -EINVAL;
+		}
+
+		if (sw_codec_is_initialized()) {
+			shell_error(shell, "Stop the audio system before resetting");
+			return -EBUSY;
+		}
+
+		Opus_Scratch_ResetUsage();
+		shell_print(shell, "Scratch peak reset");
+		return 0;
+	}
+
+	used = Opus_Scratch_GetUsage(&size);
+	shell_print(shell, "Scratch arena: peak at least %d of %d bytes", used, size);
+
+	return 0;
+}
+
+SHELL_STATIC_SUBCMD_SET_CREATE(opus_cmd,
+			       SHELL_COND_CMD_ARG(CONFIG_SHELL, profile, NULL,
+						  "Show or select the encoder profile: "
+						  "[none|speech-low-latency|music-hq|robust-lossy]",
+						  cmd_opus_profile, 1, 1),
+			       SHELL_COND_CMD_ARG(CONFIG_OPUS_SCRATCH_ARENA, scratch, NULL,
+						  "Peak use of the Opus scratch arena [reset]",
+						  cmd_opus_scratch, 1, 1),
+			       SHELL_SUBCMD_SET_END);
+
+SHELL_CMD_REGISTER(opus, &opus_cmd, "Opus codec commands", NULL);
@@ -0,0 +1,72 @@
+/*
+ * Copyright (c) 2024 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#ifndef _SW_CODEC_OPUS_H_
+#define _SW_CODEC_OPUS_H_
+
+#include <zephyr/kernel.h>
+
+#include "opus_interface.h"
+
+/**
+ * @brief Opus encoder settings tuned for one use case.
+ */
+struct sw_codec_opus_profile {
+	const char *name;
+	uint32_t bitrate_per_ch;
+	int32_t bandwidth;    /* OPUS_BANDWIDTH_*, capped by the sample rate */
+	uint8_t rate_control; /* Opus_RateControl */
+	uint8_t complexity;   /* Ignored with SW_CODEC_COMPLEXITY_AUTO */
+	int32_t signal;	      /* OPUS_SIGNAL_* */
+	uint8_t lsb_depth;    /* 0 for the width of the input samples */
+	uint8_t packet_loss_perc;
+};
+
+/**
+ * @brief	Find an encoder profile by name.
+ *
+ * @param[in]	name	Profile name.
+ *
+ * @return	The profile, NULL if there is none with this name.
+ */
+const struct sw_codec_opus_profile *sw_codec_opus_profile_find(const char *name);
+
+/**
+ * @brief	Get the encoder profile used at the next encoder start.
+ *
+ * @return	The profile, NULL if bitrate and settings come from the application and Kconfig.
+ */
+const struct sw_codec_opus_profile *sw_codec_opus_profile_get(void);
+
+/**
+ * @brief	Select the encoder profile used at the next encoder start.
+ *
+ * @param[in]	profile	Profile, NULL for the application and Kconfig settings.
+ */
+void sw_codec_opus_profile_set(const struct sw_codec_opus_profile *profile);
+
+/**
+ * @brief	Apply an encoder profile to an Opus encoder configuration.
+ *
+ * @note	sample_freq and channels must be set. Without a profile only bandwidth,
+ *		signal, LSB depth and packet loss are set, the bandwidth follows the bitrate.
+ *
+ * @param[in]		profile	Profile, NULL to keep bitrate, rate control and complexity.
+ * @param[in,out]	enc_cfg	Encoder configuration.
+ */
+void sw_codec_opus_profile_apply(const struct sw_codec_opus_profile *profile,
+				 ENC_Opus_ConfigTypeDef *enc_cfg);
+
+/**
+ * @brief	Get the audio bandwidth of an Opus bandwidth setting.
+ *
+ * @param[in]	bandwidth	OPUS_BANDWIDTH_*.
+ *
+ * @return	Highest coded frequency in Hz.
+ */
+uint32_t sw_codec_opus_bandwidth_hz(int32_t bandwidth);
+
+#endif /* _SW_CODEC_OPUS_H_ */
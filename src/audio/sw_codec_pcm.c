@@ -0,0 +1,105 @@
+/*
+ * Copyright (c) 2024 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#include "sw_codec_select.h"
+
+#include <zephyr/kernel.h>
+#include <errno.h>
+#include <pcm_stream_channel_modifier.h>
+
+#include <zephyr/logging/log.h>
+LOG_MODULE_DECLARE(sw_codec_select, CONFIG_SW_CODEC_SELECT_LOG_LEVEL);
+
+/* Uncompressed PCM, a mono encoder only sends the selected channel */
+static char pcm_data_mono[PCM_NUM_BYTES_MONO];
+static char pcm_data_plc[PCM_NUM_BYTES_STEREO];
+
+static int pcm_init(const struct sw_codec_config *cfg)
+{
+	ARG_UNUSED(cfg);
+
+	LOG_INF("No sw codec set, uncompressed PCM data is used.");
+
+	return 0;
+}
+
+static int pcm_uninit(const struct sw_codec_config *cfg)
+{
+	ARG_UNUSED(cfg);
+
+	return 0;
+}
+
+static int pcm_encode(const struct sw_codec_config *cfg, void *pcm_data, size_t pcm_size,
+		      uint8_t **encoded_data, size_t *encoded_size)
+{
+	int ret;
+
+	switch (cfg->encoder.channel_mode) {
+	case SW_CODEC_MONO: {
+		ret = pscm_one_channel_split(pcm_data, pcm_size, cfg->encoder.audio_ch,
+					     CONFIG_AUDIO_BIT_DEPTH_BITS, pcm_data_mono,
+					     encoded_size);
+		if (ret) {
+			return ret;
+		}
+
+		*encoded_data = (uint8_t *)pcm_data_mono;
+		break;
+	}
+	case SW_CODEC_STEREO: {
+		*encoded_data = pcm_data;
+		*encoded_size = pcm_size;
+		break;
+	}
+	default:
+		LOG_ERR("Unsupported channel mode for encoder: %d", cfg->encoder.channel_mode);
+		return -ENODEV;
+	}
+
+	return 0;
+}
+
+static int pcm_decode(const struct sw_codec_config *cfg, uint8_t const *const encoded_data,
+		      size_t encoded_size, void **pcm_data, size_t *pcm_size)
+{
+	ARG_UNUSED(cfg);
+
+	if (encoded_size == 0 || encoded_size > PCM_NUM_BYTES_STEREO) {
+		LOG_ERR("PCM frame has wrong size: %d", encoded_size);
+		return -EINVAL;
+	}
+
+	*pcm_data = (void *)encoded_data;
+	*pcm_size = encoded_size;
+
+	return 0;
+}
+
+static int pcm_plc(const struct sw_codec_config *cfg, void **pcm_data, size_t *pcm_size)
+{
+	/* Nothing to conceal from, play silence */
+	*pcm_data = pcm_data_plc;
+	*pcm_size =
+		PCM_NUM_BYTES_MONO_RATE(cfg->decoder.sample_rate_hz) * cfg->decoder.num_ch;
+
+	return 0;
+}
+
+static size_t pcm_frame_size_get(const struct sw_codec_config *cfg)
+{
+	return PCM_NUM_BYTES_MONO_RATE(cfg->encoder.sample_rate_hz) * cfg->encoder.num_ch;
+}
+
+const struct sw_codec_ops sw_codec_pcm_ops = {
+	.name = "pcm",
+	.init = pcm_init,
+	.uninit = pcm_uninit,
+	.encode = pcm_encode,
+	.decode = pcm_decode,
+	.plc = pcm_plc,
+	.frame_size_get = pcm_frame_size_get,
+};
@@ -8,482 +8,431 @@
 
 #include <zephyr/kernel.h>
 #include <errno.h>
+#include <stdlib.h>
+#include <string.h>
 #include <pcm_stream_channel_modifier.h>
 #include <sample_rate_converter.h>
-
-#if (CONFIG_SW_CODEC_LC3)
-#include "sw_codec_lc3.h"
-#elif (CONFIG_SW_CODEC_OPUS)
-#include "opus_interface.h"
-ENC_Opus_ConfigTypeDef EncConfigOpus; /*!< opus encode configuration.*/
-DEC_Opus_ConfigTypeDef DecConfigOpus; /*!< opus encode configuration.*/
-#endif /* (CONFIG_SW_CODEC_LC3) */
+#include <zephyr/shell/shell.h>
 
 #include <zephyr/logging/log.h>
 LOG_MODULE_REGISTER(sw_codec_select, CONFIG_SW_CODEC_SELECT_LOG_LEVEL);
 
+static const struct sw_codec_ops *const sw_codec_backends[SW_CODEC_NUM] = {
+	[SW_CODEC_NONE] = &sw_codec_pcm_ops,
+#if (CONFIG_SW_CODEC_LC3)
+	[SW_CODEC_LC3] = &sw_codec_lc3_ops,
+#endif /* (CONFIG_SW_CODEC_LC3) */
+#if (CONFIG_SW_CODEC_OPUS)
+	[SW_CODEC_OPUS] = &sw_codec_opus_ops,
+#endif /* (CONFIG_SW_CODEC_OPUS) */
+#if (CONFIG_SW_CODEC_LOSSLESS)
+	[SW_CODEC_LOSSLESS] = &sw_codec_lossless_ops,
+#endif /* (CONFIG_SW_CODEC_LOSSLESS) */
+#if (CONFIG_SW_CODEC_ADPCM)
+	[SW_CODEC_ADPCM] = &sw_codec_adpcm_ops,
+#endif /* (CONFIG_SW_CODEC_ADPCM) */
+};
+
 static struct sw_codec_config m_config;
+static const struct sw_codec_ops *m_ops;
+
+/* Sample rate conversion between the audio system and the codec, one direction */
+struct sw_codec_src {
+	struct sample_rate_converter_ctx ctx[AUDIO_CH_NUM];
+	char pcm_in_mono[AUDIO_CH_NUM][PCM_NUM_BYTES_MONO];
+	char pcm_out_mono[AUDIO_CH_NUM][PCM_NUM_BYTES_MONO];
+	char pcm_out[PCM_NUM_BYTES_STEREO];
+	/* Cycles spent converting one frame, all channels */
+	uint32_t frames;
+	uint32_t cycles_last;
+	uint32_t cycles_max;
+	uint64_t cycles_total;
+};
+
+static struct sw_codec_src enc_src;
+static struct sw_codec_src dec_src;
+
+#define ENC_STATS_BINS 16
+
+/* Encoded frame sizes, shows how a variable bitrate encoder spends its bits */
+struct sw_codec_enc_stats {
+	uint32_t frames;
+	uint64_t bytes_total;
+	uint32_t bytes_min;
+	uint32_t bytes_max;
+	/* Bins span 0 up to the largest frame the encoder may produce */
+	uint32_t bin_width;
+	uint32_t hist[ENC_STATS_BINS];
+};
+
+static struct sw_codec_enc_stats enc_stats;
+
+static void sw_codec_enc_stats_reset(void)
+{
+	memset(&enc_stats, 0, sizeof(enc_stats));
+	enc_stats.bytes_min = UINT32_MAX;
+	enc_stats.bin_width = MAX(DIV_ROUND_UP(m_ops->frame_size_get(&m_config) + 1,
+					       ENC_STATS_BINS),
+				  1);
+}
 
-// static struct sample_rate_converter_ctx encoder_converters[AUDIO_CH_NUM];
-// static struct sample_rate_converter_ctx decoder_converters[AUDIO_CH_NUM];
-
-// /**
-//  * @brief	Converts the sample rate of the uncompressed audio stream if needed.
-//  *
-//  * @details	Two buffers must be made available for the function: the input_data buffer that
-//  *		contains the samples for the audio stream, and the conversion buffer that will be
-//  *		used to store the converted audio stream. data_ptr will point to conversion_buffer
-//  *		if a conversion took place; otherwise, it will point to input_data.
-//  *
-//  * @param[in]	ctx			Sample rate converter context.
-//  * @param[in]	input_sample_rate	Input sample rate.
-//  * @param[in]	output_sample_rate	Output sample rate.
-//  * @param[in]	input_data		Data coming in. Buffer is assumed to be of size
-//  *					PCM_NUM_BYTES_MONO.
-//  * @param[in]	input_data_size		Size of input data.
-//  * @param[in]	conversion_buffer	Buffer to perform sample rate conversion. Must be of
-//  size *					PCM_NUM_BYTES_MONO.
-//  * @param[out]	data_ptr		Pointer to the data to be used from this point on.
-//  *					Will point to either @p input_data or @p conversion_buffer.
-//  * @param[out]	output_size		Number of bytes out.
-//  *
-//  * @retval	-ENOTSUP	Sample rates are not equal, and the sample rate conversion has not
-//  *been enabled in the application.
-//  * @retval	0		Success.
-//  */
-// static int sw_codec_sample_rate_convert(struct sample_rate_converter_ctx *ctx,
-// 					uint32_t input_sample_rate, uint32_t output_sample_rate,
-// 					char *input_data, size_t input_data_size,
-// 					char *conversion_buffer, char **data_ptr,
-// 					size_t *output_size)
-// {
-// 	int ret;
-
-// 	if (input_sample_rate == output_sample_rate) {
-// 		*data_ptr = input_data;
-// 		*output_size = input_data_size;
-// 	} else if (IS_ENABLED(CONFIG_SAMPLE_RATE_CONVERTER)) {
-// 		ret = sample_rate_converter_process(ctx, SAMPLE_RATE_FILTER_SIMPLE, input_data,
-// 						    input_data_size, input_sample_rate,
-// 						    conversion_buffer, PCM_NUM_BYTES_MONO,
-// 						    output_size, output_sample_rate);
-// 		if (ret) {
-// 			LOG_ERR("Failed to convert sample rate: %d", ret);
-// 			return ret;
-// 		}
-
-// 		*data_ptr = conversion_buffer;
-// 	} else {
-// 		LOG_ERR("Sample rates are not equal, and sample rate conversion has not been "
-// 			"enabled in the application.");
-// 		return -ENOTSUP;
-// 	}
-
-// 	return 0;
-// }
+#if (CONFIG_SW_CODEC_COMPLEXITY_AUTO)
+/* Encode time above which the complexity is lowered */
+#define COMPLEXITY_LIMIT_US                                                                        \
+	(CONFIG_AUDIO_FRAME_DURATION_US * (100 - CONFIG_SW_CODEC_COMPLEXITY_HEADROOM_PERCENT) / 100)
+/* Encode time below which the complexity may be raised */
+#define COMPLEXITY_RAISE_US (COMPLEXITY_LIMIT_US * 3 / 4)
+#define COMPLEXITY_MAX	    10
+/* A raise that is taken back at once doubles the hold-off, up to this factor */
+#define COMPLEXITY_HOLD_MAX (CONFIG_SW_CODEC_COMPLEXITY_RAISE_WINDOWS * 8)
+
+/* Encode time per frame, the complexity follows the 95th percentile of a window */
+struct sw_codec_complexity_ctrl {
+	uint32_t cycles[CONFIG_SW_CODEC_COMPLEXITY_WINDOW];
+	uint32_t sorted[CONFIG_SW_CODEC_COMPLEXITY_WINDOW];
+	uint32_t idx;
+	/* Percentiles of the last complete window, in us */
+	uint32_t p50_us;
+	uint32_t p95_us;
+	uint32_t p99_us;
+	uint32_t max_us;
+	uint32_t windows;
+	uint32_t changes;
+	/* Windows in a row below the raise threshold, and how many a raise needs */
+	uint32_t quiet;
+	uint32_t hold;
+	bool raised;
+};
+
+static struct sw_codec_complexity_ctrl complexity_ctrl;
+
+static int cycles_cmp(const void *a, const void *b)
+{
+	uint32_t x = *(const uint32_t *)a;
+	uint32_t y = *(const uint32_t *)b;
 
-bool sw_codec_is_initialized(void)
+	return (x > y) - (x < y);
+}
+
+static void sw_codec_complexity_update(uint32_t cycles)
 {
-	return m_config.initialized;
+	struct sw_codec_complexity_ctrl *ctrl = &complexity_ctrl;
+	const size_t n = CONFIG_SW_CODEC_COMPLEXITY_WINDOW;
+	uint8_t complexity = m_config.encoder.complexity;
+	int ret;
+
+	if (m_ops->complexity_set == NULL) {
+		return;
+	}
+
+	ctrl->cycles[ctrl->idx++] = cycles;
+	if (ctrl->idx < n) {
+		return;
+	}
+
+	ctrl->idx = 0;
+	ctrl->windows++;
+
+	memcpy(ctrl->sorted, ctrl->cycles, sizeof(ctrl->sorted));
+	qsort(ctrl->sorted, n, sizeof(ctrl->sorted[0]), cycles_cmp);
+
+	ctrl->p50_us = k_cyc_to_us_floor32(ctrl->sorted[n / 2]);
+	ctrl->p95_us = k_cyc_to_us_floor32(ctrl->sorted[n * 95 / 100]);
+	ctrl->p99_us = k_cyc_to_us_floor32(ctrl->sorted[n * 99 / 100]);
+	ctrl->max_us = k_cyc_to_us_floor32(ctrl->sorted[n - 1]);
+
+	if (ctrl->hold == 0) {
+		ctrl->hold = CONFIG_SW_CODEC_COMPLEXITY_RAISE_WINDOWS;
+	}
+
+	ctrl->quiet = (ctrl->p95_us < COMPLEXITY_RAISE_US) ? ctrl->quiet + 1 : 0;
+
+	if (ctrl->p95_us > COMPLEXITY_LIMIT_US && complexity > 0) {
+		/* The last raise went over the limit, wait longer before the next one */
+		if (ctrl->raised) {
+			ctrl->hold = MIN(ctrl->hold * 2, COMPLEXITY_HOLD_MAX);
+		}
+		complexity--;
+		ctrl->raised = false;
+	} else if (ctrl->quiet >= ctrl->hold && complexity < COMPLEXITY_MAX) {
+		complexity++;
+		ctrl->quiet = 0;
+		ctrl->raised = true;
+	} else {
+		ctrl->raised = false;
+		return;
+	}
+
+	m_config.encoder.complexity = complexity;
+	ret = m_ops->complexity_set(&m_config);
+	if (ret) {
+		LOG_WRN("Failed to set complexity %d: %d", complexity, ret);
+		return;
+	}
+
+	ctrl->changes++;
+	LOG_DBG("Encode p95 %d us, limit %d us, complexity %d, hold-off %d windows",
+		ctrl->p95_us, COMPLEXITY_LIMIT_US, complexity, ctrl->hold);
 }
+#endif /* (CONFIG_SW_CODEC_COMPLEXITY_AUTO) */
 
-int sw_codec_encode(void *pcm_data, size_t pcm_size, uint8_t **encoded_data, size_t *encoded_size)
+static void sw_codec_enc_stats_add(size_t encoded_size)
 {
+	uint32_t bin = MIN(encoded_size / enc_stats.bin_width, ENC_STATS_BINS - 1);
 
-	if (!m_config.encoder.enabled) {
-		LOG_ERR("Encoder has not been initialized");
-		return -ENXIO; // No such device or address
+	enc_stats.frames++;
+	enc_stats.bytes_total += encoded_size;
+	enc_stats.bytes_min = MIN(enc_stats.bytes_min, encoded_size);
+	enc_stats.bytes_max = MAX(enc_stats.bytes_max, encoded_size);
+	enc_stats.hist[bin]++;
+}
+
+static void sw_codec_src_reset(struct sw_codec_src *src)
+{
+#if (CONFIG_SAMPLE_RATE_CONVERTER)
+	for (int i = 0; i < AUDIO_CH_NUM; i++) {
+		sample_rate_converter_open(&src->ctx[i]);
 	}
+#endif /* (CONFIG_SAMPLE_RATE_CONVERTER) */
 
-	switch (m_config.sw_codec) {
-	case SW_CODEC_LC3: {
-#if (CONFIG_SW_CODEC_LC3)
-		int ret;
-		/* Temp storage for split stereo PCM signal */
-		char pcm_data_mono_system_sample_rate[AUDIO_CH_NUM][PCM_NUM_BYTES_MONO] = {0};
-		static uint8_t m_encoded_data[ENC_MAX_FRAME_SIZE * AUDIO_CH_NUM];
-		char pcm_data_mono_converted_buf[AUDIO_CH_NUM][PCM_NUM_BYTES_MONO] = {0};
-		size_t pcm_block_size_mono_system_sample_rate;
-		size_t pcm_block_size_mono;
-		uint16_t encoded_bytes_written;
-		char *pcm_data_mono_ptrs[m_config.encoder.channel_mode];
-
-		// Split stereo PCM stream into mono channels
-		ret = pscm_two_channel_split(pcm_data, pcm_size, CONFIG_AUDIO_BIT_DEPTH_BITS,
-					     pcm_data_mono_system_sample_rate[AUDIO_CH_L],
-					     pcm_data_mono_system_sample_rate[AUDIO_CH_R],
-					     &pcm_block_size_mono_system_sample_rate);
+	src->frames = 0;
+	src->cycles_last = 0;
+	src->cycles_max = 0;
+	src->cycles_total = 0;
+}
+
+/**
+ * @brief	Converts the sample rate of one frame of the uncompressed audio stream.
+ *
+ * @details	Stereo frames are split, each channel is converted with its own
+ *		context and the result is combined again. The output is kept in
+ *		@p src and is valid until the next call.
+ *
+ * @param[in]	src			Converter of the direction.
+ * @param[in]	input_sample_rate	Input sample rate.
+ * @param[in]	output_sample_rate	Output sample rate.
+ * @param[in]	num_ch			Number of interleaved channels, 1 or 2.
+ * @param[in]	input_data		Data coming in.
+ * @param[in]	input_size		Size of input data.
+ * @param[out]	output_data		Pointer to the converted data.
+ * @param[out]	output_size		Number of bytes out.
+ *
+ * @retval	-ENOTSUP	Sample rate conversion has not been enabled in the application.
+ * @retval	0		Success.
+ */
+static int sw_codec_sample_rate_convert(struct sw_codec_src *src, uint32_t input_sample_rate,
+					uint32_t output_sample_rate, uint8_t num_ch,
+					void *input_data, size_t input_size, void **output_data,
+					size_t *output_size)
+{
+#if (CONFIG_SAMPLE_RATE_CONVERTER)
+	int ret;
+	uint32_t start = k_cycle_get_32();
+	size_t in_size_mono;
+	size_t out_size_mono;
+	char *in_mono[AUDIO_CH_NUM];
+
+	if (num_ch == 1) {
+		in_mono[AUDIO_CH_L] = input_data;
+		in_size_mono = input_size;
+	} else {
+		ret = pscm_two_channel_split(input_data, input_size, CONFIG_AUDIO_BIT_DEPTH_BITS,
+					     src->pcm_in_mono[AUDIO_CH_L],
+					     src->pcm_in_mono[AUDIO_CH_R], &in_size_mono);
 		if (ret) {
 			return ret;
 		}
+		in_mono[AUDIO_CH_L] = src->pcm_in_mono[AUDIO_CH_L];
+		in_mono[AUDIO_CH_R] = src->pcm_in_mono[AUDIO_CH_R];
+	}
 
-		// Convert sample rates for each channel
-		for (int i = 0; i < m_config.encoder.channel_mode; ++i) {
-			ret = sw_codec_sample_rate_convert(
-				&encoder_converters[i], CONFIG_AUDIO_SAMPLE_RATE_HZ,
-				m_config.encoder.sample_rate_hz,
-				pcm_data_mono_system_sample_rate[i],
-				pcm_block_size_mono_system_sample_rate,
-				pcm_data_mono_converted_buf[i], &pcm_data_mono_ptrs[i],
-				&pcm_block_size_mono);
-			if (ret) {
-				LOG_ERR("Sample rate conversion failed for channel %d: %d", i, ret);
-				return ret;
-			}
+	for (int i = 0; i < num_ch; i++) {
+		ret = sample_rate_converter_process(&src->ctx[i], SAMPLE_RATE_FILTER_SIMPLE,
+						    in_mono[i], in_size_mono, input_sample_rate,
+						    src->pcm_out_mono[i], PCM_NUM_BYTES_MONO,
+						    &out_size_mono, output_sample_rate);
+		if (ret) {
+			LOG_ERR("Failed to convert sample rate: %d", ret);
+			return ret;
 		}
+	}
 
-		// Encode based on the channel mode
-		switch (m_config.encoder.channel_mode) {
-		case SW_CODEC_MONO: {
-			ret = sw_codec_lc3_enc_run(pcm_data_mono_ptrs[AUDIO_CH_L],
-						   pcm_block_size_mono, LC3_USE_BITRATE_FROM_INIT,
-						   0, sizeof(m_encoded_data), m_encoded_data,
-						   &encoded_bytes_written);
-			if (ret) {
-				return ret;
-			}
-			break;
-		}
-		case SW_CODEC_STEREO: {
-			// Encode left channel
-			ret = sw_codec_lc3_enc_run(pcm_data_mono_ptrs[AUDIO_CH_L],
-						   pcm_block_size_mono, LC3_USE_BITRATE_FROM_INIT,
-						   AUDIO_CH_L, sizeof(m_encoded_data),
-						   m_encoded_data, &encoded_bytes_written);
-			if (ret) {
-				return ret;
-			}
-
-			// Encode right channel
-			ret = sw_codec_lc3_enc_run(
-				pcm_data_mono_ptrs[AUDIO_CH_R], pcm_block_size_mono,
-				LC3_USE_BITRATE_FROM_INIT, AUDIO_CH_R,
-				sizeof(m_encoded_data) - encoded_bytes_written,
-				m_encoded_data + encoded_bytes_written, &encoded_bytes_written);
-			if (ret) {
-				return ret;
-			}
-			encoded_bytes_written +=
-				encoded_bytes_written; // Accumulate total bytes written
-			break;
-		}
-		default:
-			LOG_ERR("Unsupported channel mode for encoder: %d",
-				m_config.encoder.channel_mode);
-			return -ENODEV;
+	if (num_ch == 1) {
+		*output_data = src->pcm_out_mono[AUDIO_CH_L];
+		*output_size = out_size_mono;
+	} else {
+		ret = pscm_combine(src->pcm_out_mono[AUDIO_CH_L], src->pcm_out_mono[AUDIO_CH_R],
+				   out_size_mono, CONFIG_AUDIO_BIT_DEPTH_BITS, src->pcm_out,
+				   output_size);
+		if (ret) {
+			return ret;
 		}
+		*output_data = src->pcm_out;
+	}
 
-		*encoded_data = m_encoded_data;
-		*encoded_size = encoded_bytes_written;
+	src->cycles_last = k_cycle_get_32() - start;
+	src->cycles_max = MAX(src->cycles_max, src->cycles_last);
+	src->cycles_total += src->cycles_last;
+	src->frames++;
 
-#endif /* (CONFIG_SW_CODEC_LC3) */
-		break;
+	return 0;
+#else
+	LOG_ERR("Sample rates are not equal, and sample rate conversion has not been "
+		"enabled in the application.");
+	return -ENOTSUP;
+#endif /* (CONFIG_SAMPLE_RATE_CONVERTER) */
+}
+
+static int sw_codec_sample_rate_check(uint32_t sample_rate_hz)
+{
+	if (sample_rate_hz == CONFIG_AUDIO_SAMPLE_RATE_HZ) {
+		return 0;
 	}
-	case SW_CODEC_OPUS: {
-#if (CONFIG_SW_CODEC_OPUS)
-		uint16_t encoded_bytes_written = 0;
 
-		switch (m_config.encoder.channel_mode) {
-		case SW_CODEC_MONO: {
-			// Handle OPUS mono encoding here if needed
-			// Consider implementing similar to LC3 for mono encoding
-			break;
-		}
-		case SW_CODEC_STEREO: {
-
-			uint32_t start_time = k_uptime_get();
-			encoded_bytes_written =
-				ENC_Opus_Encode((uint8_t *)pcm_data, EncConfigOpus.pInternalMemory);
-			uint32_t end_time = k_uptime_get();
-			LOG_DBG("Opus encoding time: %d ms\n", end_time - start_time);
-
-			if (encoded_bytes_written < 0) {
-				LOG_ERR("Opus encoding failed: %s",
-					opus_strerror(encoded_bytes_written));
-				return encoded_bytes_written;
-			} else {
-				LOG_DBG("Opus encoded output data size: %zu bytes",
-					encoded_bytes_written);
-			}
-			break;
-		}
-		default:
-			LOG_ERR("Unsupported channel mode for encoder: %d",
-				m_config.encoder.channel_mode);
-			return -ENODEV;
-		}
+	if (!IS_ENABLED(CONFIG_SAMPLE_RATE_CONVERTER)) {
+		LOG_ERR("Codec at %d Hz needs CONFIG_SAMPLE_RATE_CONVERTER", sample_rate_hz);
+		return -ENOTSUP;
+	}
 
-		*encoded_data = EncConfigOpus.pInternalMemory;
-		*encoded_size = encoded_bytes_written;
+	/* Buffers are sized for the system rate, the codec may only run slower */
+	if (sample_rate_hz > CONFIG_AUDIO_SAMPLE_RATE_HZ) {
+		LOG_ERR("Codec rate %d Hz above system rate %d Hz", sample_rate_hz,
+			CONFIG_AUDIO_SAMPLE_RATE_HZ);
+		return -EINVAL;
+	}
 
-#endif /* (CONFIG_SW_CODEC_OPUS) */
-		break;
+	return 0;
+}
+
+const struct sw_codec_ops *sw_codec_ops_get(enum sw_codec_select sw_codec)
+{
+	if (sw_codec >= SW_CODEC_NUM) {
+		return NULL;
 	}
-	default:
-		LOG_DBG("No sw codec set for encoding, send uncompressed PCM data directly.");
+
+	return sw_codec_backends[sw_codec];
+}
+
+size_t sw_codec_enc_frame_size_get(void)
+{
+	if (!m_config.encoder.enabled) {
+		return 0;
 	}
 
-	return 0; // Success
+	return m_ops->frame_size_get(&m_config);
+}
+
+bool sw_codec_is_initialized(void)
+{
+	return m_config.initialized;
+}
+
+int sw_codec_encode(void *pcm_data, size_t pcm_size, uint8_t **encoded_data, size_t *encoded_size)
+{
+	int ret;
+	uint32_t start = k_cycle_get_32();
+
+	if (!m_config.encoder.enabled) {
+		LOG_ERR("Encoder has not been initialized");
+		return -ENXIO; // No such device or address
+	}
+
+	if (m_config.encoder.sample_rate_hz != CONFIG_AUDIO_SAMPLE_RATE_HZ) {
+		ret = sw_codec_sample_rate_convert(&enc_src, CONFIG_AUDIO_SAMPLE_RATE_HZ,
+						   m_config.encoder.sample_rate_hz, AUDIO_CH_NUM,
+						   pcm_data, pcm_size, &pcm_data, &pcm_size);
+		if (ret) {
+			return ret;
+		}
+	}
+
+	ret = m_ops->encode(&m_config, pcm_data, pcm_size, encoded_data, encoded_size);
+	if (ret) {
+		return ret;
+	}
+
+	sw_codec_enc_stats_add(*encoded_size);
+
+#if (CONFIG_SW_CODEC_COMPLEXITY_AUTO)
+	sw_codec_complexity_update(k_cycle_get_32() - start);
+#else
+	ARG_UNUSED(start);
+#endif /* (CONFIG_SW_CODEC_COMPLEXITY_AUTO) */
+
+	return 0;
 }
 
 int sw_codec_decode(uint8_t const *const encoded_data, size_t encoded_size, bool bad_frame,
 		    void **decoded_data, size_t *decoded_size)
 {
+	int ret;
+
 	if (!m_config.decoder.enabled) {
 		LOG_ERR("Decoder has not been initialized");
 		return -ENXIO;
 	}
 
-	switch (m_config.sw_codec) {
-	case SW_CODEC_LC3: {
-#if (CONFIG_SW_CODEC_LC3)
-		int ret;
-		size_t pcm_size_stereo = 0;
-		static char pcm_data_stereo[PCM_NUM_BYTES_STEREO];
-		char decoded_data_mono[AUDIO_CH_NUM][PCM_NUM_BYTES_MONO] = {0};
-		char decoded_data_mono_system_sample_rate[AUDIO_CH_NUM][PCM_NUM_BYTES_MONO] = {0};
-
-		size_t pcm_size_mono = 0;
-		size_t decoded_data_size = 0;
-
-		char *pcm_in_data_ptrs[m_config.decoder.channel_mode];
-
-		switch (m_config.decoder.channel_mode) {
-		case SW_CODEC_MONO: {
-			if (bad_frame && IS_ENABLED(CONFIG_SW_CODEC_OVERRIDE_PLC)) {
-				memset(decoded_data_mono[AUDIO_CH_L], 0, PCM_NUM_BYTES_MONO);
-				decoded_data_size = PCM_NUM_BYTES_MONO;
-			} else {
-				ret = sw_codec_lc3_dec_run(
-					encoded_data, encoded_size, LC3_PCM_NUM_BYTES_MONO, 0,
-					decoded_data_mono[AUDIO_CH_L],
-					(uint16_t *)&decoded_data_size, bad_frame);
-				if (ret) {
-					return ret;
-				}
-
-				ret = sw_codec_sample_rate_convert(
-					&decoder_converters[AUDIO_CH_L],
-					m_config.decoder.sample_rate_hz,
-					CONFIG_AUDIO_SAMPLE_RATE_HZ, decoded_data_mono[AUDIO_CH_L],
-					decoded_data_size,
-					decoded_data_mono_system_sample_rate[AUDIO_CH_L],
-					&pcm_in_data_ptrs[AUDIO_CH_L], &pcm_size_mono);
-				if (ret) {
-					LOG_ERR("Sample rate conversion failed for mono: %d", ret);
-					return ret;
-				}
-			}
-
-			/* For now, i2s is only stereo, so in order to send
-			 * just one channel, we need to insert 0 for the
-			 * other channel
-			 */
-			ret = pscm_zero_pad(pcm_in_data_ptrs[AUDIO_CH_L], pcm_size_mono,
-					    m_config.decoder.audio_ch, CONFIG_AUDIO_BIT_DEPTH_BITS,
-					    pcm_data_stereo, &pcm_size_stereo);
-			if (ret) {
-				return ret;
-			}
-			break;
-		}
-		case SW_CODEC_STEREO: {
-			if (bad_frame && IS_ENABLED(CONFIG_SW_CODEC_OVERRIDE_PLC)) {
-				memset(decoded_data_mono[AUDIO_CH_L], 0, PCM_NUM_BYTES_MONO);
-				memset(decoded_data_mono[AUDIO_CH_R], 0, PCM_NUM_BYTES_MONO);
-				decoded_data_size = PCM_NUM_BYTES_MONO;
-			} else {
-				/* Decode left channel */
-				ret = sw_codec_lc3_dec_run(
-					encoded_data, encoded_size / 2, LC3_PCM_NUM_BYTES_MONO,
-					AUDIO_CH_L, decoded_data_mono[AUDIO_CH_L],
-					(uint16_t *)&decoded_data_size, bad_frame);
-				if (ret) {
-					return ret;
-				}
-
-				/* Decode right channel */
-				ret = sw_codec_lc3_dec_run(
-					(encoded_data + (encoded_size / 2)), encoded_size / 2,
-					LC3_PCM_NUM_BYTES_MONO, AUDIO_CH_R,
-					decoded_data_mono[AUDIO_CH_R],
-					(uint16_t *)&decoded_data_size, bad_frame);
-				if (ret) {
-					return ret;
-				}
-
-				for (int i = 0; i < m_config.decoder.channel_mode; ++i) {
-					ret = sw_codec_sample_rate_convert(
-						&decoder_converters[i],
-						m_config.decoder.sample_rate_hz,
-						CONFIG_AUDIO_SAMPLE_RATE_HZ, decoded_data_mono[i],
-						decoded_data_size,
-						decoded_data_mono_system_sample_rate[i],
-						&pcm_in_data_ptrs[i], &pcm_size_mono);
-					if (ret) {
-						LOG_ERR("Sample rate conversion failed for channel "
-							"%d : %d",
-							i, ret);
-						return ret;
-					}
-				}
-			}
-
-			ret = pscm_combine(pcm_in_data_ptrs[AUDIO_CH_L],
-					   pcm_in_data_ptrs[AUDIO_CH_R], pcm_size_mono,
-					   CONFIG_AUDIO_BIT_DEPTH_BITS, pcm_data_stereo,
-					   &pcm_size_stereo);
-			if (ret) {
-				return ret;
-			}
-			break;
-		}
-		default:
-			LOG_ERR("Unsupported channel mode for decoder: %d",
-				m_config.decoder.channel_mode);
-			return -ENODEV;
-		}
-
-		*decoded_size = pcm_size_stereo;
-		*decoded_data = pcm_data_stereo;
-#endif /* (CONFIG_SW_CODEC_LC3) */
-		break;
+	if (m_config.decoder.sample_rate_hz != CONFIG_AUDIO_SAMPLE_RATE_HZ) {
+		/* Decoded at the codec rate, only the converted frame fits the caller */
+		*decoded_data = NULL;
 	}
-	case SW_CODEC_OPUS: {
-#if (CONFIG_SW_CODEC_OPUS)
-		size_t pcm_size_stereo = 0;
-		switch (m_config.decoder.channel_mode) {
-		case SW_CODEC_MONO: {
-			// if (bad_frame && IS_ENABLED(CONFIG_SW_CODEC_OVERRIDE_PLC)) {
-			// 	memset(decoded_data_mono[AUDIO_CH_L], 0, PCM_NUM_BYTES_MONO);
-			// 	decoded_data_size = PCM_NUM_BYTES_MONO;
-			// } else {
-			// 	ret = sw_codec_opus_dec_run(
-			// 		encoded_data, encoded_size, OPUS_PCM_NUM_BYTES_MONO, 0,
-			// 		decoded_data_mono[AUDIO_CH_L],
-			// 		(uint16_t *)&decoded_data_size, bad_frame);
-			// 	if (ret) {
-			// 		return ret;
-			// 	}
-
-			// 	ret = sw_codec_sample_rate_convert(
-			// 		&decoder_converters[AUDIO_CH_L],
-			// 		m_config.decoder.sample_rate_hz,
-			// 		CONFIG_AUDIO_SAMPLE_RATE_HZ, decoded_data_mono[AUDIO_CH_L],
-			// 		decoded_data_size,
-			// 		decoded_data_mono_system_sample_rate[AUDIO_CH_L],
-			// 		&pcm_in_data_ptrs[AUDIO_CH_L], &pcm_size_mono);
-			// 	if (ret) {
-			// 		LOG_ERR("Sample rate conversion failed for mono: %d", ret);
-			// 		return ret;
-			// 	}
-			// }
-
-			// /* For now, i2s is only stereo, so in order to send
-			//  * just one channel, we need to insert 0 for the
-			//  * other channel
-			//  */
-			// ret = pscm_zero_pad(pcm_in_data_ptrs[AUDIO_CH_L], pcm_size_mono,
-			// 		    m_config.decoder.audio_ch, CONFIG_AUDIO_BIT_DEPTH_BITS,
-			// 		    pcm_data_stereo, &pcm_size_stereo);
-			// if (ret) {
-			// 	return ret;
-			// }
-			break;
-		}
-		case SW_CODEC_STEREO: {
-			pcm_size_stereo = DEC_Opus_Decode((uint8_t *)encoded_data, encoded_size,
-							  DecConfigOpus.pInternalMemory);
-			LOG_DBG("pcm fram samples size: %d", pcm_size_stereo);
-			// LOG_HEXDUMP_INF(DecConfigOpus.pInternalMemory, numDec, "PCM Raw Data");
-			break;
-		}
-		default:
-			LOG_ERR("Unsupported channel mode for decoder: %d",
-				m_config.decoder.channel_mode);
-			return -ENODEV;
-		}
 
-		*decoded_size = pcm_size_stereo * 2 * 2;
-		*decoded_data = DecConfigOpus.pInternalMemory;
-#endif /* (CONFIG_SW_CODEC_OPUS) */
-		break;
+	if (bad_frame) {
+		ret = m_ops->plc(&m_config, decoded_data, decoded_size);
+	} else {
+		ret = m_ops->decode(&m_config, encoded_data, encoded_size, decoded_data,
+				    decoded_size);
 	}
-	default:
-		LOG_INF("No sw codec set for decoding, uncompressed PCM data is used.");
+
+	if (ret || m_config.decoder.sample_rate_hz == CONFIG_AUDIO_SAMPLE_RATE_HZ) {
+		return ret;
 	}
-	return 0;
+
+	/* Channel count follows from the size, the PCM backend passes both through */
+	uint8_t num_ch =
+		(*decoded_size > PCM_NUM_BYTES_MONO_RATE(m_config.decoder.sample_rate_hz)) ? 2 : 1;
+
+	return sw_codec_sample_rate_convert(&dec_src, m_config.decoder.sample_rate_hz,
+					    CONFIG_AUDIO_SAMPLE_RATE_HZ, num_ch, *decoded_data,
+					    *decoded_size, decoded_data, decoded_size);
 }
 
 int sw_codec_uninit(struct sw_codec_config sw_codec_cfg)
 {
+	int ret;
+
+	/* m_config is zeroed before the first init, so it matches an SW_CODEC_NONE config */
+	if (m_ops == NULL || !m_config.initialized) {
+		LOG_WRN("Trying to uninit codec, it has not been initialized");
+		return -EALREADY;
+	}
+
 	if (m_config.sw_codec != sw_codec_cfg.sw_codec) {
 		LOG_ERR("Trying to uninit a codec that is not first initialized");
 		return -ENODEV;
 	}
-	switch (m_config.sw_codec) {
-	case SW_CODEC_LC3:
-#if (CONFIG_SW_CODEC_LC3)
-		int ret;
-		if (sw_codec_cfg.encoder.enabled) {
-			if (!m_config.encoder.enabled) {
-				LOG_ERR("Trying to uninit encoder, it has not been "
-					"initialized");
-				return -EALREADY;
-			}
-			ret = sw_codec_lc3_enc_uninit_all();
-			if (ret) {
-				return ret;
-			}
-			m_config.encoder.enabled = false;
-		}
 
-		if (sw_codec_cfg.decoder.enabled) {
-			if (!m_config.decoder.enabled) {
-				LOG_WRN("Trying to uninit decoder, it has not been "
-					"initialized");
-				return -EALREADY;
-			}
-
-			ret = sw_codec_lc3_dec_uninit_all();
-			if (ret) {
-				return ret;
-			}
-			m_config.decoder.enabled = false;
-		}
-#endif /* (CONFIG_SW_CODEC_LC3) */
-		break;
-	case SW_CODEC_OPUS:
-#if (CONFIG_SW_CODEC_OPUS)
-		if (sw_codec_cfg.encoder.enabled) {
-			if (!m_config.encoder.enabled) {
-				LOG_ERR("Trying to uninit encoder, it has not been "
-					"initialized");
-				return -EALREADY;
-			}
-
-			k_free(EncConfigOpus.pInternalMemory);
-			ENC_Opus_Deinit();
+	if (sw_codec_cfg.encoder.enabled && !m_config.encoder.enabled) {
+		LOG_ERR("Trying to uninit encoder, it has not been initialized");
+		return -EALREADY;
+	}
 
-			m_config.encoder.enabled = false;
-		}
+	if (sw_codec_cfg.decoder.enabled && !m_config.decoder.enabled) {
+		LOG_WRN("Trying to uninit decoder, it has not been initialized");
+		return -EALREADY;
+	}
 
-		if (sw_codec_cfg.decoder.enabled) {
-			if (!m_config.decoder.enabled) {
-				LOG_WRN("Trying to uninit decoder, it has not been "
-					"initialized");
-				return -EALREADY;
-			}
+	ret = m_ops->uninit(&sw_codec_cfg);
+	if (ret) {
+		return ret;
+	}
 
-			k_free(DecConfigOpus.pInternalMemory);
-			DEC_Opus_Deinit();
+	if (sw_codec_cfg.encoder.enabled) {
+		m_config.encoder.enabled = false;
+	}
 
-			m_config.decoder.enabled = false;
-		}
-#endif /* (CONFIG_SW_CODEC_OPUS) */
-		break;
-	default:
-		LOG_INF("No sw codec set, so nothing to uninit.");
+	if (sw_codec_cfg.decoder.enabled) {
+		m_config.decoder.enabled = false;
 	}
 
 	m_config.initialized = false;
@@ -493,180 +442,233 @@ int sw_codec_uninit(struct sw_codec_config sw_codec_cfg)
 
 int sw_codec_init(struct sw_codec_config sw_codec_cfg)
 {
+	int ret;
+	const struct sw_codec_ops *ops;
+
 	if (m_config.initialized) {
 		LOG_ERR("Codec is already initialized.");
 		return -EALREADY;
 	}
 
-	switch (sw_codec_cfg.sw_codec) {
-	case SW_CODEC_LC3: {
-#if (CONFIG_SW_CODEC_LC3)
-		int ret;
-		if (m_config.sw_codec != SW_CODEC_LC3) {
-			/* Check if LC3 is already initialized */
-			ret = sw_codec_lc3_init(NULL, NULL, CONFIG_AUDIO_FRAME_DURATION_US);
-			LOG_INF("INFO for debugging4:%d", ret);
-			if (ret) {
-				return ret;
-			}
+	if (sw_codec_cfg.encoder.enabled) {
+		ret = sw_codec_sample_rate_check(sw_codec_cfg.encoder.sample_rate_hz);
+		if (ret) {
+			return ret;
 		}
-		LOG_INF("INFO for debugging5");
-
-		if (sw_codec_cfg.encoder.enabled) {
-			if (m_config.encoder.enabled) {
-				LOG_WRN("The LC3 encoder is already initialized");
-				return -EALREADY;
-			}
-			uint16_t pcm_bytes_req_enc;
-
-			LOG_DBG("Encode: %dHz %dbits %dus %dbps %d channel(s)",
-				sw_codec_cfg.encoder.sample_rate_hz, CONFIG_AUDIO_BIT_DEPTH_BITS,
-				CONFIG_AUDIO_FRAME_DURATION_US, sw_codec_cfg.encoder.bitrate,
-				sw_codec_cfg.encoder.num_ch);
-
-			ret = sw_codec_lc3_enc_init(
-				sw_codec_cfg.encoder.sample_rate_hz, CONFIG_AUDIO_BIT_DEPTH_BITS,
-				CONFIG_AUDIO_FRAME_DURATION_US, sw_codec_cfg.encoder.bitrate,
-				sw_codec_cfg.encoder.num_ch, &pcm_bytes_req_enc);
-
-			if (ret) {
-				return ret;
-			}
+		sw_codec_src_reset(&enc_src);
+	}
+
+	if (sw_codec_cfg.decoder.enabled) {
+		ret = sw_codec_sample_rate_check(sw_codec_cfg.decoder.sample_rate_hz);
+		if (ret) {
+			return ret;
 		}
+		sw_codec_src_reset(&dec_src);
+	}
 
-		if (sw_codec_cfg.decoder.enabled) {
-			if (m_config.decoder.enabled) {
-				LOG_WRN("The LC3 decoder is already initialized");
-				return -EALREADY;
-			}
+	ops = sw_codec_ops_get(sw_codec_cfg.sw_codec);
+	if (ops == NULL) {
+		LOG_ERR("SW codec %d is not compiled in, please open menuconfig and select it",
+			sw_codec_cfg.sw_codec);
+		return -ENODEV;
+	}
 
-			LOG_DBG("Decode: %dHz %dbits %dus %d channel(s)",
-				sw_codec_cfg.decoder.sample_rate_hz, CONFIG_AUDIO_BIT_DEPTH_BITS,
-				CONFIG_AUDIO_FRAME_DURATION_US, sw_codec_cfg.decoder.num_ch);
+	ret = ops->init(&sw_codec_cfg);
+	if (ret) {
+		return ret;
+	}
 
-			ret = sw_codec_lc3_dec_init(
-				sw_codec_cfg.decoder.sample_rate_hz, CONFIG_AUDIO_BIT_DEPTH_BITS,
-				CONFIG_AUDIO_FRAME_DURATION_US, sw_codec_cfg.decoder.num_ch);
+	m_ops = ops;
+	m_config = sw_codec_cfg;
+	m_config.initialized = true;
 
-			if (ret) {
-				return ret;
-			}
+	if (m_config.encoder.enabled) {
+		LOG_INF("%s encoder, max %d bytes per frame", m_ops->name,
+			m_ops->frame_size_get(&m_config));
+		sw_codec_enc_stats_reset();
+#if (CONFIG_SW_CODEC_COMPLEXITY_AUTO)
+		memset(&complexity_ctrl, 0, sizeof(complexity_ctrl));
+#endif /* (CONFIG_SW_CODEC_COMPLEXITY_AUTO) */
+	}
+
+	return 0;
+}
+
+int sw_codec_switch(struct sw_codec_config *sw_codec_cfg, enum sw_codec_select sw_codec)
+{
+	int ret;
+	int err;
+	enum sw_codec_select prev = sw_codec_cfg->sw_codec;
+	bool prev_initialized = sw_codec_cfg->initialized;
+
+	if (prev_initialized) {
+		ret = sw_codec_uninit(*sw_codec_cfg);
+		if (ret) {
+			return ret;
 		}
-		break;
-#else
-		LOG_ERR("LC3 is not compiled in, please open menuconfig and select "
-			"LC3");
-		return -ENODEV;
-#endif /* (CONFIG_SW_CODEC_LC3) */
+
+		sw_codec_cfg->initialized = false;
 	}
-	case SW_CODEC_OPUS: {
-#if (CONFIG_SW_CODEC_OPUS)
-		if (m_config.sw_codec != SW_CODEC_OPUS) {
-			/* Check if OPUS is already initialized */
-			// ret = sw_codec_opus_init(NULL, NULL, CONFIG_AUDIO_FRAME_DURATION_US);
-			// LOG_INF("INFO for debugging:%d", ret);
-			// if (ret) {
-			// 	return ret;
-			// }
+
+	sw_codec_cfg->sw_codec = sw_codec;
+	ret = sw_codec_init(*sw_codec_cfg);
+	if (ret == 0) {
+		sw_codec_cfg->initialized = true;
+		return 0;
+	}
+
+	if (prev_initialized) {
+		/* Go on with the previous codec, the caller decides when to try again */
+		sw_codec_cfg->sw_codec = prev;
+		err = sw_codec_init(*sw_codec_cfg);
+		if (err == 0) {
+			sw_codec_cfg->initialized = true;
+			return ret;
 		}
 
-		if (sw_codec_cfg.encoder.enabled) {
-			if (m_config.encoder.enabled) {
-				LOG_WRN("The OPUS encoder is already initialized");
-				return -EALREADY;
-			}
-
-			LOG_INF("Encode: %dHz %dbits %dms %dbps %d channel(s)",
-				sw_codec_cfg.encoder.sample_rate_hz, CONFIG_AUDIO_BIT_DEPTH_BITS,
-				CONFIG_AUDIO_FRAME_DURATION_US / 1000, sw_codec_cfg.encoder.bitrate,
-				sw_codec_cfg.encoder.num_ch);
-
-			Opus_Status status;
-			if (ENC_Opus_IsConfigured()) {
-				return OPUS_SUCCESS;
-			}
-			EncConfigOpus.ms_frame = CONFIG_AUDIO_FRAME_DURATION_US / 1000;
-			EncConfigOpus.sample_freq = sw_codec_cfg.encoder.sample_rate_hz;
-			EncConfigOpus.channels = sw_codec_cfg.encoder.num_ch;
-			EncConfigOpus.application = (uint16_t)OPUS_APPLICATION_AUDIO;
-			EncConfigOpus.bitrate = sw_codec_cfg.encoder.bitrate;
-			EncConfigOpus.complexity = 0;
-
-			uint32_t enc_max_opus_frame_size = ENC_Opus_getMemorySize(&EncConfigOpus);
-			LOG_INF("enc_max_opus_frame_size: %d", enc_max_opus_frame_size);
-			EncConfigOpus.pInternalMemory =
-				(uint8_t *)k_malloc(enc_max_opus_frame_size);
-			if (EncConfigOpus.pInternalMemory == NULL) {
-				LOG_ERR("Memory allocation failed for Opus encoder.");
-				return -ENOMEM; // or appropriate error code
-			}
-
-			int opus_err;
-			status = ENC_Opus_Init(&EncConfigOpus, &opus_err);
-
-			if (status != OPUS_SUCCESS) {
-				if (EncConfigOpus.pInternalMemory) {
-					k_free(EncConfigOpus.pInternalMemory);
-				}
-				return opus_err;
-			}
+		LOG_ERR("Failed to set up codec %d again: %d", prev, err);
+	}
+
+	/* Nothing is set up, a switch to any codec sets up from scratch */
+	sw_codec_cfg->sw_codec = SW_CODEC_NUM;
+
+	return ret;
+}
+
+static void sw_codec_src_print(const struct shell *shell, const char *name,
+			       const struct sw_codec_src *src, uint32_t input_sample_rate,
+			       uint32_t output_sample_rate)
+{
+	if (input_sample_rate == output_sample_rate) {
+		shell_print(shell, "%s: no conversion", name);
+		return;
+	}
+
+	shell_print(shell, "%s: %d -> %d Hz, %d frames, last %d us, max %d us, avg %d us", name,
+		    input_sample_rate, output_sample_rate, src->frames,
+		    k_cyc_to_us_floor32(src->cycles_last), k_cyc_to_us_floor32(src->cycles_max),
+		    src->frames ? k_cyc_to_us_floor32(src->cycles_total / src->frames) : 0);
+}
+
+static int cmd_sw_codec_src(const struct shell *shell, size_t argc, const char **argv)
+{
+	ARG_UNUSED(argc);
+	ARG_UNUSED(argv);
+
+	if (!m_config.initialized) {
+		shell_error(shell, "SW codec is not initialized");
+		return -EPERM;
+	}
+
+	if (m_config.encoder.enabled) {
+		sw_codec_src_print(shell, "enc", &enc_src, CONFIG_AUDIO_SAMPLE_RATE_HZ,
+				   m_config.encoder.sample_rate_hz);
+	}
+
+	if (m_config.decoder.enabled) {
+		sw_codec_src_print(shell, "dec", &dec_src, m_config.decoder.sample_rate_hz,
+				   CONFIG_AUDIO_SAMPLE_RATE_HZ);
+	}
+
+	return 0;
+}
+
+static int cmd_sw_codec_stats(const struct shell *shell, size_t argc, const char **argv)
+{
+	uint32_t hist_max = 1;
+
+	if (!m_config.encoder.enabled) {
+		shell_error(shell, "Encoder is not initialized");
+		return -EPERM;
+	}
+
+	if (argc == 2) {
+		if (strcmp(argv[1], "reset") != 0) {
+			shell_error(shell, "Usage: sw_codec stats [reset]");
+			return -EINVAL;
 		}
 
-		if (sw_codec_cfg.decoder.enabled) {
-			if (m_config.decoder.enabled) {
-				LOG_WRN("The OPUS decoder is already initialized");
-				if (EncConfigOpus.pInternalMemory) {
-					k_free(EncConfigOpus.pInternalMemory);
-				}
-				return -EALREADY;
-			}
-
-			LOG_INF("Decode: %dHz %dbits %dus %d channel(s)",
-				sw_codec_cfg.decoder.sample_rate_hz, CONFIG_AUDIO_BIT_DEPTH_BITS,
-				CONFIG_AUDIO_FRAME_DURATION_US, sw_codec_cfg.decoder.num_ch);
-
-			Opus_Status status;
-			if (DEC_Opus_IsConfigured()) {
-				return OPUS_SUCCESS;
-			}
-
-			DecConfigOpus.ms_frame = CONFIG_AUDIO_FRAME_DURATION_US / 1000;
-			DecConfigOpus.sample_freq = sw_codec_cfg.decoder.sample_rate_hz;
-			DecConfigOpus.channels = sw_codec_cfg.decoder.num_ch;
-
-			uint32_t dec_max_opus_frame_size = DEC_Opus_getMemorySize(&DecConfigOpus);
-			LOG_INF("dec_max_opus_frame_size: %d", dec_max_opus_frame_size);
-
-			DecConfigOpus.pInternalMemory =
-				(uint8_t *)k_malloc(dec_max_opus_frame_size);
-			if (DecConfigOpus.pInternalMemory == NULL) {
-				LOG_ERR("Memory allocation failed for Opus encoder.");
-				return -ENOMEM; // or appropriate error code
-			}
-
-			int opus_err;
-			status = DEC_Opus_Init(&DecConfigOpus, &opus_err);
-
-			if (status != OPUS_SUCCESS) {
-				if (DecConfigOpus.pInternalMemory) {
-					k_free(EncConfigOpus.pInternalMemory);
-				}
-				return opus_err;
-			}
+		sw_codec_enc_stats_reset();
+		shell_print(shell, "Encoder stats reset");
+		return 0;
+	}
+
+	if (enc_stats.frames == 0) {
+		shell_print(shell, "No frames encoded");
+		return 0;
+	}
+
+	shell_print(shell, "%s: %d frames, %d-%d bytes per frame", m_ops->name, enc_stats.frames,
+		    enc_stats.bytes_min, enc_stats.bytes_max);
+	shell_print(shell, "Bitrate: avg %d bps, peak %d bps",
+		    (uint32_t)(enc_stats.bytes_total * 8 * USEC_PER_SEC /
+			       ((uint64_t)enc_stats.frames * CONFIG_AUDIO_FRAME_DURATION_US)),
+		    (uint32_t)((uint64_t)enc_stats.bytes_max * 8 * USEC_PER_SEC /
+			       CONFIG_AUDIO_FRAME_DURATION_US));
+
+	for (int i = 0; i < ENC_STATS_BINS; i++) {
+		hist_max = MAX(hist_max, enc_stats.hist[i]);
+	}
+
+	for (int i = 0; i < ENC_STATS_BINS; i++) {
+		uint32_t lower = i * enc_stats.bin_width;
+		/* 40 characters for the most used bin */
+		uint32_t bar_len = enc_stats.hist[i] * 40 / hist_max;
+		char bar[41];
+
+		if (enc_stats.hist[i] == 0) {
+			continue;
 		}
-		break;
-#else
-		LOG_ERR("OPUS is not compiled in, please open menuconfig and select "
-			"OPUS");
-		return -ENODEV;
-#endif /* (CONFIG_SW_CODEC_OPUS) */
+
+		memset(bar, '#', bar_len);
+		bar[bar_len] = '\0';
+		shell_print(shell, "%4d-%4d: %8d %s", lower, lower + enc_stats.bin_width - 1,
+			    enc_stats.hist[i], bar);
 	}
-	default:
-		LOG_INF("No sw codec set so no need to initialize, uncompressed PCM data is used.");
+
+	return 0;
+}
+
+#if (CONFIG_SW_CODEC_COMPLEXITY_AUTO)
+static int cmd_sw_codec_complexity(const struct shell *shell, size_t argc, const char **argv)
+{
+	ARG_UNUSED(argc);
+	ARG_UNUSED(argv);
+
+	if (!m_config.encoder.enabled) {
+		shell_error(shell, "Encoder is not initialized");
+		return -EPERM;
 	}
 
-	m_config = sw_codec_cfg;
-	m_config.initialized = true;
+	if (m_ops->complexity_set == NULL) {
+		shell_print(shell, "%s has no complexity setting", m_ops->name);
+		return 0;
+	}
+
+	shell_print(shell, "Complexity %d, %d changes in %d windows of %d frames",
+		    m_config.encoder.complexity, complexity_ctrl.changes, complexity_ctrl.windows,
+		    CONFIG_SW_CODEC_COMPLEXITY_WINDOW);
+	shell_print(shell, "Encode time: p50 %d us, p95 %d us, p99 %d us, max %d us (limit %d us)",
+		    complexity_ctrl.p50_us, complexity_ctrl.p95_us, complexity_ctrl.p99_us,
+		    complexity_ctrl.max_us, COMPLEXITY_LIMIT_US);
+	shell_print(shell, "Raise after %d windows below %d us, %d so far",
+		    MAX(complexity_ctrl.hold, CONFIG_SW_CODEC_COMPLEXITY_RAISE_WINDOWS),
+		    COMPLEXITY_RAISE_US, complexity_ctrl.quiet);
 
 	return 0;
 }
+#endif /* (CONFIG_SW_CODEC_COMPLEXITY_AUTO) */
+
+SHELL_STATIC_SUBCMD_SET_CREATE(sw_codec_cmd,
+			       SHELL_COND_CMD(CONFIG_SHELL, src, NULL,
+					      "Sample rate conversion time per frame",
+					      cmd_sw_codec_src),
+			       SHELL_COND_CMD_ARG(CONFIG_SHELL, stats, NULL,
+						  "Encoded frame size histogram and bitrate [reset]",
+						  cmd_sw_codec_stats, 1, 1),
+			       SHELL_COND_CMD(CONFIG_SW_CODEC_COMPLEXITY_AUTO, complexity, NULL,
+					      "Encoder complexity and encode time percentiles",
+					      cmd_sw_codec_complexity),
+			       SHELL_SUBCMD_SET_END);
+
+SHELL_CMD_REGISTER(sw_codec, &sw_codec_cmd, "SW codec commands", NULL);
@@ -16,43 +16,44 @@
 
 #define LC3_PCM_NUM_BYTES_MONO                                                                     \
 	(CONFIG_AUDIO_SAMPLE_RATE_HZ * CONFIG_AUDIO_BIT_DEPTH_OCTETS * LC3_MAX_FRAME_SIZE_MS / 1000)
-#define LC3_ENC_TIME_US 3000
-#define LC3_DEC_TIME_US 1500
 #else
 #define LC3_ENC_MONO_FRAME_SIZE 0
 #define LC3_PCM_NUM_BYTES_MONO  0
-#define LC3_ENC_TIME_US         0
-#define LC3_DEC_TIME_US         0
 #endif /* CONFIG_SW_CODEC_LC3 */
 
 #if (CONFIG_SW_CODEC_OPUS)
-#define OPUS_MAX_FRAME_SIZE_MS   10
-#define CONFIG_OPUS_BITRATE_MAX  16000
-#define OPUS_ENC_MONO_FRAME_SIZE (CONFIG_OPUS_BITRATE_MAX * OPUS_MAX_FRAME_SIZE_MS / (8 * 1000))
-
-#define OPUS_PCM_NUM_BYTES_MONO                                                                    \
-	(CONFIG_AUDIO_SAMPLE_RATE_HZ * CONFIG_AUDIO_BIT_DEPTH_OCTETS * OPUS_MAX_FRAME_SIZE_MS /    \
-	 1000)
-#define OPUS_ENC_TIME_US 3000
-#define OPUS_DEC_TIME_US 1500
-#else
-#define OPUS_ENC_MONO_FRAME_SIZE 0
-#define OPUS_PCM_NUM_BYTES_MONO  0
-#define OPUS_ENC_TIME_US         0
-#define OPUS_DEC_TIME_US         0
+#if !((CONFIG_AUDIO_FRAME_DURATION_US == 2500) || (CONFIG_AUDIO_FRAME_DURATION_US == 5000) ||     \
+      (CONFIG_AUDIO_FRAME_DURATION_US == 10000) || (CONFIG_AUDIO_FRAME_DURATION_US == 20000) ||   \
+      (CONFIG_OPUS_CUSTOM_MODE && (CONFIG_AUDIO_FRAME_DURATION_US % 1000) == 0))
+#error "Opus only supports 2.5, 5, 10 and 20 ms frame durations, Opus Custom also whole ms"
+#endif
+
+/* Opus (CELT) frame duration, one of 2.5, 5, 10 or 20 ms, or 2 or 4 ms in custom mode */
+#define OPUS_FRAME_DURATION_US CONFIG_AUDIO_FRAME_DURATION_US
 #endif /* CONFIG_SW_CODEC_OPUS */
 
-/* Max will be used when multiple codecs are supported */
-#define ENC_MAX_FRAME_SIZE   MAX(OPUS_ENC_MONO_FRAME_SIZE, 0) // 20 Bytes
-#define ENC_TIME_US          MAX(OPUS_ENC_TIME_US, 0)
-#define DEC_TIME_US          MAX(OPUS_DEC_TIME_US, 0)
-#define PCM_NUM_BYTES_MONO   MAX(OPUS_PCM_NUM_BYTES_MONO, 0) // 960 Bytes
-#define PCM_NUM_BYTES_STEREO (PCM_NUM_BYTES_MONO * 2)        // 1920 Bytes
+/* Opus sizes its packet buffer in opus_interface.c, this is only for LC3 */
+#define ENC_MAX_FRAME_SIZE LC3_ENC_MONO_FRAME_SIZE
+
+/* Uncompressed frame of one channel, the same for all codecs.
+ * Scaled down by 100 twice to stay within 32 bits for 20 ms frames
+ */
+#define PCM_NUM_BYTES_MONO                                                                         \
+	((CONFIG_AUDIO_SAMPLE_RATE_HZ / 100) * CONFIG_AUDIO_BIT_DEPTH_OCTETS *                     \
+	 (CONFIG_AUDIO_FRAME_DURATION_US / 100) / 100) // 960 Bytes at 48 kHz/10 ms
+#define PCM_NUM_BYTES_STEREO (PCM_NUM_BYTES_MONO * 2) // 1920 Bytes at 48 kHz/10 ms
 
+/* Uncompressed frame of one channel at a codec sample rate below the system rate */
+#define PCM_NUM_BYTES_MONO_RATE(r) (PCM_NUM_BYTES_MONO * (r) / CONFIG_AUDIO_SAMPLE_RATE_HZ)
+
+/* The value is sent on air to tell the receiver which decoder to use, do not reorder */
 enum sw_codec_select {
-	SW_CODEC_NONE,
-	SW_CODEC_LC3, /* Low Complexity Communication Codec */
+	SW_CODEC_NONE, /* Uncompressed PCM */
+	SW_CODEC_LC3,  /* Low Complexity Communication Codec */
 	SW_CODEC_OPUS,
+	SW_CODEC_LOSSLESS, /* PCM with fixed prediction and Rice coding */
+	SW_CODEC_ADPCM,    /* IMA ADPCM, 4 bits per sample */
+	SW_CODEC_NUM,
 };
 
 enum sw_codec_channel_mode {
@@ -67,6 +68,7 @@ struct sw_codec_encoder {
 	uint8_t num_ch;
 	enum audio_channel audio_ch;
 	uint32_t sample_rate_hz;
+	uint8_t complexity; /* 0 (fastest) to 10, for codecs that have the setting. */
 };
 
 struct sw_codec_decoder {
@@ -87,6 +89,66 @@ struct sw_codec_config {
 	bool initialized;                /* Status of codec. */
 };
 
+/**
+ * @brief	Operations implemented by a software codec backend.
+ *
+ * @note	The backend is selected by sw_codec_config.sw_codec. Encoded and
+ *		decoded data is kept in memory owned by the backend and stays valid
+ *		until the next call.
+ */
+struct sw_codec_ops {
+	/* Name used in logs and shell commands */
+	const char *name;
+
+	/* Set up the encoder and/or decoder enabled in cfg */
+	int (*init)(const struct sw_codec_config *cfg);
+
+	/* Tear down the encoder and/or decoder enabled in cfg */
+	int (*uninit)(const struct sw_codec_config *cfg);
+
+	/* Encode one stereo PCM frame */
+	int (*encode)(const struct sw_codec_config *cfg, void *pcm_data, size_t pcm_size,
+		      uint8_t **encoded_data, size_t *encoded_size);
+
+	/* Decode one frame, output has the channel count of the decoder. If *pcm_data
+	 * is not NULL the backend may decode into it, else it points *pcm_data to its
+	 * own memory
+	 */
+	int (*decode)(const struct sw_codec_config *cfg, uint8_t const *const encoded_data,
+		      size_t encoded_size, void **pcm_data, size_t *pcm_size);
+
+	/* Conceal one missing frame, output as for decode */
+	int (*plc)(const struct sw_codec_config *cfg, void **pcm_data, size_t *pcm_size);
+
+	/* Upper bound of the encoded size of one frame with the given config */
+	size_t (*frame_size_get)(const struct sw_codec_config *cfg);
+
+	/* Apply cfg->encoder.complexity to the running encoder, NULL if not supported */
+	int (*complexity_set)(const struct sw_codec_config *cfg);
+};
+
+extern const struct sw_codec_ops sw_codec_pcm_ops;
+extern const struct sw_codec_ops sw_codec_lc3_ops;
+extern const struct sw_codec_ops sw_codec_opus_ops;
+extern const struct sw_codec_ops sw_codec_lossless_ops;
+extern const struct sw_codec_ops sw_codec_adpcm_ops;
+
+/**
+ * @brief	Get the backend of a software codec.
+ *
+ * @param[in]	sw_codec	Codec to look up.
+ *
+ * @return	Pointer to the backend, or NULL if the codec is not compiled in.
+ */
+const struct sw_codec_ops *sw_codec_ops_get(enum sw_codec_select sw_codec);
+
+/**
+ * @brief	Get the max encoded size of one frame of the initialized codec.
+ *
+ * @return	Size in bytes, 0 if the encoder is not initialized.
+ */
+size_t sw_codec_enc_frame_size_get(void);
+
 /**
  * @brief	Check if the software codec is initialized.
  *
@@ -113,10 +175,22 @@ int sw_codec_encode(void *pcm_data, size_t pcm_size, uint8_t **encoded_data, siz
 /**
  * @brief	Decode encoded data and output PCM data.
  *
+ * @note	The output has the channel count of the decoder, i.e. a
+ *		SW_CODEC_MONO decoder outputs PCM_NUM_BYTES_MONO per frame and the
+ *		caller is responsible for expanding it to stereo.
+ *
+ * @note	If *pcm_data is not NULL, it is used as a hint of where to put the
+ *		output, a buffer of at least PCM_NUM_BYTES_STEREO. Codecs that can
+ *		decode in place write there, others point *pcm_data to their own
+ *		buffer, so the caller must compare the pointer to see if a copy is
+ *		needed.
+ *
  * @param[in]	encoded_data	Pointer to encoded data.
  * @param[in]	encoded_size	Size of encoded data.
- * @param[in]	bad_frame	Flag to indicate a missing/bad frame (only LC3).
- * @param[out]	pcm_data	Pointer to buffer to store decoded PCM data.
+ * @param[in]	bad_frame	Flag to indicate a missing/bad frame, runs the
+ *				packet loss concealment of the codec.
+ * @param[in,out] pcm_data	Output buffer hint or NULL, pointer to the decoded
+ *				PCM data on return.
  * @param[out]	pcm_size	Size of decoded data.
  *
  * @return	0 if success, error codes depends on sw_codec selected.
@@ -146,4 +220,21 @@ int sw_codec_uninit(struct sw_codec_config sw_codec_cfg);
  */
 int sw_codec_init(struct sw_codec_config sw_codec_cfg);
 
+/**
+ * @brief	Switch the running software codec to another backend.
+ *
+ * @note	The codec set up with @p sw_codec_cfg is torn down first, if
+ *		sw_codec_cfg->initialized is set. If the new codec fails to set
+ *		up, the previous one is set up again so the stream can go on with
+ *		it. If that fails too, nothing is set up and sw_codec_cfg->sw_codec
+ *		is SW_CODEC_NUM, so the next switch to any codec sets up from
+ *		scratch.
+ *
+ * @param[in,out] sw_codec_cfg	Config of the running codec, updated to the codec set up.
+ * @param[in]	sw_codec	Codec to switch to.
+ *
+ * @return	0 if success, else the error of setting up @p sw_codec.
+ */
+int sw_codec_switch(struct sw_codec_config *sw_codec_cfg, enum sw_codec_select sw_codec);
+
 #endif /* _SW_CODEC_SELECT_H_ */
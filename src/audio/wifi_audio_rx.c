@@ -13,13 +13,14 @@
 #include "audio_sync_timer.h"
 #include "wifi_audio_rx.h"
 #include "socket_utils.h"
+#include "audio_i2s.h"
 
 #include <zephyr/logging/log.h>
 LOG_MODULE_REGISTER(wifi_audio_rx, CONFIG_WIFI_AUDIO_RX_LOG_LEVEL);
 
 struct ble_iso_data {
 	// uint8_t data[251];
-	uint8_t data[1920];
+	uint8_t data[FRAME_SIZE_BYTES];
 	size_t data_size;
 	bool bad_frame;
 	uint32_t sdu_ref;
@@ -39,7 +40,9 @@ K_THREAD_STACK_DEFINE(audio_datapath_thread_stack, CONFIG_AUDIO_DATAPATH_STACK_S
 
 struct audio_pcm_data_t {
 	size_t size;
-	uint8_t data[1920];
+	uint8_t sw_codec;
+	uint32_t recv_frame_ts_us;
+	uint8_t data[FRAME_SIZE_BYTES];
 };
 
 #define CONFIG_BUF_WIFI_RX_PACKET_NUM 10
@@ -52,7 +55,7 @@ DATA_FIFO_DEFINE(wifi_audio_rx, CONFIG_BUF_WIFI_RX_PACKET_NUM, sizeof(struct aud
 
 #endif
 static int16_t rx_data_continute_count = 0;
-void audio_data_frame_process(uint8_t *p_data, size_t data_size)
+void audio_data_frame_process(uint8_t sw_codec, uint8_t *p_data, size_t data_size)
 {
 	int ret;
 	uint32_t blocks_alloced_num, blocks_locked_num;
@@ -65,8 +68,8 @@ void audio_data_frame_process(uint8_t *p_data, size_t data_size)
 		ERR_CHK_MSG(-EPERM, "Data received but wifi_audio_rx is not initialized");
 	}
 
-	// /* Capture timestamp of when audio frame is received */
-	// uint32_t recv_frame_ts = audio_sync_timer_capture();
+	/* Capture timestamp of when audio frame is received */
+	uint32_t recv_frame_ts_us = audio_sync_timer_capture();
 
 	// rx_stats[channel_index].recv_cnt++;
 
@@ -139,8 +142,9 @@ void audio_data_frame_process(uint8_t *p_data, size_t data_size)
 	memcpy(data_received->data, p_data, data_size);
 	// iso_received->bad_frame = bad_frame;
 	data_received->size = data_size;
+	data_received->sw_codec = sw_codec;
 	// iso_received->sdu_ref = sdu_ref;
-	// iso_received->recv_frame_ts = recv_frame_ts;
+	data_received->recv_frame_ts_us = recv_frame_ts_us;
 
 	ret = data_fifo_block_lock(&wifi_audio_rx, (void *)&data_received,
 				   sizeof(struct audio_pcm_data_t));
@@ -149,8 +153,8 @@ void audio_data_frame_process(uint8_t *p_data, size_t data_size)
 
 #define TOTAL_PACKET_SIZE (1024 + 896) // Total size of the two packets to be assembled
 
-#define MAX_AUDIO_FRAME_SIZE 1920
-#define HEADER_SIZE          3 // Start sequence (2 bytes) + identifier (1 byte)
+#define MAX_AUDIO_FRAME_SIZE FRAME_SIZE_BYTES
+#define HEADER_SIZE          5 // Start sequence (2) + identifier (1) + version (1) + codec (1)
 #define FOOTER_SIZE          2 // End sequence (2 bytes)
 #define FULL_FRAME_SIZE      (HEADER_SIZE + MAX_AUDIO_FRAME_SIZE + FOOTER_SIZE)
 
@@ -183,15 +187,20 @@ void wifi_audio_rx_data_handler(uint8_t *p_data, size_t data_size)
 			    frame_buffer[current_frame_size - 2] == END_SEQUENCE_1 &&
 			    frame_buffer[current_frame_size - 1] == END_SEQUENCE_2) {
 
-				// Verify the identifier
-				if (frame_buffer[2] == SEND_DATA_SIGN) {
+				// Verify the identifier and the header version
+				if (frame_buffer[2] == SEND_DATA_SIGN &&
+				    frame_buffer[3] != SEND_DATA_VERSION) {
+					LOG_ERR("Unsupported data version %d, expected %d",
+						frame_buffer[3], SEND_DATA_VERSION);
+				} else if (frame_buffer[2] == SEND_DATA_SIGN) {
 					// Calculate audio data length
 					size_t audio_data_length =
 						current_frame_size - HEADER_SIZE - FOOTER_SIZE;
 					if (audio_data_length <= MAX_AUDIO_FRAME_SIZE) {
 
 						// Process the audio data
-						audio_data_frame_process(frame_buffer + HEADER_SIZE,
+						audio_data_frame_process(frame_buffer[4],
+									 frame_buffer + HEADER_SIZE,
 									 audio_data_length);
 						LOG_DBG("Audio frame data length: %d",
 							audio_data_length);
@@ -232,7 +241,18 @@ static void audio_datapath_thread(void *dummy1, void *dummy2, void *dummy3)
 			//                          iso_received->bad_frame);
 			ERR_CHK(ret);
 		} else {
-			audio_datapath_stream_out(iso_received->data, iso_received->size);
+			if (iso_received->size == 0) {
+				/* Empty frame, the gateway is silent and sends nothing (DTX) */
+				audio_datapath_dtx_start();
+			} else {
+				/* Follow the codec the gateway is sending with, frames that
+				 * cannot be decoded are dropped and counted
+				 */
+				(void)audio_system_stream_out(iso_received->sw_codec,
+							      iso_received->data,
+							      iso_received->size,
+							      iso_received->recv_frame_ts_us);
+			}
 		}
 		data_fifo_block_free(&wifi_audio_rx, (void *)iso_received);
 
@@ -297,10 +317,10 @@ void send_audio_command(uint8_t audio_command)
 	socket_utils_tx_data((uint8_t *)command_packet, packet_size);
 }
 
-void send_audio_frame(uint8_t *audio_data, size_t data_length)
+void send_audio_frame(uint8_t sw_codec, uint8_t *audio_data, size_t data_length)
 {
 	// Define the data packet size, including start and end sequences
-	size_t total_packet_size = 5 + data_length; // 4 bytes for headers + data_length
+	size_t total_packet_size = 7 + data_length; // 5 bytes header + 2 bytes footer
 
 	// Create a buffer for the complete data packet
 	uint8_t *data_packet = (uint8_t *)k_malloc(total_packet_size);
@@ -310,12 +330,14 @@ void send_audio_frame(uint8_t *audio_data, size_t data_length)
 	}
 
 	// Fill the data packet with the specified format
-	data_packet[0] = START_SEQUENCE_1; // 0xFF
-	data_packet[1] = START_SEQUENCE_2; // 0xAA
-	data_packet[2] = SEND_DATA_SIGN;   // Data identifier (can be changed as needed)
+	data_packet[0] = START_SEQUENCE_1;  // 0xFF
+	data_packet[1] = START_SEQUENCE_2;  // 0xAA
+	data_packet[2] = SEND_DATA_SIGN;    // Data identifier (can be changed as needed)
+	data_packet[3] = SEND_DATA_VERSION; // Header layout version
+	data_packet[4] = sw_codec;          // enum sw_codec_select the data is encoded with
 
 	// Copy the audio data into the packet starting at the offset for the actual data
-	bytecpy(data_packet + 3, audio_data, data_length); // 3rd byte is data identifier
+	bytecpy(data_packet + 5, audio_data, data_length);
 
 	// Fill the end header
 	data_packet[total_packet_size - 2] = END_SEQUENCE_1; // 0xFF
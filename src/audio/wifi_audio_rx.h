@@ -15,9 +15,19 @@
 #define AUDIO_START_CMD  0x00
 #define AUDIO_STOP_CMD   0x01
 
+/* Layout of the data packet header after the identifier, bump when it changes */
+#define SEND_DATA_VERSION 0x02
+
 void send_audio_command(uint8_t audio_command);
 
-void send_audio_frame(uint8_t *audio_data, size_t data_length);
+/**
+ * @brief Send one encoded audio frame.
+ *
+ * @param[in] sw_codec		Codec the frame is encoded with, sent along to select the decoder.
+ * @param[in] audio_data	Pointer to the encoded frame.
+ * @param[in] data_length	Size of the encoded frame.
+ */
+void send_audio_frame(uint8_t sw_codec, uint8_t *audio_data, size_t data_length);
 
 /**
  * @brief Data handler when audio data has been received through WiFi.
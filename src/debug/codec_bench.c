@@ -0,0 +1,903 @@
+/*
+ * Copyright (c) 2025 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+/** @file
+ * @brief Opus codec benchmark
+ *
+ * Runs the Opus encoder and decoder over a synthetic test signal for every
+ * supported frame duration, channel count, bitrate and complexity and prints
+ * one CSV row per case. Each case runs in its own thread so the peak stack
+ * use of the codec can be read back afterwards.
+ *
+ * The src command measures the THD+N and time per frame of the sample rate
+ * converter used between the audio system and the codec.
+ *
+ * The latency command measures the codec delay and SNR of standard Opus and,
+ * when built in, Opus Custom frames by cross-correlating the decoded output
+ * with a pseudo-random input.
+ *
+ * The multistream command compares one stereo stream with two uncoupled
+ * mono streams, timing the decode of each stream on its own as a headset
+ * that plays one channel does.
+ */
+
+#define MODULE codec_bench
+
+#include <stdlib.h>
+#include <math.h>
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+#include <zephyr/shell/shell.h>
+#include <tone.h>
+#include <sample_rate_converter.h>
+
+#include "opus_interface.h"
+#include "sw_codec_opus.h"
+#include "sw_codec_select.h"
+
+LOG_MODULE_REGISTER(MODULE, CONFIG_CODEC_BENCH_LOG_LEVEL);
+
+#define BENCH_FRAME_US_MAX   20000
+#define BENCH_CH_MAX         2
+#define BENCH_BITRATE_MAX    320000
+#define BENCH_SAMPLES_MAX    (CONFIG_AUDIO_SAMPLE_RATE_HZ / 1000 * BENCH_FRAME_US_MAX / 1000)
+/* Matches the 2x average packet size allowed by ENC_Opus_Init, or the largest VBR packet
+ * of each multistream stream
+ */
+#define BENCH_ENC_BUF_SIZE                                                                         \
+	MAX(BENCH_BITRATE_MAX / 8 * (BENCH_FRAME_US_MAX / 1000) / 1000 * 2, 1275 * BENCH_CH_MAX)
+#define BENCH_TONE_FREQ_HZ   1000
+#define BENCH_NOISE_SHIFT    20
+
+static const uint16_t bench_frame_us[] = {2500, 5000, 10000, 20000};
+static const uint8_t bench_ch[] = {1, 2};
+static const uint32_t bench_bitrate[] = {64000, 128000, 192000, 256000, 320000};
+static const uint8_t bench_complexity[] = {0, 5, 10};
+
+struct bench_case {
+	uint16_t frame_us;
+	uint8_t ch;
+	uint32_t bitrate;
+	uint8_t complexity;
+};
+
+struct bench_result {
+	int err;
+	uint32_t enc_total_us;
+	uint32_t dec_total_us;
+	uint32_t enc_bytes_total;
+	uint32_t stack_used;
+	uint32_t scratch_used;
+};
+
+K_THREAD_STACK_DEFINE(codec_bench_stack, CONFIG_CODEC_BENCH_STACK_SIZE);
+static struct k_thread codec_bench_thread_data;
+
+static int16_t pcm_in[BENCH_SAMPLES_MAX * BENCH_CH_MAX];
+static int16_t pcm_out[BENCH_SAMPLES_MAX * BENCH_CH_MAX];
+static uint8_t enc_buf[BENCH_ENC_BUF_SIZE];
+static uint32_t enc_us[CONFIG_CODEC_BENCH_FRAMES];
+static uint32_t dec_us[CONFIG_CODEC_BENCH_FRAMES];
+
+static int16_t tone_buf[CONFIG_AUDIO_SAMPLE_RATE_HZ / BENCH_TONE_FREQ_HZ];
+static size_t tone_size;
+
+static struct bench_case cur_case;
+static struct bench_result cur_result;
+
+static int u32_cmp(const void *a, const void *b)
+{
+	uint32_t x = *(const uint32_t *)a;
+	uint32_t y = *(const uint32_t *)b;
+
+	return (x > y) - (x < y);
+}
+
+static uint32_t percentile(uint32_t *sorted, uint32_t num, uint32_t pct)
+{
+	return sorted[((num - 1) * pct) / 100];
+}
+
+/**
+ * @brief Fill one frame with a 1 kHz tone plus low level white noise, right
+ *	  channel phase shifted, continuing from the previous frame.
+ */
+static void test_signal_fill(int16_t *pcm, uint32_t samples, uint8_t ch)
+{
+	static uint32_t pos;
+	static uint32_t lcg = 1;
+	uint32_t tone_samples = tone_size / sizeof(int16_t);
+
+	for (uint32_t i = 0; i < samples; i++) {
+		for (uint8_t c = 0; c < ch; c++) {
+			uint32_t idx = (pos + c * (tone_samples / 4)) % tone_samples;
+
+			lcg = lcg * 1664525 + 1013904223;
+			pcm[i * ch + c] = (tone_buf[idx] / 2) + ((int32_t)lcg >> BENCH_NOISE_SHIFT);
+		}
+		pos++;
+	}
+}
+
+static void codec_bench_thread(void *arg1, void *arg2, void *arg3)
+{
+	struct bench_case *bc = arg1;
+	struct bench_result *res = arg2;
+	uint32_t samples = CONFIG_AUDIO_SAMPLE_RATE_HZ / 1000 * bc->frame_us / 1000;
+	ENC_Opus_ConfigTypeDef enc_cfg = {0};
+	DEC_Opus_ConfigTypeDef dec_cfg = {0};
+	int opus_err;
+	int ret;
+
+	ARG_UNUSED(arg3);
+
+	enc_cfg.ms_frame = bc->frame_us / 1000.0f;
+	enc_cfg.sample_freq = CONFIG_AUDIO_SAMPLE_RATE_HZ;
+	enc_cfg.channels = bc->ch;
+	enc_cfg.application = (uint16_t)OPUS_APPLICATION_AUDIO;
+	enc_cfg.bitrate = bc->bitrate;
+	enc_cfg.complexity = bc->complexity;
+	/* Same bandwidth and signal settings as the audio system without a profile */
+	sw_codec_opus_profile_apply(NULL, &enc_cfg);
+
+	dec_cfg.ms_frame = enc_cfg.ms_frame;
+	dec_cfg.sample_freq = enc_cfg.sample_freq;
+	dec_cfg.channels = bc->ch;
+
+	if (ENC_Opus_Init(&enc_cfg, &opus_err) != OPUS_SUCCESS) {
+		res->err = opus_err;
+		goto out;
+	}
+
+	if (DEC_Opus_Init(&dec_cfg, &opus_err) != OPUS_SUCCESS) {
+		res->err = opus_err;
+		goto out;
+	}
+
+	for (uint32_t i = 0; i < CONFIG_CODEC_BENCH_FRAMES; i++) {
+		uint32_t start;
+
+		test_signal_fill(pcm_in, samples, bc->ch);
+
+		start = k_cycle_get_32();
+		ret = ENC_Opus_Encode((uint8_t *)pcm_in, enc_buf);
+		enc_us[i] = k_cyc_to_us_floor32(k_cycle_get_32() - start);
+		if (ret < 0) {
+			res->err = ret;
+			goto out;
+		}
+		res->enc_bytes_total += ret;
+
+		start = k_cycle_get_32();
+		ret = DEC_Opus_Decode(enc_buf, ret, (uint8_t *)pcm_out);
+		dec_us[i] = k_cyc_to_us_floor32(k_cycle_get_32() - start);
+		if (ret < 0) {
+			res->err = ret;
+			goto out;
+		}
+
+		res->enc_total_us += enc_us[i];
+		res->dec_total_us += dec_us[i];
+	}
+
+out:
+	ENC_Opus_Deinit();
+	DEC_Opus_Deinit();
+}
+
+static int bench_case_run(const struct shell *shell, struct bench_case *bc)
+{
+	int ret;
+	size_t stack_unused = 0;
+	uint32_t scratch_size;
+	uint32_t frames = CONFIG_CODEC_BENCH_FRAMES;
+	uint32_t budget_us = bc->frame_us * CONFIG_CODEC_BENCH_BUDGET_PERCENT / 100;
+	uint32_t enc_p99;
+	uint32_t dec_p99;
+
+	memset(&cur_result, 0, sizeof(cur_result));
+	cur_case = *bc;
+	Opus_Scratch_ResetUsage();
+
+	k_thread_create(&codec_bench_thread_data, codec_bench_stack,
+			K_THREAD_STACK_SIZEOF(codec_bench_stack), codec_bench_thread, &cur_case,
+			&cur_result, NULL, K_PRIO_PREEMPT(CONFIG_ENCODER_THREAD_PRIO), 0,
+			K_NO_WAIT);
+	k_thread_join(&codec_bench_thread_data, K_FOREVER);
+
+	ret = k_thread_stack_space_get(&codec_bench_thread_data, &stack_unused);
+	if (ret) {
+		LOG_WRN("Unable to get stack space: %d", ret);
+	}
+	cur_result.stack_used = K_THREAD_STACK_SIZEOF(codec_bench_stack) - stack_unused;
+	cur_result.scratch_used = Opus_Scratch_GetUsage(&scratch_size);
+
+	if (cur_result.err) {
+		shell_print(shell, "%u,%u,%u,%u,error %d", bc->frame_us, bc->ch, bc->bitrate,
+			    bc->complexity, cur_result.err);
+		return 0;
+	}
+
+	qsort(enc_us, frames, sizeof(enc_us[0]), u32_cmp);
+	qsort(dec_us, frames, sizeof(dec_us[0]), u32_cmp);
+	enc_p99 = percentile(enc_us, frames, 99);
+	dec_p99 = percentile(dec_us, frames, 99);
+
+	shell_print(shell, "%u,%u,%u,%u,%u,%u,%u,%u,%u,%u,%u,%u,%u,%u,%u,%d,%d,%u,%s", bc->frame_us,
+		    bc->ch, bc->bitrate, bc->complexity,
+		    (uint32_t)((uint64_t)frames * USEC_PER_SEC / MAX(cur_result.enc_total_us, 1)),
+		    percentile(enc_us, frames, 50), enc_p99, enc_us[frames - 1],
+		    (uint32_t)((uint64_t)frames * USEC_PER_SEC / MAX(cur_result.dec_total_us, 1)),
+		    percentile(dec_us, frames, 50), dec_p99, dec_us[frames - 1],
+		    cur_result.enc_bytes_total / frames, cur_result.stack_used,
+		    cur_result.scratch_used,
+		    opus_encoder_get_size(bc->ch), opus_decoder_get_size(bc->ch), budget_us,
+		    (MAX(enc_p99, dec_p99) <= budget_us) ? "ok" : "over");
+
+	return 0;
+}
+
+static int bench_prepare_signal(const struct shell *shell)
+{
+	int ret;
+
+	if (sw_codec_is_initialized()) {
+		shell_error(shell, "Stop the audio system before running the benchmark");
+		return -EBUSY;
+	}
+
+	ret = tone_gen(tone_buf, &tone_size, BENCH_TONE_FREQ_HZ, CONFIG_AUDIO_SAMPLE_RATE_HZ, 1);
+	if (ret) {
+		shell_error(shell, "Failed to generate test signal: %d", ret);
+		return ret;
+	}
+
+	return 0;
+}
+
+static int bench_prepare(const struct shell *shell)
+{
+	int ret;
+
+	ret = bench_prepare_signal(shell);
+	if (ret) {
+		return ret;
+	}
+
+	shell_print(shell, "frame_us,ch,bitrate,cplx,enc_fps,enc_p50_us,enc_p99_us,enc_max_us,"
+			   "dec_fps,dec_p50_us,dec_p99_us,dec_max_us,pkt_bytes,stack_bytes,"
+			   "scratch_bytes,enc_state_bytes,dec_state_bytes,budget_us,rt");
+
+	return 0;
+}
+
+static int cmd_codec_bench_run(const struct shell *shell, size_t argc, const char **argv)
+{
+	int ret;
+	struct bench_case bc;
+
+	ret = bench_prepare(shell);
+	if (ret) {
+		return ret;
+	}
+
+	for (int f = 0; f < ARRAY_SIZE(bench_frame_us); f++) {
+		for (int c = 0; c < ARRAY_SIZE(bench_ch); c++) {
+			for (int b = 0; b < ARRAY_SIZE(bench_bitrate); b++) {
+				for (int x = 0; x < ARRAY_SIZE(bench_complexity); x++) {
+					bc.frame_us = bench_frame_us[f];
+					bc.ch = bench_ch[c];
+					bc.bitrate = bench_bitrate[b];
+					bc.complexity = bench_complexity[x];
+
+					ret = bench_case_run(shell, &bc);
+					if (ret) {
+						return ret;
+					}
+				}
+			}
+		}
+	}
+
+	return 0;
+}
+
+static bool bench_frame_us_valid(uint32_t frame_us)
+{
+	for (int f = 0; f < ARRAY_SIZE(bench_frame_us); f++) {
+		if (frame_us == bench_frame_us[f]) {
+			return true;
+		}
+	}
+
+	return false;
+}
+
+static int cmd_codec_bench_case(const struct shell *shell, size_t argc, const char **argv)
+{
+	int ret;
+	struct bench_case bc;
+
+	if (argc != 5) {
+		shell_error(shell, "4 arguments (frame [us], channels, bitrate [bps] and complexity "
+				   "[0-10]) must be provided");
+		return -EINVAL;
+	}
+
+	/* Parsed at full width, the case fields would truncate out of range values */
+	unsigned long frame_us = strtoul(argv[1], NULL, 10);
+	unsigned long ch = strtoul(argv[2], NULL, 10);
+	unsigned long bitrate = strtoul(argv[3], NULL, 10);
+	unsigned long complexity = strtoul(argv[4], NULL, 10);
+
+	if (ch == 0 || ch > BENCH_CH_MAX || bitrate > BENCH_BITRATE_MAX || complexity > 10) {
+		shell_error(shell, "Argument out of range");
+		return -EINVAL;
+	}
+
+	if (!bench_frame_us_valid(frame_us)) {
+		shell_error(shell, "Frame duration must be 2500, 5000, 10000 or 20000 us");
+		return -EINVAL;
+	}
+
+	bc.frame_us = frame_us;
+	bc.ch = ch;
+	bc.bitrate = bitrate;
+	bc.complexity = complexity;
+
+	ret = bench_prepare(shell);
+	if (ret) {
+		return ret;
+	}
+
+	return bench_case_run(shell, &bc);
+}
+
+#define MS_COMPLEXITY 5
+
+enum ms_mode {
+	MS_STEREO,
+	MS_STREAM_L,
+	MS_STREAM_R,
+};
+
+static const char *const ms_mode_str[] = {"stereo", "stream_l", "stream_r"};
+static const uint32_t ms_bitrate[] = {128000, 256000};
+
+struct ms_case {
+	uint16_t frame_us;
+	uint32_t bitrate;
+	enum ms_mode mode;
+};
+
+static struct ms_case ms_case;
+
+/**
+ * @brief Code stereo frames as one stereo stream, or as two mono streams of which only
+ *	  one is decoded.
+ */
+static void codec_bench_ms_thread(void *arg1, void *arg2, void *arg3)
+{
+	struct ms_case *mc = arg1;
+	struct bench_result *res = arg2;
+	uint32_t samples = CONFIG_AUDIO_SAMPLE_RATE_HZ / 1000 * mc->frame_us / 1000;
+	ENC_Opus_ConfigTypeDef enc_cfg = {0};
+	DEC_Opus_ConfigTypeDef dec_cfg = {0};
+	int opus_err;
+	int ret;
+
+	ARG_UNUSED(arg3);
+
+	enc_cfg.ms_frame = mc->frame_us / 1000.0f;
+	enc_cfg.sample_freq = CONFIG_AUDIO_SAMPLE_RATE_HZ;
+	enc_cfg.channels = BENCH_CH_MAX;
+	enc_cfg.application = (uint16_t)OPUS_APPLICATION_AUDIO;
+	enc_cfg.bitrate = mc->bitrate;
+	enc_cfg.complexity = MS_COMPLEXITY;
+	sw_codec_opus_profile_apply(NULL, &enc_cfg);
+
+	dec_cfg.ms_frame = enc_cfg.ms_frame;
+	dec_cfg.sample_freq = enc_cfg.sample_freq;
+	dec_cfg.channels = BENCH_CH_MAX;
+
+	if (mc->mode != MS_STEREO) {
+		/* One uncoupled stream per channel, as with CONFIG_OPUS_MULTISTREAM */
+		enc_cfg.streams = BENCH_CH_MAX;
+		enc_cfg.coupled_streams = 0;
+		dec_cfg.channels = 1;
+		dec_cfg.streams = BENCH_CH_MAX;
+		dec_cfg.stream_id = (mc->mode == MS_STREAM_L) ? 0 : 1;
+	}
+
+	if (ENC_Opus_Init(&enc_cfg, &opus_err) != OPUS_SUCCESS) {
+		res->err = opus_err;
+		goto out;
+	}
+
+	if (DEC_Opus_Init(&dec_cfg, &opus_err) != OPUS_SUCCESS) {
+		res->err = opus_err;
+		goto out;
+	}
+
+	for (uint32_t i = 0; i < CONFIG_CODEC_BENCH_FRAMES; i++) {
+		uint32_t start;
+
+		test_signal_fill(pcm_in, samples, BENCH_CH_MAX);
+
+		start = k_cycle_get_32();
+		ret = ENC_Opus_Encode((uint8_t *)pcm_in, enc_buf);
+		enc_us[i] = k_cyc_to_us_floor32(k_cycle_get_32() - start);
+		if (ret < 0) {
+			res->err = ret;
+			goto out;
+		}
+		res->enc_bytes_total += ret;
+
+		start = k_cycle_get_32();
+		ret = DEC_Opus_Decode(enc_buf, ret, (uint8_t *)pcm_out);
+		dec_us[i] = k_cyc_to_us_floor32(k_cycle_get_32() - start);
+		if (ret < 0) {
+			res->err = ret;
+			goto out;
+		}
+	}
+
+out:
+	ENC_Opus_Deinit();
+	DEC_Opus_Deinit();
+}
+
+static void ms_case_run(const struct shell *shell, struct ms_case *mc)
+{
+	uint32_t frames = CONFIG_CODEC_BENCH_FRAMES;
+
+	memset(&cur_result, 0, sizeof(cur_result));
+	ms_case = *mc;
+
+	k_thread_create(&codec_bench_thread_data, codec_bench_stack,
+			K_THREAD_STACK_SIZEOF(codec_bench_stack), codec_bench_ms_thread, &ms_case,
+			&cur_result, NULL, K_PRIO_PREEMPT(CONFIG_ENCODER_THREAD_PRIO), 0,
+			K_NO_WAIT);
+	k_thread_join(&codec_bench_thread_data, K_FOREVER);
+
+	if (cur_result.err) {
+		shell_print(shell, "%u,%u,%s,error %d", mc->frame_us, mc->bitrate,
+			    ms_mode_str[mc->mode], cur_result.err);
+		return;
+	}
+
+	qsort(enc_us, frames, sizeof(enc_us[0]), u32_cmp);
+	qsort(dec_us, frames, sizeof(dec_us[0]), u32_cmp);
+
+	shell_print(shell, "%u,%u,%s,%u,%u,%u,%u,%u", mc->frame_us, mc->bitrate,
+		    ms_mode_str[mc->mode], percentile(enc_us, frames, 50),
+		    percentile(enc_us, frames, 99), percentile(dec_us, frames, 50),
+		    percentile(dec_us, frames, 99), cur_result.enc_bytes_total / frames);
+}
+
+/**
+ * @brief Time one stereo stream against two mono streams at the same total bitrate. The
+ *	  stream_l and stream_r rows time the decode of a single channel, the cost on a
+ *	  headset with CONFIG_OPUS_MULTISTREAM.
+ */
+static int cmd_codec_bench_multistream(const struct shell *shell, size_t argc, const char **argv)
+{
+	int ret;
+	struct ms_case mc;
+
+	ARG_UNUSED(argc);
+	ARG_UNUSED(argv);
+
+	ret = bench_prepare_signal(shell);
+	if (ret) {
+		return ret;
+	}
+
+	shell_print(shell, "frame_us,bitrate,mode,enc_p50_us,enc_p99_us,dec_p50_us,dec_p99_us,"
+			   "pkt_bytes");
+
+	for (int f = 0; f < ARRAY_SIZE(bench_frame_us); f++) {
+		for (int b = 0; b < ARRAY_SIZE(ms_bitrate); b++) {
+			for (int m = MS_STEREO; m <= MS_STREAM_R; m++) {
+				mc.frame_us = bench_frame_us[f];
+				mc.bitrate = ms_bitrate[b];
+				mc.mode = m;
+				ms_case_run(shell, &mc);
+			}
+		}
+	}
+
+	return 0;
+}
+
+#define LATENCY_CH         1
+#define LATENCY_BITRATE    128000
+#define LATENCY_SETTLE_US  20000
+#define LATENCY_MEASURE_US 100000
+#define LATENCY_LAG_MAX    (CONFIG_AUDIO_SAMPLE_RATE_HZ / 1000 * 15)
+
+enum latency_codec {
+	LATENCY_OPUS,
+	LATENCY_OPUS_CUSTOM,
+};
+
+static const char *const latency_codec_str[] = {"opus", "custom"};
+static const uint16_t latency_frame_us[] = {2500, 5000, 10000};
+static const uint16_t latency_custom_frame_us[] = {2000, 4000, 5000, 10000};
+
+struct latency_case {
+	uint16_t frame_us;
+	enum latency_codec codec;
+};
+
+struct latency_result {
+	int err;
+	uint32_t delay_samples;
+	uint32_t enc_max_us;
+	uint32_t dec_max_us;
+	uint32_t enc_bytes_total;
+	int32_t snr_tenth_db;
+};
+
+static struct latency_case latency_case;
+static struct latency_result latency_result;
+static int64_t latency_xcorr[LATENCY_LAG_MAX + 1];
+
+/**
+ * @brief White noise sample at an absolute position, so the input at any lag can be
+ *	  regenerated instead of stored.
+ */
+static int16_t latency_noise(uint32_t n)
+{
+	n ^= n >> 16;
+	n *= 0x7feb352d;
+	n ^= n >> 15;
+	n *= 0x846ca68b;
+	n ^= n >> 16;
+
+	return (int16_t)((int32_t)n >> 19);
+}
+
+static int latency_codec_init(const struct latency_case *lc)
+{
+	ENC_Opus_ConfigTypeDef enc_cfg = {0};
+	DEC_Opus_ConfigTypeDef dec_cfg = {0};
+	int opus_err;
+
+	enc_cfg.ms_frame = lc->frame_us / 1000.0f;
+	enc_cfg.sample_freq = CONFIG_AUDIO_SAMPLE_RATE_HZ;
+	enc_cfg.channels = LATENCY_CH;
+	enc_cfg.application = (uint16_t)OPUS_APPLICATION_AUDIO;
+	enc_cfg.bitrate = LATENCY_BITRATE;
+	enc_cfg.custom = (lc->codec == LATENCY_OPUS_CUSTOM);
+	sw_codec_opus_profile_apply(NULL, &enc_cfg);
+
+	dec_cfg.ms_frame = enc_cfg.ms_frame;
+	dec_cfg.sample_freq = enc_cfg.sample_freq;
+	dec_cfg.channels = LATENCY_CH;
+	dec_cfg.custom = enc_cfg.custom;
+
+	if (ENC_Opus_Init(&enc_cfg, &opus_err) != OPUS_SUCCESS) {
+		return opus_err;
+	}
+
+	if (DEC_Opus_Init(&dec_cfg, &opus_err) != OPUS_SUCCESS) {
+		return opus_err;
+	}
+
+	return 0;
+}
+
+static void latency_codec_uninit(void)
+{
+	ENC_Opus_Deinit();
+	DEC_Opus_Deinit();
+}
+
+/**
+ * @brief Code one mono frame from pcm_in to pcm_out.
+ *
+ * @return Encoded size, or a negative error code.
+ */
+static int latency_frame_code(struct latency_result *res)
+{
+	uint32_t start;
+	uint32_t time_us;
+	size_t encoded_size;
+	int ret;
+
+	start = k_cycle_get_32();
+	ret = ENC_Opus_Encode((uint8_t *)pcm_in, enc_buf);
+	time_us = k_cyc_to_us_floor32(k_cycle_get_32() - start);
+	res->enc_max_us = MAX(res->enc_max_us, time_us);
+	if (ret < 0) {
+		return ret;
+	}
+
+	encoded_size = ret;
+
+	start = k_cycle_get_32();
+	ret = DEC_Opus_Decode(enc_buf, encoded_size, (uint8_t *)pcm_out);
+	time_us = k_cyc_to_us_floor32(k_cycle_get_32() - start);
+	res->dec_max_us = MAX(res->dec_max_us, time_us);
+	if (ret < 0) {
+		return ret;
+	}
+
+	return encoded_size;
+}
+
+static void codec_bench_latency_thread(void *arg1, void *arg2, void *arg3)
+{
+	struct latency_case *lc = arg1;
+	struct latency_result *res = arg2;
+	uint32_t samples = CONFIG_AUDIO_SAMPLE_RATE_HZ / 1000 * lc->frame_us / 1000;
+	uint32_t frames = (LATENCY_SETTLE_US + LATENCY_MEASURE_US) / lc->frame_us;
+	uint32_t settle = CONFIG_AUDIO_SAMPLE_RATE_HZ / 1000 * LATENCY_SETTLE_US / 1000;
+	/* First sample of the first measured frame */
+	uint32_t measure_start = DIV_ROUND_UP(settle, samples) * samples;
+	int64_t best = INT64_MIN;
+	uint64_t out_energy = 0;
+	uint64_t in_energy = 0;
+	int64_t err_energy;
+	int ret;
+
+	ARG_UNUSED(arg3);
+
+	memset(latency_xcorr, 0, sizeof(latency_xcorr));
+
+	ret = latency_codec_init(lc);
+	if (ret) {
+		res->err = ret;
+		goto out;
+	}
+
+	for (uint32_t f = 0; f < frames; f++) {
+		uint32_t pos = f * samples;
+
+		for (uint32_t i = 0; i < samples; i++) {
+			pcm_in[i] = latency_noise(pos + i);
+		}
+
+		ret = latency_frame_code(res);
+		if (ret < 0) {
+			res->err = ret;
+			goto out;
+		}
+		res->enc_bytes_total += ret;
+
+		/* settle is longer than LATENCY_LAG_MAX, so pos + i - d never wraps */
+		for (uint32_t i = 0; (pos >= measure_start) && (i < samples); i++) {
+			out_energy += (int32_t)pcm_out[i] * pcm_out[i];
+			for (uint32_t d = 0; d <= LATENCY_LAG_MAX; d++) {
+				latency_xcorr[d] += (int32_t)pcm_out[i] * latency_noise(pos + i - d);
+			}
+		}
+	}
+
+	for (uint32_t d = 0; d <= LATENCY_LAG_MAX; d++) {
+		if (latency_xcorr[d] > best) {
+			best = latency_xcorr[d];
+			res->delay_samples = d;
+		}
+	}
+
+	/* Output minus the input delayed by the codec, the input is regenerated */
+	for (uint32_t n = measure_start; n < frames * samples; n++) {
+		int32_t x = latency_noise(n - res->delay_samples);
+
+		in_energy += x * x;
+	}
+	err_energy = (int64_t)out_energy - 2 * best + (int64_t)in_energy;
+	res->snr_tenth_db = (int32_t)(100.0 * log10((double)in_energy / MAX(err_energy, 1)));
+
+out:
+	latency_codec_uninit();
+}
+
+static int latency_case_run(const struct shell *shell, uint16_t frame_us,
+			    enum latency_codec codec)
+{
+	uint32_t delay_us;
+	uint32_t frames = (LATENCY_SETTLE_US + LATENCY_MEASURE_US) / frame_us;
+
+	memset(&latency_result, 0, sizeof(latency_result));
+	latency_case.frame_us = frame_us;
+	latency_case.codec = codec;
+
+	k_thread_create(&codec_bench_thread_data, codec_bench_stack,
+			K_THREAD_STACK_SIZEOF(codec_bench_stack), codec_bench_latency_thread,
+			&latency_case, &latency_result, NULL,
+			K_PRIO_PREEMPT(CONFIG_ENCODER_THREAD_PRIO), 0, K_NO_WAIT);
+	k_thread_join(&codec_bench_thread_data, K_FOREVER);
+
+	if (latency_result.err) {
+		shell_print(shell, "%s,%u,error %d", latency_codec_str[codec], frame_us,
+			    latency_result.err);
+		return 0;
+	}
+
+	delay_us = latency_result.delay_samples * USEC_PER_SEC / CONFIG_AUDIO_SAMPLE_RATE_HZ;
+
+	/* A frame is captured in full before encoding, then coded and decoded */
+	shell_print(shell, "%s,%u,%u,%u,%u,%u,%u,%u,%d.%d", latency_codec_str[codec], frame_us,
+		    latency_result.delay_samples, delay_us, latency_result.enc_max_us,
+		    latency_result.dec_max_us,
+		    frame_us + delay_us + latency_result.enc_max_us + latency_result.dec_max_us,
+		    (uint32_t)((uint64_t)latency_result.enc_bytes_total * 8 * USEC_PER_SEC /
+			       ((uint64_t)frames * frame_us)),
+		    latency_result.snr_tenth_db / 10, abs(latency_result.snr_tenth_db % 10));
+
+	return 0;
+}
+
+/**
+ * @brief Measure the codec delay and SNR of each low latency frame duration with standard
+ *	  Opus and Opus Custom, and estimate the delay from capture to decoded output.
+ */
+static int cmd_codec_bench_latency(const struct shell *shell, size_t argc, const char **argv)
+{
+	int ret;
+
+	if (sw_codec_is_initialized()) {
+		shell_error(shell, "Stop the audio system before running the benchmark");
+		return -EBUSY;
+	}
+
+	shell_print(shell, "codec,frame_us,delay_samples,delay_us,enc_max_us,dec_max_us,total_us,"
+			   "bitrate,snr_db");
+
+	for (int f = 0; f < ARRAY_SIZE(latency_frame_us); f++) {
+		ret = latency_case_run(shell, latency_frame_us[f], LATENCY_OPUS);
+		if (ret) {
+			return ret;
+		}
+	}
+
+	for (int f = 0;
+	     IS_ENABLED(CONFIG_OPUS_CUSTOM_MODE) && (f < ARRAY_SIZE(latency_custom_frame_us)); f++) {
+		ret = latency_case_run(shell, latency_custom_frame_us[f], LATENCY_OPUS_CUSTOM);
+		if (ret) {
+			return ret;
+		}
+	}
+
+	return 0;
+}
+
+#if (CONFIG_SAMPLE_RATE_CONVERTER)
+#define SRC_SAMPLES_MAX    (CONFIG_AUDIO_SAMPLE_RATE_HZ / 1000 * CONFIG_AUDIO_FRAME_DURATION_US / 1000)
+#define SRC_SETTLE_FRAMES  10
+#define SRC_TONE_AMPLITUDE 16384.0f
+
+/**
+ * @brief Run a 1 kHz tone down to the codec rate and back up, then fit a sine
+ *	  to the output by least squares. Everything that is not the fitted
+ *	  sine counts as distortion and noise.
+ */
+static int cmd_codec_bench_src(const struct shell *shell, size_t argc, const char **argv)
+{
+	int ret;
+	static struct sample_rate_converter_ctx down_ctx;
+	static struct sample_rate_converter_ctx up_ctx;
+	static int16_t src_in[SRC_SAMPLES_MAX];
+	static int16_t src_mid[SRC_SAMPLES_MAX];
+	static int16_t src_out[SRC_SAMPLES_MAX];
+	uint32_t rate;
+	uint32_t pos = 0;
+	uint32_t down_cyc_max = 0;
+	uint32_t up_cyc_max = 0;
+	uint64_t down_cyc_total = 0;
+	uint64_t up_cyc_total = 0;
+	/* Sums of the normal equations for x ~ a * sin + b * cos */
+	double sxx = 0, sss = 0, scc = 0, ssc = 0, sxs = 0, sxc = 0;
+	const float w = 2.0f * 3.14159265f * BENCH_TONE_FREQ_HZ / CONFIG_AUDIO_SAMPLE_RATE_HZ;
+
+	if (argc != 2) {
+		shell_error(shell, "Codec sample rate [Hz] must be provided");
+		return -EINVAL;
+	}
+
+	rate = strtoul(argv[1], NULL, 10);
+	if ((rate != 16000 && rate != 24000) || rate >= CONFIG_AUDIO_SAMPLE_RATE_HZ ||
+	    CONFIG_AUDIO_BIT_DEPTH_BITS != 16) {
+		shell_error(shell, "16 bit audio and a rate of 16000 or 24000 below %d Hz needed",
+			    CONFIG_AUDIO_SAMPLE_RATE_HZ);
+		return -EINVAL;
+	}
+
+	sample_rate_converter_open(&down_ctx);
+	sample_rate_converter_open(&up_ctx);
+
+	for (uint32_t f = 0; f < SRC_SETTLE_FRAMES + CONFIG_CODEC_BENCH_FRAMES; f++) {
+		size_t mid_size;
+		size_t out_size;
+		uint32_t start;
+		uint32_t cyc;
+
+		for (uint32_t i = 0; i < SRC_SAMPLES_MAX; i++) {
+			src_in[i] = (int16_t)(SRC_TONE_AMPLITUDE * sinf(w * (pos + i)));
+		}
+
+		start = k_cycle_get_32();
+		ret = sample_rate_converter_process(&down_ctx, SAMPLE_RATE_FILTER_SIMPLE, src_in,
+						    sizeof(src_in), CONFIG_AUDIO_SAMPLE_RATE_HZ,
+						    src_mid, sizeof(src_mid), &mid_size, rate);
+		cyc = k_cycle_get_32() - start;
+		if (ret) {
+			shell_error(shell, "Downsampling failed: %d", ret);
+			return ret;
+		}
+		down_cyc_max = MAX(down_cyc_max, cyc);
+		down_cyc_total += cyc;
+
+		start = k_cycle_get_32();
+		ret = sample_rate_converter_process(&up_ctx, SAMPLE_RATE_FILTER_SIMPLE, src_mid,
+						    mid_size, rate, src_out, sizeof(src_out),
+						    &out_size, CONFIG_AUDIO_SAMPLE_RATE_HZ);
+		cyc = k_cycle_get_32() - start;
+		if (ret) {
+			shell_error(shell, "Upsampling failed: %d", ret);
+			return ret;
+		}
+		up_cyc_max = MAX(up_cyc_max, cyc);
+		up_cyc_total += cyc;
+
+		/* Skip the filter start up, the delay itself is absorbed by the fit phase */
+		for (uint32_t i = 0; (f >= SRC_SETTLE_FRAMES) && (i < out_size / sizeof(int16_t));
+		     i++) {
+			double x = src_out[i];
+			double sn = sinf(w * (pos + i));
+			double cs = cosf(w * (pos + i));
+
+			sxx += x * x;
+			sss += sn * sn;
+			scc += cs * cs;
+			ssc += sn * cs;
+			sxs += x * sn;
+			sxc += x * cs;
+		}
+
+		pos += SRC_SAMPLES_MAX;
+	}
+
+	double det = sss * scc - ssc * ssc;
+	double a = (sxs * scc - sxc * ssc) / det;
+	double b = (sxc * sss - sxs * ssc) / det;
+	double fit = a * sxs + b * sxc;
+	int thdn_tenth_db = (int)(100.0 * log10((sxx - fit) / fit));
+	uint32_t frames = SRC_SETTLE_FRAMES + CONFIG_CODEC_BENCH_FRAMES;
+
+	shell_print(shell, "%d -> %d -> %d Hz: THD+N %d.%d dB", CONFIG_AUDIO_SAMPLE_RATE_HZ, rate,
+		    CONFIG_AUDIO_SAMPLE_RATE_HZ, thdn_tenth_db / 10, abs(thdn_tenth_db % 10));
+	shell_print(shell, "down: avg %d us, max %d us; up: avg %d us, max %d us per frame",
+		    k_cyc_to_us_floor32(down_cyc_total / frames), k_cyc_to_us_floor32(down_cyc_max),
+		    k_cyc_to_us_floor32(up_cyc_total / frames), k_cyc_to_us_floor32(up_cyc_max));
+
+	return 0;
+}
+#endif /* (CONFIG_SAMPLE_RATE_CONVERTER) */
+
+SHELL_STATIC_SUBCMD_SET_CREATE(codec_bench_cmd,
+			       SHELL_COND_CMD(CONFIG_SHELL, run, NULL,
+					      "Run all frame size, channel, bitrate and "
+					      "complexity combinations",
+					      cmd_codec_bench_run),
+			       SHELL_COND_CMD(CONFIG_SHELL, case, NULL,
+					      "Run one case: <frame_us> <ch> <bitrate> <complexity>",
+					      cmd_codec_bench_case),
+			       SHELL_COND_CMD(CONFIG_SHELL, multistream, NULL,
+					      "Stereo vs one decoded mono stream per channel",
+					      cmd_codec_bench_multistream),
+			       SHELL_COND_CMD(CONFIG_SHELL, latency, NULL,
+					      "Codec delay and SNR of Opus and Opus Custom",
+					      cmd_codec_bench_latency),
+			       SHELL_COND_CMD(CONFIG_SAMPLE_RATE_CONVERTER, src, NULL,
+					      "Sample rate converter THD+N and time: <rate>",
+					      cmd_codec_bench_src),
+			       SHELL_SUBCMD_SET_END);
+
+SHELL_CMD_REGISTER(codec_bench, &codec_bench_cmd, "Opus codec benchmark, CSV output", NULL);
@@ -12,6 +12,7 @@
 #include <data_fifo.h>
 
 #include "macros_common.h"
+#include "audio_i2s.h"
 
 #include <zephyr/logging/log.h>
 LOG_MODULE_REGISTER(audio_usb, CONFIG_MODULE_AUDIO_USB_LOG_LEVEL);
@@ -19,9 +20,17 @@ LOG_MODULE_REGISTER(audio_usb, CONFIG_MODULE_AUDIO_USB_LOG_LEVEL);
 #define USB_FRAME_SIZE_STEREO                                                                      \
 	(((CONFIG_AUDIO_SAMPLE_RATE_HZ * CONFIG_AUDIO_BIT_DEPTH_OCTETS) / 1000) * 2)
 
+/* USB delivers 1 ms at a time, so every FIFO block must hold exactly one USB frame */
+BUILD_ASSERT(!IS_ENABLED(CONFIG_AUDIO_GATEWAY) || (BLOCK_SIZE_BYTES == USB_FRAME_SIZE_STEREO),
+	     "USB audio source requires AUDIO_BLOCK_PERIOD_1_MS and a frame of whole ms");
+
 static struct data_fifo *fifo_tx;
 static struct data_fifo *fifo_rx;
 
+/* A FIFO RX block holds a whole frame, filled one USB frame at a time */
+static uint8_t *frame_in;
+static size_t frame_in_size;
+
 NET_BUF_POOL_FIXED_DEFINE(pool_out, CONFIG_FIFO_FRAME_SPLIT_NUM, USB_FRAME_SIZE_STEREO, 8,
 			  net_buf_destroy);
 
@@ -102,38 +111,52 @@ static void data_received(const struct device *dev, struct net_buf *buffer, size
 		return;
 	}
 
-	ret = data_fifo_pointer_first_vacant_get(fifo_rx, &data_in, K_NO_WAIT);
+	if (frame_in == NULL) {
+		ret = data_fifo_pointer_first_vacant_get(fifo_rx, &data_in, K_NO_WAIT);
 
-	/* RX FIFO can fill up due to retransmissions or disconnect */
-	if (ret == -ENOMEM) {
-		void *temp;
-		size_t temp_size;
+		/* RX FIFO can fill up due to retransmissions or disconnect */
+		if (ret == -ENOMEM) {
+			void *temp;
+			size_t temp_size;
 
-		rx_num_overruns++;
-		if ((rx_num_overruns % 100) == 1) {
-			LOG_DBG("USB RX overrun. Num: %d", rx_num_overruns);
-		}
+			rx_num_overruns++;
+			if ((rx_num_overruns % 100) == 1) {
+				LOG_DBG("USB RX overrun. Num: %d", rx_num_overruns);
+			}
 
-		ret = data_fifo_pointer_last_filled_get(fifo_rx, &temp, &temp_size, K_NO_WAIT);
-		ERR_CHK(ret);
+			ret = data_fifo_pointer_last_filled_get(fifo_rx, &temp, &temp_size,
+								K_NO_WAIT);
+			ERR_CHK(ret);
 
-		data_fifo_block_free(fifo_rx, temp);
+			data_fifo_block_free(fifo_rx, temp);
 
-		ret = data_fifo_pointer_first_vacant_get(fifo_rx, &data_in, K_NO_WAIT);
-		usb_data_continute_count = 0;
-	}
+			ret = data_fifo_pointer_first_vacant_get(fifo_rx, &data_in, K_NO_WAIT);
+			usb_data_continute_count = 0;
+		}
 
-	ERR_CHK_MSG(ret, "RX failed to get block");
+		ERR_CHK_MSG(ret, "RX failed to get block");
 
-	memcpy(data_in, buffer->data, size);
+		frame_in = data_in;
+		frame_in_size = 0;
+	}
+
+	memcpy(frame_in + frame_in_size, buffer->data, size);
+	frame_in_size += size;
 
 	// LOG_INF("usb audio data_in %zu bytes", (size_t)size);  // Use %zu for size_t values
 	// LOG_INF("usb audio data continute count %d", usb_data_continute_count);  // Use %zu for
 	// size_t values
 	usb_data_continute_count++;
 	// LOG_HEXDUMP_DBG(data_in, 8, "usb audio data_in(HEX):");
-	ret = data_fifo_block_lock(fifo_rx, &data_in, size);
-	ERR_CHK_MSG(ret, "Failed to lock block");
+
+	/* Hand over a complete frame, so the encoder reads it in place */
+	if (frame_in_size == FRAME_SIZE_BYTES) {
+		data_in = frame_in;
+		frame_in = NULL;
+
+		ret = data_fifo_block_lock(fifo_rx, &data_in, FRAME_SIZE_BYTES);
+		ERR_CHK_MSG(ret, "Failed to lock block");
+	}
 
 	net_buf_unref(buffer);
 
@@ -178,6 +201,13 @@ void audio_usb_stop(void)
 {
 	rx_first_data = false;
 	tx_first_data = false;
+
+	if (frame_in != NULL) {
+		/* Drop the partly filled frame */
+		data_fifo_block_free(fifo_rx, frame_in);
+		frame_in = NULL;
+	}
+
 	fifo_tx = NULL;
 	fifo_rx = NULL;
 }
@@ -0,0 +1,227 @@
+/*
+ * Copyright (c) 2025 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+/** @file
+ * @brief Software ASRC tests
+ *
+ * Resamples a 1 kHz tone by fixed ratios and checks the number of samples
+ * produced and the THD+N against a sine fitted at the shifted frequency,
+ * then runs the ASRC in the clock recovery loop against a FIFO filled at a
+ * drifted rate, as on the headset, and checks that the loop locks.
+ */
+
+#include <math.h>
+#include <zephyr/ztest.h>
+
+#include "asrc.h"
+#include "clock_recovery.h"
+
+#define ASRC_SAMPLES                                                                               \
+	(CONFIG_AUDIO_SAMPLE_RATE_HZ / 1000 * CONFIG_AUDIO_FRAME_DURATION_US / 1000)
+/* Room for the most samples a frame can turn into */
+#define ASRC_OUT_SAMPLES    (ASRC_SAMPLES + ASRC_SAMPLES / 64 + 2)
+#define ASRC_SETTLE_FRAMES  10
+#define ASRC_FRAMES	    100
+#define ASRC_TONE_HZ	    1000
+#define ASRC_TONE_AMPLITUDE (16384.0 * (1 << (CONFIG_AUDIO_BIT_DEPTH_BITS - 16)))
+/* Output samples may differ from the exact ratio by the position carried between frames */
+#define ASRC_RATIO_TOL	    2
+/* Bounds a little above the THD+N measured at +/-200 and +/-1000 ppm, -90.2 dB with 16
+ * bit and -113.5 dB with 32 bit samples
+ */
+#if (CONFIG_AUDIO_BIT_DEPTH_32)
+#define ASRC_THDN_MAX_DB -110.0
+#else
+#define ASRC_THDN_MAX_DB -88.0
+#endif
+/* The FIFO is drained and its fill level sampled once per tick, as per I2S block */
+#define ASRC_TICK_US	    1000
+#define ASRC_TICK_SAMPLES   (CONFIG_AUDIO_SAMPLE_RATE_HZ / 1000 * ASRC_TICK_US / 1000)
+#define ASRC_WINDOW_TICKS   (CLOCK_RECOVERY_WINDOW_US / ASRC_TICK_US)
+#define ASRC_TRACK_WINDOWS  1200
+#define ASRC_TRACK_FILL_US  20000
+/* Drift estimate accepted as tracked */
+#define ASRC_TRACK_TOL_MPPM 10000
+/* Bound with margin on the 33 s measured for +/-200 ppm */
+#define ASRC_TRACK_SETTLE_S 45
+
+static const int16_t asrc_ppm[] = {0, 200, -200, 1000, -1000};
+
+static asrc_sample_t asrc_in[ASRC_SAMPLES * ASRC_CH_NUM];
+static asrc_sample_t asrc_out[ASRC_OUT_SAMPLES * ASRC_CH_NUM];
+
+/**
+ * @brief Resample a 1 kHz tone by a fixed ratio and fit a sine at the shifted
+ *	  frequency to the output by least squares.
+ *
+ * @param out_total Set to the number of output samples per channel.
+ *
+ * @return THD+N in dB, everything that is not the fitted sine.
+ */
+static double asrc_tone_run(int32_t ppm, uint32_t *out_total)
+{
+	struct asrc asrc;
+	uint32_t pos = 0;
+	uint32_t out_pos = 0;
+	/* Sums of the normal equations for x ~ a * sin + b * cos */
+	double sxx = 0, sss = 0, scc = 0, ssc = 0, sxs = 0, sxc = 0;
+	double det, a, c, fit;
+	const double w = 2.0 * M_PI * ASRC_TONE_HZ / CONFIG_AUDIO_SAMPLE_RATE_HZ;
+	/* Each output sample steps 1 + ppm input samples */
+	const double w_out = w * (1.0 + ppm * 1e-6);
+
+	asrc_init(&asrc);
+	asrc_ratio_set(&asrc, ppm * 1000);
+
+	for (uint32_t f = 0; f < ASRC_SETTLE_FRAMES + ASRC_FRAMES; f++) {
+		size_t out_frames;
+
+		for (uint32_t i = 0; i < ASRC_SAMPLES; i++) {
+			asrc_sample_t x = (asrc_sample_t)lround(ASRC_TONE_AMPLITUDE *
+								sin(w * (pos + i)));
+
+			asrc_in[i * ASRC_CH_NUM] = x;
+			asrc_in[i * ASRC_CH_NUM + 1] = x;
+		}
+
+		out_frames = asrc_process(&asrc, asrc_in, ASRC_SAMPLES, false, asrc_out,
+					  ASRC_OUT_SAMPLES);
+		zassert_true(out_frames < ASRC_OUT_SAMPLES, "%+d ppm: output buffer full", ppm);
+
+		/* The interpolator delay is absorbed by the fit phase */
+		for (uint32_t i = 0; (f >= ASRC_SETTLE_FRAMES) && (i < out_frames); i++) {
+			double x = asrc_out[i * ASRC_CH_NUM];
+			double sn = sin(w_out * (out_pos + i));
+			double cs = cos(w_out * (out_pos + i));
+
+			zassert_equal(asrc_out[i * ASRC_CH_NUM + 1], asrc_out[i * ASRC_CH_NUM],
+				      "%+d ppm: channels differ", ppm);
+
+			sxx += x * x;
+			sss += sn * sn;
+			scc += cs * cs;
+			ssc += sn * cs;
+			sxs += x * sn;
+			sxc += x * cs;
+		}
+
+		pos += ASRC_SAMPLES;
+		out_pos += out_frames;
+	}
+
+	*out_total = out_pos;
+
+	det = sss * scc - ssc * ssc;
+	a = (sxs * scc - sxc * ssc) / det;
+	c = (sxc * sss - sxs * ssc) / det;
+	fit = a * sxs + c * sxc;
+
+	return 10.0 * log10((sxx - fit) / fit);
+}
+
+ZTEST(asrc, test_ratio)
+{
+	for (int p = 0; p < ARRAY_SIZE(asrc_ppm); p++) {
+		uint32_t in_total = (ASRC_SETTLE_FRAMES + ASRC_FRAMES) * ASRC_SAMPLES;
+		uint32_t out_total;
+		int32_t expected;
+
+		(void)asrc_tone_run(asrc_ppm[p], &out_total);
+
+		expected = (int32_t)lround(in_total / (1.0 + asrc_ppm[p] * 1e-6));
+
+		TC_PRINT("%+d ppm: %d samples in, %d out, %d expected\n", asrc_ppm[p], in_total,
+			 out_total, expected);
+		zassert_within((int32_t)out_total, expected, ASRC_RATIO_TOL,
+			       "%+d ppm: %d samples out, expected %d", asrc_ppm[p], out_total,
+			       expected);
+	}
+}
+
+ZTEST(asrc, test_thdn)
+{
+	for (int p = 0; p < ARRAY_SIZE(asrc_ppm); p++) {
+		uint32_t out_total;
+		double thdn = asrc_tone_run(asrc_ppm[p], &out_total);
+
+		TC_PRINT("%+d ppm: THD+N %.1f dB\n", asrc_ppm[p], thdn);
+		zassert_true(thdn <= ASRC_THDN_MAX_DB, "%+d ppm: THD+N %.1f dB", asrc_ppm[p],
+			     thdn);
+	}
+}
+
+/**
+ * @brief Run the clock recovery loop with the ASRC against a FIFO filled with
+ *	  frames at a drifted rate and drained at the nominal one.
+ */
+static void asrc_track_check(int32_t drift_ppm)
+{
+	struct asrc asrc;
+	struct clock_recovery loop;
+	/* Frames arrive every frame duration of the sender clock, in local ns */
+	const int64_t frame_ns = (int64_t)CONFIG_AUDIO_FRAME_DURATION_US * NSEC_PER_USEC *
+				 1000000000 / (1000000000 + drift_ppm * 1000);
+	int64_t now_ns = 0;
+	int64_t next_frame_ns = 0;
+	int32_t fill = CONFIG_AUDIO_SAMPLE_RATE_HZ / 1000 * ASRC_TRACK_FILL_US / 1000;
+	int64_t fill_sum = 0;
+	/* First window after which the drift estimate stayed within tolerance */
+	uint32_t settle_window = 0;
+	uint32_t settle_s;
+
+	asrc_init(&asrc);
+	clock_recovery_init(&loop);
+	memset(asrc_in, 0, sizeof(asrc_in));
+
+	for (uint32_t t = 1; t <= ASRC_TRACK_WINDOWS * ASRC_WINDOW_TICKS; t++) {
+		int32_t est_err_mppm;
+
+		now_ns += ASRC_TICK_US * NSEC_PER_USEC;
+
+		while (next_frame_ns <= now_ns) {
+			next_frame_ns += frame_ns;
+			fill += asrc_process(&asrc, asrc_in, ASRC_SAMPLES, false, asrc_out,
+					     ASRC_OUT_SAMPLES);
+		}
+
+		fill -= ASRC_TICK_SAMPLES;
+		fill_sum += fill;
+
+		if (t % ASRC_WINDOW_TICKS) {
+			continue;
+		}
+
+		asrc_ratio_set(&asrc,
+			       clock_recovery_update(&loop, fill_sum * USEC_PER_SEC /
+							    (ASRC_WINDOW_TICKS *
+							     CONFIG_AUDIO_SAMPLE_RATE_HZ)));
+		fill_sum = 0;
+
+		est_err_mppm = clock_recovery_drift_mppm(&loop) - drift_ppm * 1000;
+		if (est_err_mppm > ASRC_TRACK_TOL_MPPM || est_err_mppm < -ASRC_TRACK_TOL_MPPM) {
+			settle_window = t / ASRC_WINDOW_TICKS;
+		}
+	}
+
+	settle_s = settle_window * CLOCK_RECOVERY_WINDOW_US / USEC_PER_SEC;
+
+	TC_PRINT("%+d ppm drift: settled after %d s, estimate %d mppm, fill error %d us\n",
+		 drift_ppm, settle_s, clock_recovery_drift_mppm(&loop),
+		 clock_recovery_err_us(&loop));
+
+	zassert_equal(loop.state, CLOCK_RECOVERY_STATE_LOCKED, "%+d ppm: not locked, state %d",
+		      drift_ppm, loop.state);
+	zassert_true(settle_s <= ASRC_TRACK_SETTLE_S, "%+d ppm: settled after %d s", drift_ppm,
+		     settle_s);
+}
+
+ZTEST(asrc, test_track)
+{
+	asrc_track_check(200);
+	asrc_track_check(-200);
+}
+
+ZTEST_SUITE(asrc, NULL, NULL, NULL, NULL, NULL);
@@ -0,0 +1,321 @@
+/*
+ * Copyright (c) 2025 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+/** @file
+ * @brief Out FIFO block ring tests
+ *
+ * Every block written carries the next number of a sequence, so a block
+ * consumed before its data, twice or not at all breaks the sequence. The
+ * ring is driven from one thread in a pseudo random order against a model
+ * of the queue, then with the consumer in a timer ISR as on the headset
+ * and, on SMP targets, in a thread on another CPU.
+ */
+
+#include <zephyr/ztest.h>
+
+#include "blk_ring.h"
+
+/* Small and not a power of two so the indices wrap often */
+#define RING_BLKS      7
+#define RING_STEPS     100000
+#define RING_CONS_US   100
+#define RING_STRESS_MS 1000
+
+static struct blk_ring ring;
+static uint32_t ring_seq[RING_BLKS];
+
+static struct {
+	uint32_t expect;
+	uint32_t consumed;
+	uint32_t empty;
+	uint32_t seq_errs;
+	uint32_t fill_errs;
+} cons;
+
+static void ring_produce(uint32_t *seq, uint32_t num)
+{
+	for (uint32_t i = 0; i < num; i++) {
+		ring_seq[blk_ring_prod_idx(&ring, i)] = (*seq)++;
+	}
+
+	blk_ring_produce(&ring, num);
+}
+
+static void ring_before(void *fixture)
+{
+	ARG_UNUSED(fixture);
+
+	memset(&cons, 0, sizeof(cons));
+	memset(ring_seq, 0, sizeof(ring_seq));
+	blk_ring_init(&ring, RING_BLKS);
+}
+
+ZTEST(blk_ring, test_empty_full)
+{
+	uint32_t seq = 0;
+	uint32_t idx;
+
+	zassert_equal(blk_ring_fill(&ring), 1, "Fill %d when empty", blk_ring_fill(&ring));
+	zassert_equal(blk_ring_space(&ring), RING_BLKS - 2, "Space %d when empty",
+		      blk_ring_space(&ring));
+	zassert_false(blk_ring_consume(&ring, &idx), "Consumed from an empty ring");
+
+	/* The consumer's block and the one before it are never written */
+	ring_produce(&seq, RING_BLKS - 2);
+	zassert_equal(blk_ring_fill(&ring), RING_BLKS - 1, "Fill %d when full",
+		      blk_ring_fill(&ring));
+	zassert_equal(blk_ring_space(&ring), 0, "Space %d when full", blk_ring_space(&ring));
+
+	for (uint32_t i = 0; i < RING_BLKS - 2; i++) {
+		zassert_true(blk_ring_consume(&ring, &idx), "Block %d not consumed", i);
+		zassert_equal(ring_seq[idx], i, "Block %d consumed as %d", i, ring_seq[idx]);
+		zassert_equal(blk_ring_cons_idx(&ring), idx, "Consumer index %d, consumed %d",
+			      blk_ring_cons_idx(&ring), idx);
+	}
+
+	zassert_false(blk_ring_consume(&ring, &idx), "Consumed past the producer");
+	zassert_equal(blk_ring_fill(&ring), 1, "Fill %d when drained", blk_ring_fill(&ring));
+}
+
+ZTEST(blk_ring, test_unproduce)
+{
+	uint32_t seq = 0;
+	uint32_t idx;
+
+	ring_produce(&seq, 4);
+
+	/* Two blocks stay queued, so only two of the three asked for come back */
+	zassert_equal(blk_ring_unproduce(&ring, 3, 2), 2, "Wrong number taken back");
+	zassert_equal(blk_ring_fill(&ring), 3, "Fill %d", blk_ring_fill(&ring));
+	zassert_equal(blk_ring_unproduce(&ring, 1, 2), 0, "Took back a kept block");
+
+	/* Taken back blocks are written again with the next numbers */
+	seq -= 2;
+	ring_produce(&seq, 2);
+
+	for (uint32_t i = 0; i < 4; i++) {
+		zassert_true(blk_ring_consume(&ring, &idx), "Block %d not consumed", i);
+		zassert_equal(ring_seq[idx], i, "Block %d consumed as %d", i, ring_seq[idx]);
+	}
+
+	zassert_equal(blk_ring_unproduce(&ring, 1, 0), 0, "Took back the consumer's block");
+}
+
+ZTEST(blk_ring, test_sequence)
+{
+	uint32_t lfsr = 0xACE1u;
+	uint32_t seq = 0;
+	/* Blocks queued after the consumer's, by the model */
+	uint32_t queued = 0;
+	uint32_t idx;
+
+	for (uint32_t s = 0; s < RING_STEPS; s++) {
+		uint32_t num;
+
+		lfsr = lfsr * 1103515245u + 12345u;
+		num = 1 + (lfsr >> 28) % 3;
+
+		switch ((lfsr >> 16) % 8) {
+		case 0:
+			num = blk_ring_unproduce(&ring, num, (lfsr >> 24) % 3);
+			seq -= num;
+			queued -= num;
+			break;
+		case 1:
+		case 2:
+		case 3:
+			if (num > blk_ring_space(&ring)) {
+				zassert_true(queued + num > RING_BLKS - 2,
+					     "Step %d: space %d of %d", s, blk_ring_space(&ring),
+					     RING_BLKS - 2 - queued);
+				break;
+			}
+
+			ring_produce(&seq, num);
+			queued += num;
+			break;
+		default:
+			if (!blk_ring_consume(&ring, &idx)) {
+				zassert_equal(queued, 0, "Step %d: empty with %d queued", s,
+					      queued);
+				cons.empty++;
+				break;
+			}
+
+			zassert_true(queued > 0, "Step %d: consumed from an empty ring", s);
+			zassert_equal(ring_seq[idx], cons.expect, "Step %d: block %d, expected %d",
+				      s, ring_seq[idx], cons.expect);
+			cons.expect++;
+			cons.consumed++;
+			queued--;
+			break;
+		}
+
+		zassert_equal(blk_ring_fill(&ring), queued + 1, "Step %d: fill %d, %d queued", s,
+			      blk_ring_fill(&ring), queued);
+	}
+
+	TC_PRINT("Consumed %d, found empty %d\n", cons.consumed, cons.empty);
+	zassert_true(cons.consumed > 0 && cons.empty > 0, "Not every case was reached");
+}
+
+/**
+ * @brief Consumer in the system timer ISR, as the I2S ISR on the headset.
+ * @note  On SMP the ISR can run on another CPU than the producer. irq_lock() is then
+ *	  a lock across CPUs, taken here so blk_ring_unproduce() still keeps the
+ *	  consumer out, as on the single core headset where it locks out the ISR.
+ */
+static void ring_consume(struct k_timer *timer)
+{
+	uint32_t idx;
+	uint32_t fill = blk_ring_fill(&ring);
+	unsigned int key;
+
+	if (fill < 1 || fill >= RING_BLKS) {
+		cons.fill_errs++;
+	}
+
+	key = irq_lock();
+	if (!blk_ring_consume(&ring, &idx)) {
+		irq_unlock(key);
+		cons.empty++;
+		return;
+	}
+	irq_unlock(key);
+
+	if (ring_seq[idx] != cons.expect) {
+		cons.seq_errs++;
+		cons.expect = ring_seq[idx];
+	}
+
+	cons.expect++;
+	cons.consumed++;
+}
+
+K_TIMER_DEFINE(ring_timer, ring_consume, NULL);
+
+struct ring_stress {
+	uint32_t produced;
+	uint32_t unproduced;
+	uint32_t fill_errs;
+};
+
+/**
+ * @brief Produce batches of 1 to 3 blocks and take some back, like the datapath thread,
+ *	  for RING_STRESS_MS while a consumer runs.
+ */
+static void ring_stress_produce(struct ring_stress *st)
+{
+	uint32_t lfsr = 0xACE1u;
+	uint32_t seq = 0;
+	int64_t end_ms = k_uptime_get() + RING_STRESS_MS;
+
+	memset(st, 0, sizeof(*st));
+
+	while (k_uptime_get() < end_ms) {
+		uint32_t num;
+		uint32_t fill = blk_ring_fill(&ring);
+
+		if (fill < 1 || fill >= RING_BLKS) {
+			st->fill_errs++;
+		}
+
+		lfsr = lfsr * 1103515245u + 12345u;
+
+		if (((lfsr >> 16) % 64) == 0) {
+			num = blk_ring_unproduce(&ring, 1 + (lfsr >> 28) % 4, 1);
+			seq -= num;
+			st->unproduced += num;
+			continue;
+		}
+
+		num = 1 + (lfsr >> 28) % 3;
+		if (num > blk_ring_space(&ring)) {
+			k_busy_wait((lfsr >> 22) % RING_CONS_US);
+			continue;
+		}
+
+		ring_produce(&seq, num);
+		st->produced += num;
+	}
+}
+
+/* Checks once the consumer has stopped */
+static void ring_stress_check(const struct ring_stress *st)
+{
+	TC_PRINT("Produced %d, taken back %d, consumed %d, consumer found empty %d\n",
+		 st->produced, st->unproduced, cons.consumed, cons.empty);
+
+	zassert_equal(cons.seq_errs, 0, "%d sequence errors", cons.seq_errs);
+	zassert_equal(cons.fill_errs + st->fill_errs, 0, "%d fill level errors",
+		      cons.fill_errs + st->fill_errs);
+	zassert_true(cons.consumed > 0 && st->unproduced > 0, "Not every case was reached");
+	zassert_equal(st->produced - st->unproduced, cons.consumed + blk_ring_fill(&ring) - 1,
+		      "Produced %d, taken back %d, consumed %d, %d left", st->produced,
+		      st->unproduced, cons.consumed, blk_ring_fill(&ring) - 1);
+}
+
+/* On native_sim the timer ISR only runs while the producer waits or is idle, a
+ * preemptive target such as qemu_cortex_m3 interrupts it at any instruction
+ */
+ZTEST(blk_ring, test_isr_consumer)
+{
+	struct ring_stress st;
+
+	k_timer_start(&ring_timer, K_USEC(RING_CONS_US), K_USEC(RING_CONS_US));
+	ring_stress_produce(&st);
+	k_timer_stop(&ring_timer);
+
+	ring_stress_check(&st);
+}
+
+#if (CONFIG_SMP)
+#define RING_CONS_CPU	     1
+#define RING_CONS_STACK_SIZE 1024
+
+K_THREAD_STACK_DEFINE(ring_cons_stack, RING_CONS_STACK_SIZE);
+static struct k_thread ring_cons_thread;
+static atomic_t ring_cons_stop;
+
+/**
+ * @brief Consumer on another CPU, at random intervals. Produce, consume and the fill
+ *	  level run in parallel, only taking blocks back is locked out.
+ */
+static void ring_cons_loop(void *arg1, void *arg2, void *arg3)
+{
+	uint32_t lfsr = 0x1234u;
+
+	ARG_UNUSED(arg1);
+	ARG_UNUSED(arg2);
+	ARG_UNUSED(arg3);
+
+	while (!atomic_get(&ring_cons_stop)) {
+		ring_consume(NULL);
+
+		lfsr = lfsr * 1103515245u + 12345u;
+		k_busy_wait((lfsr >> 22) % RING_CONS_US);
+	}
+}
+
+ZTEST(blk_ring, test_smp_consumer)
+{
+	struct ring_stress st;
+
+	atomic_set(&ring_cons_stop, 0);
+	k_thread_create(&ring_cons_thread, ring_cons_stack, K_THREAD_STACK_SIZEOF(ring_cons_stack),
+			ring_cons_loop, NULL, NULL, NULL, K_PRIO_PREEMPT(0), 0, K_FOREVER);
+	zassert_ok(k_thread_cpu_pin(&ring_cons_thread, RING_CONS_CPU), "CPU pin failed");
+	k_thread_start(&ring_cons_thread);
+
+	ring_stress_produce(&st);
+	atomic_set(&ring_cons_stop, 1);
+	k_thread_join(&ring_cons_thread, K_FOREVER);
+
+	ring_stress_check(&st);
+}
+#endif /* (CONFIG_SMP) */
+
+ZTEST_SUITE(blk_ring, NULL, NULL, ring_before, NULL, NULL);
@@ -0,0 +1,135 @@
+/*
+ * Copyright (c) 2025 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+/** @file
+ * @brief Clock recovery loop tests
+ *
+ * Runs the loop against a modelled out FIFO that gains the drift minus the
+ * correction every window, with pseudo random jitter on the fill level the
+ * loop sees, and checks that it locks on the drift in time.
+ */
+
+#include <zephyr/ztest.h>
+
+#include "clock_recovery.h"
+
+#define CLK_REC_WINDOWS	  1200
+#define CLK_REC_JITTER_US 500
+#define CLK_REC_FILL_US	  20000
+/* Drift estimate accepted as converged */
+#define CLK_REC_TOL_MPPM  10000
+/* Bounds with margin on the settle times of this model: 20 s for +200 ppm, 37 s for
+ * -200 ppm and 44 s for +/-1000 ppm
+ */
+#define CLK_REC_SETTLE_200_PPM_S  45
+#define CLK_REC_SETTLE_1000_PPM_S 55
+
+struct clk_rec_result {
+	enum clock_recovery_state state;
+	/* First window after which the drift estimate stayed within tolerance */
+	uint32_t settle_window;
+	int32_t drift_mppm;
+	int32_t err_us;
+};
+
+static struct clk_rec_result clk_rec_run(int32_t drift_ppm, int32_t jitter_us_max)
+{
+	struct clock_recovery loop;
+	struct clk_rec_result res = {0};
+	int64_t fill_ns = (int64_t)CLK_REC_FILL_US * NSEC_PER_USEC;
+	int32_t corr_mppm = 0;
+	uint32_t lfsr = 0xACE1u;
+
+	clock_recovery_init(&loop);
+
+	for (uint32_t w = 0; w < CLK_REC_WINDOWS; w++) {
+		int32_t jitter_us;
+		int32_t est_err_mppm;
+
+		fill_ns += ((int64_t)drift_ppm * 1000 - corr_mppm) * CLOCK_RECOVERY_WINDOW_US /
+			   USEC_PER_SEC;
+
+		lfsr = lfsr * 1103515245u + 12345u;
+		jitter_us = (int32_t)((lfsr >> 16) % (2 * jitter_us_max + 1)) - jitter_us_max;
+
+		corr_mppm = clock_recovery_update(&loop, fill_ns / NSEC_PER_USEC + jitter_us);
+
+		est_err_mppm = clock_recovery_drift_mppm(&loop) - drift_ppm * 1000;
+		if (est_err_mppm > CLK_REC_TOL_MPPM || est_err_mppm < -CLK_REC_TOL_MPPM) {
+			res.settle_window = w + 1;
+		}
+	}
+
+	res.state = loop.state;
+	res.drift_mppm = clock_recovery_drift_mppm(&loop);
+	res.err_us = clock_recovery_err_us(&loop);
+
+	return res;
+}
+
+static void clk_rec_check(int32_t drift_ppm, uint32_t settle_s_max)
+{
+	struct clk_rec_result res = clk_rec_run(drift_ppm, CLK_REC_JITTER_US);
+	uint32_t settle_s = res.settle_window * CLOCK_RECOVERY_WINDOW_US / USEC_PER_SEC;
+
+	TC_PRINT("%+d ppm: settled after %d s, drift %d mppm, fill error %d us\n", drift_ppm,
+		 settle_s, res.drift_mppm, res.err_us);
+
+	zassert_equal(res.state, CLOCK_RECOVERY_STATE_LOCKED, "%+d ppm: not locked, state %d",
+		      drift_ppm, res.state);
+	zassert_true(settle_s <= settle_s_max, "%+d ppm: settled after %d s, expected %d s",
+		     drift_ppm, settle_s, settle_s_max);
+	zassert_within(res.drift_mppm, drift_ppm * 1000, CLK_REC_TOL_MPPM,
+		       "%+d ppm: drift estimate %d mppm", drift_ppm, res.drift_mppm);
+}
+
+ZTEST(clock_recovery, test_no_drift)
+{
+	clk_rec_check(0, 0);
+}
+
+ZTEST(clock_recovery, test_drift_200_ppm)
+{
+	clk_rec_check(200, CLK_REC_SETTLE_200_PPM_S);
+	clk_rec_check(-200, CLK_REC_SETTLE_200_PPM_S);
+}
+
+ZTEST(clock_recovery, test_drift_1000_ppm)
+{
+	clk_rec_check(1000, CLK_REC_SETTLE_1000_PPM_S);
+	clk_rec_check(-1000, CLK_REC_SETTLE_1000_PPM_S);
+}
+
+ZTEST(clock_recovery, test_restart)
+{
+	struct clock_recovery loop;
+	int32_t drift_mppm;
+
+	clock_recovery_init(&loop);
+
+	/* Lock on a steady fill level, with the loop holding it */
+	for (uint32_t w = 0; w < CLK_REC_WINDOWS / 4; w++) {
+		(void)clock_recovery_update(&loop, CLK_REC_FILL_US);
+	}
+	zassert_equal(loop.state, CLOCK_RECOVERY_STATE_LOCKED, "Not locked, state %d",
+		      loop.state);
+
+	/* A jump of the fill level after an under-run takes a new target, not a new drift */
+	drift_mppm = clock_recovery_drift_mppm(&loop);
+	clock_recovery_restart(&loop);
+	for (uint32_t w = 0; w < CLK_REC_WINDOWS / 4; w++) {
+		(void)clock_recovery_update(&loop, CLK_REC_FILL_US / 2);
+	}
+
+	zassert_equal(loop.state, CLOCK_RECOVERY_STATE_LOCKED, "Not locked after restart");
+	zassert_equal(clock_recovery_drift_mppm(&loop), drift_mppm,
+		      "Drift estimate moved from %d to %d mppm", drift_mppm,
+		      clock_recovery_drift_mppm(&loop));
+	zassert_equal(clock_recovery_err_us(&loop), 0, "Fill error %d us after restart",
+		      clock_recovery_err_us(&loop));
+}
+
+ZTEST_SUITE(clock_recovery, NULL, NULL, NULL, NULL, NULL);
@@ -0,0 +1,52 @@
+/*
+ * Copyright (c) 2025 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+/** @file
+ * @brief Codec benchmark baseline
+ *
+ * Median encode and decode time of each case in per mille of the reference
+ * case, coded in the same run. The ratios hold on any host, so a case that
+ * gets more than BASELINE_TOLERANCE_PERCENT slower relative to the reference
+ * fails the test. Cases without an entry are printed but not checked.
+ *
+ * To record, run the codec_bench.opus scenario on a quiet host and copy the
+ * "rel" rows of the output into the table.
+ */
+
+#ifndef _BASELINE_H_
+#define _BASELINE_H_
+
+#include <stdint.h>
+
+/* Reference case, the default frame duration, channel count and complexity of the app */
+#define BASELINE_REF_FRAME_US	   10000
+#define BASELINE_REF_CH		   2
+#define BASELINE_REF_BITRATE	   128000
+#define BASELINE_REF_COMPLEXITY	   0
+#define BASELINE_TOLERANCE_PERCENT 25
+
+enum bench_vector {
+	/* 1 kHz tone plus low level white noise, as on target */
+	VEC_TONE,
+	/* Full band white noise, the most bits per frame */
+	VEC_NOISE,
+	VEC_NUM,
+};
+
+struct baseline_entry {
+	uint8_t vector;
+	uint16_t frame_us;
+	uint8_t ch;
+	uint32_t bitrate;
+	uint8_t complexity;
+	uint32_t enc_permille;
+	uint32_t dec_permille;
+};
+
+/* Not recorded yet, Opus could not be built where this table was added */
+static const struct baseline_entry baseline[] = {};
+
+#endif /* _BASELINE_H_ */
@@ -0,0 +1,293 @@
+/*
+ * Copyright (c) 2025 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+/** @file
+ * @brief Opus codec benchmark on the host
+ *
+ * Codes fixed test vectors with every frame duration, channel count, bitrate
+ * and complexity the codec_bench shell command covers and prints one CSV row
+ * per case. Times are host CPU time, so only their ratio to the reference
+ * case is compared with the baseline. Stack use and the real-time budget are
+ * only meaningful on target, see codec_bench in src/debug.
+ */
+
+#include <stdlib.h>
+#include <math.h>
+#include <time.h>
+#include <zephyr/ztest.h>
+
+#include "opus_interface.h"
+#include "sw_codec_opus.h"
+#include "sw_codec_select.h"
+#include "baseline.h"
+
+#define BENCH_FRAMES	     200
+#define BENCH_FRAME_US_MAX   20000
+#define BENCH_CH_MAX	     2
+#define BENCH_BITRATE_MAX    320000
+#define BENCH_SAMPLES_MAX    (CONFIG_AUDIO_SAMPLE_RATE_HZ / 1000 * BENCH_FRAME_US_MAX / 1000)
+#define BENCH_ENC_BUF_SIZE                                                                         \
+	MAX(BENCH_BITRATE_MAX / 8 * (BENCH_FRAME_US_MAX / 1000) / 1000 * 2, 1275 * BENCH_CH_MAX)
+#define BENCH_TONE_FREQ_HZ   1000
+#define BENCH_TONE_AMPLITUDE 16384.0
+
+/* Same sweep as the codec_bench shell command */
+static const uint16_t bench_frame_us[] = {2500, 5000, 10000, 20000};
+static const uint8_t bench_ch[] = {1, 2};
+static const uint32_t bench_bitrate[] = {64000, 128000, 192000, 256000, 320000};
+static const uint8_t bench_complexity[] = {0, 5, 10};
+
+static const char *const vector_str[] = {"tone", "noise"};
+
+struct bench_case {
+	enum bench_vector vector;
+	uint16_t frame_us;
+	uint8_t ch;
+	uint32_t bitrate;
+	uint8_t complexity;
+};
+
+struct bench_result {
+	uint32_t enc_p50_ns;
+	uint32_t enc_p99_ns;
+	uint32_t dec_p50_ns;
+	uint32_t dec_p99_ns;
+	uint32_t enc_bytes_total;
+};
+
+static int16_t pcm_in[BENCH_SAMPLES_MAX * BENCH_CH_MAX];
+static int16_t pcm_out[BENCH_SAMPLES_MAX * BENCH_CH_MAX];
+static uint8_t enc_buf[BENCH_ENC_BUF_SIZE];
+static uint32_t enc_ns[BENCH_FRAMES];
+static uint32_t dec_ns[BENCH_FRAMES];
+
+static int u32_cmp(const void *a, const void *b)
+{
+	uint32_t x = *(const uint32_t *)a;
+	uint32_t y = *(const uint32_t *)b;
+
+	return (x > y) - (x < y);
+}
+
+static uint32_t percentile(uint32_t *sorted, uint32_t num, uint32_t pct)
+{
+	return sorted[((num - 1) * pct) / 100];
+}
+
+/* CPU time of the calling thread, each native_sim thread is a host thread */
+static uint64_t cpu_time_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+
+	return (uint64_t)ts.tv_sec * NSEC_PER_SEC + ts.tv_nsec;
+}
+
+/* White noise sample at an absolute position, the same on every run */
+static int16_t noise_sample(uint32_t n)
+{
+	n ^= n >> 16;
+	n *= 0x7feb352d;
+	n ^= n >> 15;
+	n *= 0x846ca68b;
+	n ^= n >> 16;
+
+	return (int16_t)n;
+}
+
+/**
+ * @brief Fill one frame of a vector from absolute sample position pos, right channel
+ *	  phase shifted for the tone and decorrelated for the noise.
+ */
+static void vector_fill(enum bench_vector vec, uint32_t pos, uint32_t samples, uint8_t ch)
+{
+	const double w = 2.0 * M_PI * BENCH_TONE_FREQ_HZ / CONFIG_AUDIO_SAMPLE_RATE_HZ;
+
+	for (uint32_t i = 0; i < samples; i++) {
+		for (uint8_t c = 0; c < ch; c++) {
+			uint32_t n = pos + i;
+			int16_t *out = &pcm_in[i * ch + c];
+
+			if (vec == VEC_TONE) {
+				*out = (int16_t)(BENCH_TONE_AMPLITUDE * sin(w * n + c * M_PI / 2)) +
+				       (noise_sample(n * 2 + c) >> 12);
+			} else {
+				*out = noise_sample(n * 2 + c) >> 1;
+			}
+		}
+	}
+}
+
+static void bench_case_run(const struct bench_case *bc, struct bench_result *res)
+{
+	uint32_t samples = CONFIG_AUDIO_SAMPLE_RATE_HZ / 1000 * bc->frame_us / 1000;
+	ENC_Opus_ConfigTypeDef enc_cfg = {0};
+	DEC_Opus_ConfigTypeDef dec_cfg = {0};
+	int opus_err;
+	int ret;
+
+	memset(res, 0, sizeof(*res));
+
+	enc_cfg.ms_frame = bc->frame_us / 1000.0f;
+	enc_cfg.sample_freq = CONFIG_AUDIO_SAMPLE_RATE_HZ;
+	enc_cfg.channels = bc->ch;
+	enc_cfg.application = (uint16_t)OPUS_APPLICATION_AUDIO;
+	enc_cfg.bitrate = bc->bitrate;
+	enc_cfg.complexity = bc->complexity;
+	sw_codec_opus_profile_apply(NULL, &enc_cfg);
+
+	dec_cfg.ms_frame = enc_cfg.ms_frame;
+	dec_cfg.sample_freq = enc_cfg.sample_freq;
+	dec_cfg.channels = bc->ch;
+
+	zassert_equal(ENC_Opus_Init(&enc_cfg, &opus_err), OPUS_SUCCESS, "Encoder init: %d",
+		      opus_err);
+	zassert_equal(DEC_Opus_Init(&dec_cfg, &opus_err), OPUS_SUCCESS, "Decoder init: %d",
+		      opus_err);
+
+	for (uint32_t i = 0; i < BENCH_FRAMES; i++) {
+		uint64_t start;
+
+		vector_fill(bc->vector, i * samples, samples, bc->ch);
+
+		start = cpu_time_ns();
+		ret = ENC_Opus_Encode((uint8_t *)pcm_in, enc_buf);
+		enc_ns[i] = cpu_time_ns() - start;
+		zassert_true(ret > 0, "Encode: %d", ret);
+		res->enc_bytes_total += ret;
+
+		start = cpu_time_ns();
+		ret = DEC_Opus_Decode(enc_buf, ret, (uint8_t *)pcm_out);
+		dec_ns[i] = cpu_time_ns() - start;
+		zassert_true(ret >= 0, "Decode: %d", ret);
+	}
+
+	ENC_Opus_Deinit();
+	DEC_Opus_Deinit();
+
+	qsort(enc_ns, BENCH_FRAMES, sizeof(enc_ns[0]), u32_cmp);
+	qsort(dec_ns, BENCH_FRAMES, sizeof(dec_ns[0]), u32_cmp);
+	res->enc_p50_ns = percentile(enc_ns, BENCH_FRAMES, 50);
+	res->enc_p99_ns = percentile(enc_ns, BENCH_FRAMES, 99);
+	res->dec_p50_ns = percentile(dec_ns, BENCH_FRAMES, 50);
+	res->dec_p99_ns = percentile(dec_ns, BENCH_FRAMES, 99);
+}
+
+static const struct baseline_entry *baseline_find(const struct bench_case *bc)
+{
+	for (size_t i = 0; i < ARRAY_SIZE(baseline); i++) {
+		const struct baseline_entry *b = &baseline[i];
+
+		if (b->vector == bc->vector && b->frame_us == bc->frame_us && b->ch == bc->ch &&
+		    b->bitrate == bc->bitrate && b->complexity == bc->complexity) {
+			return b;
+		}
+	}
+
+	return NULL;
+}
+
+static bool permille_regressed(uint32_t permille, uint32_t base)
+{
+	return (uint64_t)permille * 100 > (uint64_t)base * (100 + BASELINE_TOLERANCE_PERCENT);
+}
+
+/**
+ * @brief Run one case and check it against the baseline.
+ *
+ * @return true if the case is slower than the baseline allows.
+ */
+static bool bench_case_check(const struct bench_case *bc, const struct bench_result *ref,
+			     uint32_t *unchecked)
+{
+	struct bench_result res;
+	const struct baseline_entry *base;
+	uint32_t enc_permille;
+	uint32_t dec_permille;
+	bool regressed = false;
+
+	bench_case_run(bc, &res);
+
+	enc_permille = (uint64_t)res.enc_p50_ns * 1000 / MAX(ref->enc_p50_ns, 1);
+	dec_permille = (uint64_t)res.dec_p50_ns * 1000 / MAX(ref->dec_p50_ns, 1);
+
+	TC_PRINT("%s,%u,%u,%u,%u,%u,%u,%u,%u,%u,%u,%u,%u,%u\n", vector_str[bc->vector],
+		 bc->frame_us, bc->ch, bc->bitrate, bc->complexity, res.enc_p50_ns,
+		 res.enc_p99_ns, res.dec_p50_ns, res.dec_p99_ns, res.enc_bytes_total / BENCH_FRAMES,
+		 opus_encoder_get_size(bc->ch), opus_decoder_get_size(bc->ch), enc_permille,
+		 dec_permille);
+
+	base = baseline_find(bc);
+	if (base == NULL) {
+		(*unchecked)++;
+		TC_PRINT("rel: {VEC_%s, %u, %u, %u, %u, %u, %u},\n",
+			 (bc->vector == VEC_TONE) ? "TONE" : "NOISE", bc->frame_us, bc->ch,
+			 bc->bitrate, bc->complexity, enc_permille, dec_permille);
+		return false;
+	}
+
+	if (permille_regressed(enc_permille, base->enc_permille)) {
+		TC_PRINT("Encode %u per mille of the reference, baseline %u\n", enc_permille,
+			 base->enc_permille);
+		regressed = true;
+	}
+
+	if (permille_regressed(dec_permille, base->dec_permille)) {
+		TC_PRINT("Decode %u per mille of the reference, baseline %u\n", dec_permille,
+			 base->dec_permille);
+		regressed = true;
+	}
+
+	return regressed;
+}
+
+ZTEST(codec_bench, test_sweep)
+{
+	struct bench_result ref[VEC_NUM];
+	struct bench_case bc;
+	uint32_t regressed = 0;
+	uint32_t unchecked = 0;
+
+	for (int v = 0; v < VEC_NUM; v++) {
+		bc.vector = v;
+		bc.frame_us = BASELINE_REF_FRAME_US;
+		bc.ch = BASELINE_REF_CH;
+		bc.bitrate = BASELINE_REF_BITRATE;
+		bc.complexity = BASELINE_REF_COMPLEXITY;
+		bench_case_run(&bc, &ref[v]);
+	}
+
+	TC_PRINT("vector,frame_us,ch,bitrate,cplx,enc_p50_ns,enc_p99_ns,dec_p50_ns,dec_p99_ns,"
+		 "pkt_bytes,enc_state_bytes,dec_state_bytes,enc_permille,dec_permille\n");
+
+	for (int v = 0; v < VEC_NUM; v++) {
+		for (int f = 0; f < ARRAY_SIZE(bench_frame_us); f++) {
+			for (int c = 0; c < ARRAY_SIZE(bench_ch); c++) {
+				for (int b = 0; b < ARRAY_SIZE(bench_bitrate); b++) {
+					for (int x = 0; x < ARRAY_SIZE(bench_complexity); x++) {
+						bc.vector = v;
+						bc.frame_us = bench_frame_us[f];
+						bc.ch = bench_ch[c];
+						bc.bitrate = bench_bitrate[b];
+						bc.complexity = bench_complexity[x];
+
+						regressed +=
+							bench_case_check(&bc, &ref[v], &unchecked);
+					}
+				}
+			}
+		}
+	}
+
+	if (unchecked) {
+		TC_PRINT("%u cases have no baseline entry\n", unchecked);
+	}
+
+	zassert_equal(regressed, 0, "%u cases slower than the baseline allows", regressed);
+}
+
+ZTEST_SUITE(codec_bench, NULL, NULL, NULL, NULL, NULL);
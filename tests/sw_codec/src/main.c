@@ -0,0 +1,360 @@
+/*
+ * Copyright (c) 2025 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+/** @file
+ * @brief Codec switching tests
+ *
+ * Switches between the codec backends the way the headset does when the
+ * codec of the received stream changes, and checks that every frame coded
+ * after a switch decodes to the frame that went in, also after a switch that
+ * failed to set up the new codec.
+ */
+
+#include <math.h>
+#include <zephyr/ztest.h>
+
+#include "sw_codec_select.h"
+#if (CONFIG_SW_CODEC_OPUS)
+#include "opus_interface.h"
+#endif /* (CONFIG_SW_CODEC_OPUS) */
+
+#define FRAME_SAMPLES	 (PCM_NUM_BYTES_MONO / sizeof(int16_t))
+#define FRAMES_PER_CODEC 10
+#define TONE_AMPLITUDE	 8000.0
+/* Different tones on left and right, so swapped channels are caught */
+#define TONE_L_HZ	 1000
+#define TONE_R_HZ	 1500
+/* IMA ADPCM gives 35 dB and more on these tones, about 21 dB on the first frame after
+ * init while the step size adapts from the smallest
+ */
+#define ADPCM_SNR_MIN_DB 15.0
+/* Opus output lags the input by the encoder lookahead and is compared after it. Not
+ * measured, Opus cannot be built here: the floor only has to catch a misaligned, lost
+ * or swapped channel, which scores 0 dB or less on these tones
+ */
+#define OPUS_SNR_MIN_DB	   10.0
+/* Frames after init before the Opus output is compared */
+#define OPUS_SETTLE_FRAMES 3
+
+static int16_t pcm_in[FRAME_SAMPLES * AUDIO_CH_NUM];
+static int16_t pcm_out[FRAME_SAMPLES * AUDIO_CH_NUM];
+static uint32_t pos;
+
+/* Last config given to sw_codec_init(), to uninit after a failed test */
+static struct sw_codec_config cur_cfg;
+/* Frames coded since cur_cfg was set up */
+static uint32_t cur_frames;
+
+/* Input sample n of a channel, silence before the first one */
+static int16_t tone_sample(uint8_t ch, int64_t n)
+{
+	const double w = 2.0 * M_PI * ((ch == AUDIO_CH_L) ? TONE_L_HZ : TONE_R_HZ) /
+			 CONFIG_AUDIO_SAMPLE_RATE_HZ;
+
+	return (n < 0) ? 0 : (int16_t)(TONE_AMPLITUDE * sin(w * n));
+}
+
+static void frame_fill(void)
+{
+	for (uint32_t i = 0; i < FRAME_SAMPLES; i++) {
+		pcm_in[i * AUDIO_CH_NUM + AUDIO_CH_L] = tone_sample(AUDIO_CH_L, pos);
+		pcm_in[i * AUDIO_CH_NUM + AUDIO_CH_R] = tone_sample(AUDIO_CH_R, pos);
+		pos++;
+	}
+}
+
+/* Samples the decoded output lags the input by */
+static uint32_t codec_delay_get(void)
+{
+#if (CONFIG_SW_CODEC_OPUS)
+	int lookahead;
+	int opus_err;
+
+	if (cur_cfg.sw_codec == SW_CODEC_OPUS) {
+		zassert_equal(ENC_Opus_Get_Lookahead(&lookahead, &opus_err), OPUS_SUCCESS,
+			      "Lookahead: %d", opus_err);
+		return lookahead;
+	}
+#endif /* (CONFIG_SW_CODEC_OPUS) */
+
+	return 0;
+}
+
+static struct sw_codec_config codec_cfg_get(enum sw_codec_select sw_codec, uint8_t num_ch)
+{
+	struct sw_codec_config cfg = {
+		.sw_codec = sw_codec,
+		.encoder = {
+			.enabled = true,
+			.bitrate = 96000,
+			.channel_mode = (num_ch == 1) ? SW_CODEC_MONO : SW_CODEC_STEREO,
+			.num_ch = num_ch,
+			.audio_ch = AUDIO_CH_L,
+			.sample_rate_hz = CONFIG_AUDIO_SAMPLE_RATE_HZ,
+		},
+		.decoder = {
+			.enabled = true,
+			.channel_mode = (num_ch == 1) ? SW_CODEC_MONO : SW_CODEC_STEREO,
+			.num_ch = num_ch,
+			.audio_ch = AUDIO_CH_L,
+			.sample_rate_hz = CONFIG_AUDIO_SAMPLE_RATE_HZ,
+		},
+	};
+
+	return cfg;
+}
+
+static void codec_switch(enum sw_codec_select sw_codec, uint8_t num_ch)
+{
+	int ret;
+
+	if (sw_codec_is_initialized()) {
+		ret = sw_codec_uninit(cur_cfg);
+		zassert_ok(ret, "Failed to uninit codec %d: %d", cur_cfg.sw_codec, ret);
+	}
+
+	cur_cfg = codec_cfg_get(sw_codec, num_ch);
+
+	ret = sw_codec_init(cur_cfg);
+	zassert_ok(ret, "Failed to init codec %d: %d", sw_codec, ret);
+	cur_cfg.initialized = true;
+	cur_frames = 0;
+}
+
+/**
+ * @brief Code one frame with the current codec and compare the decoded frame with
+ *	  the input delayed by the codec, bit exact or within the SNR the codec keeps.
+ */
+static void frame_round_trip(void)
+{
+	int ret;
+	uint8_t num_ch = cur_cfg.decoder.num_ch;
+	uint8_t *encoded;
+	size_t encoded_size;
+	void *decoded = pcm_out;
+	size_t decoded_size;
+	double sig = 0;
+	double err = 0;
+	double snr;
+	uint32_t start = pos;
+	uint32_t delay = codec_delay_get();
+	bool lossy = (cur_cfg.sw_codec == SW_CODEC_ADPCM) || (cur_cfg.sw_codec == SW_CODEC_OPUS);
+
+	frame_fill();
+
+	ret = sw_codec_encode(pcm_in, sizeof(pcm_in), &encoded, &encoded_size);
+	zassert_ok(ret, "Encode failed: %d", ret);
+	zassert_true(encoded_size > 0 && encoded_size <= sw_codec_enc_frame_size_get(),
+		     "Encoded size %zu above the frame size of the codec", encoded_size);
+
+	ret = sw_codec_decode(encoded, encoded_size, false, &decoded, &decoded_size);
+	zassert_ok(ret, "Decode failed: %d", ret);
+	zassert_equal(decoded_size, PCM_NUM_BYTES_MONO * num_ch, "Decoded %zu bytes for %d ch",
+		      decoded_size, num_ch);
+
+	for (uint32_t n = 0; n < FRAME_SAMPLES * num_ch; n++) {
+		/* A mono frame carries the left channel */
+		uint8_t ch = (num_ch == 1) ? AUDIO_CH_L : n % AUDIO_CH_NUM;
+		int16_t ref = tone_sample(ch, (int64_t)start + n / num_ch - delay);
+		int16_t out = ((int16_t *)decoded)[n];
+
+		if (!lossy) {
+			zassert_equal(out, ref, "Codec %d sample %d: %d, expected %d",
+				      cur_cfg.sw_codec, n, out, ref);
+		}
+
+		sig += (double)ref * ref;
+		err += (double)(out - ref) * (out - ref);
+	}
+
+	cur_frames++;
+	snr = 10.0 * log10(sig / MAX(err, 1.0));
+
+	if (cur_cfg.sw_codec == SW_CODEC_ADPCM) {
+		zassert_true(snr >= ADPCM_SNR_MIN_DB, "ADPCM SNR %.1f dB", snr);
+	} else if (cur_cfg.sw_codec == SW_CODEC_OPUS && cur_frames > OPUS_SETTLE_FRAMES) {
+		zassert_true(snr >= OPUS_SNR_MIN_DB, "Opus %d ch frame %d: SNR %.1f dB, delay %d",
+			     num_ch, cur_frames, snr, delay);
+	}
+}
+
+static void codec_after(void *fixture)
+{
+	ARG_UNUSED(fixture);
+
+	if (sw_codec_is_initialized()) {
+		(void)sw_codec_uninit(cur_cfg);
+	}
+}
+
+ZTEST(sw_codec_switch, test_round_trip)
+{
+	static const uint8_t num_ch[] = {1, 2};
+
+	/* The reference of a mono frame is picked from 16 bit samples */
+	Z_TEST_SKIP_IFDEF(CONFIG_AUDIO_BIT_DEPTH_32);
+
+	for (int c = 0; c < SW_CODEC_NUM; c++) {
+		/* LC3 is the nrfxlib T2 library, prebuilt for Arm Cortex-M only, so it is
+		 * never built on native_sim
+		 */
+		if (sw_codec_ops_get(c) == NULL || c == SW_CODEC_LC3) {
+			continue;
+		}
+
+		for (int n = 0; n < ARRAY_SIZE(num_ch); n++) {
+			codec_switch(c, num_ch[n]);
+
+			for (int f = 0; f < FRAMES_PER_CODEC; f++) {
+				frame_round_trip();
+			}
+		}
+	}
+}
+
+ZTEST(sw_codec_switch, test_switch_every_frame)
+{
+	/* Codec per frame, as sent by a gateway that is switched back and forth */
+	static const enum sw_codec_select seq[] = {
+		SW_CODEC_NONE,  SW_CODEC_LOSSLESS, SW_CODEC_ADPCM,    SW_CODEC_NONE,
+		SW_CODEC_ADPCM, SW_CODEC_ADPCM,    SW_CODEC_LOSSLESS, SW_CODEC_LOSSLESS,
+		SW_CODEC_NONE,  SW_CODEC_NONE,
+	};
+
+	Z_TEST_SKIP_IFNDEF(CONFIG_SW_CODEC_LOSSLESS);
+	Z_TEST_SKIP_IFNDEF(CONFIG_SW_CODEC_ADPCM);
+
+	for (int i = 0; i < ARRAY_SIZE(seq); i++) {
+		if (!sw_codec_is_initialized() || cur_cfg.sw_codec != seq[i]) {
+			codec_switch(seq[i], 2);
+		}
+
+		frame_round_trip();
+	}
+}
+
+ZTEST(sw_codec_switch, test_switch_errors)
+{
+	int ret;
+	struct sw_codec_config other;
+
+	codec_switch(SW_CODEC_NONE, 2);
+
+	ret = sw_codec_init(cur_cfg);
+	zassert_equal(ret, -EALREADY, "Init of an initialized codec returned %d", ret);
+
+	/* The running codec is only torn down with its own config */
+	other = codec_cfg_get(SW_CODEC_NUM - 1, 2);
+	if (other.sw_codec != cur_cfg.sw_codec) {
+		ret = sw_codec_uninit(other);
+		zassert_equal(ret, -ENODEV, "Uninit of another codec returned %d", ret);
+		zassert_true(sw_codec_is_initialized(), "Running codec was torn down");
+	}
+
+	ret = sw_codec_uninit(cur_cfg);
+	zassert_ok(ret, "Uninit failed: %d", ret);
+
+	/* Nothing is set up, even if the config matches the one torn down */
+	ret = sw_codec_uninit(cur_cfg);
+	zassert_equal(ret, -EALREADY, "Second uninit returned %d", ret);
+
+	ret = sw_codec_init(codec_cfg_get(SW_CODEC_NUM, 2));
+	zassert_equal(ret, -ENODEV, "Init of an unknown codec returned %d", ret);
+	zassert_false(sw_codec_is_initialized(), "Unknown codec left initialized");
+
+	if (!IS_ENABLED(CONFIG_SW_CODEC_LC3)) {
+		ret = sw_codec_init(codec_cfg_get(SW_CODEC_LC3, 2));
+		zassert_equal(ret, -ENODEV, "Init of a codec not built returned %d", ret);
+		zassert_false(sw_codec_is_initialized(), "Codec not built left initialized");
+	}
+
+	/* And the next switch still works */
+	codec_switch(SW_CODEC_NONE, 2);
+	frame_round_trip();
+}
+
+ZTEST(sw_codec_switch, test_switch_failure)
+{
+	int ret;
+
+	Z_TEST_SKIP_IFNDEF(CONFIG_SW_CODEC_LOSSLESS);
+
+	codec_switch(SW_CODEC_NONE, 2);
+
+	/* No codec takes a rate above the system rate, so the previous one fails as well */
+	cur_cfg.decoder.sample_rate_hz = CONFIG_AUDIO_SAMPLE_RATE_HZ * 2;
+	ret = sw_codec_switch(&cur_cfg, SW_CODEC_LOSSLESS);
+	zassert_true(ret < 0, "Switch with a bad rate returned %d", ret);
+	zassert_false(sw_codec_is_initialized(), "Codec set up with a bad rate");
+	zassert_false(cur_cfg.initialized, "Config still marked initialized");
+	zassert_equal(cur_cfg.sw_codec, SW_CODEC_NUM, "Config left on codec %d",
+		      cur_cfg.sw_codec);
+
+	/* The next frame tries again and sets up from scratch */
+	cur_cfg.decoder.sample_rate_hz = CONFIG_AUDIO_SAMPLE_RATE_HZ;
+	ret = sw_codec_switch(&cur_cfg, SW_CODEC_LOSSLESS);
+	zassert_ok(ret, "Switch after a failed one returned %d", ret);
+	zassert_true(cur_cfg.initialized && cur_cfg.sw_codec == SW_CODEC_LOSSLESS,
+		     "Config on codec %d", cur_cfg.sw_codec);
+	frame_round_trip();
+}
+
+#if (CONFIG_SW_CODEC_OPUS)
+#define HEAP_BLOCKS_MAX 64
+
+static void *heap_blocks[HEAP_BLOCKS_MAX];
+
+/* Take the whole heap in ever smaller blocks, so Opus cannot allocate its state */
+static void heap_take(void)
+{
+	size_t size = CONFIG_HEAP_MEM_POOL_SIZE;
+
+	for (int i = 0; (i < HEAP_BLOCKS_MAX) && (size >= sizeof(void *));) {
+		heap_blocks[i] = k_malloc(size);
+		if (heap_blocks[i] == NULL) {
+			size /= 2;
+		} else {
+			i++;
+		}
+	}
+}
+
+static void heap_give(void)
+{
+	for (int i = 0; i < HEAP_BLOCKS_MAX; i++) {
+		k_free(heap_blocks[i]);
+		heap_blocks[i] = NULL;
+	}
+}
+#endif /* (CONFIG_SW_CODEC_OPUS) */
+
+ZTEST(sw_codec_switch, test_switch_fallback)
+{
+	Z_TEST_SKIP_IFNDEF(CONFIG_SW_CODEC_OPUS);
+#if (CONFIG_SW_CODEC_OPUS)
+	int ret;
+
+	codec_switch(SW_CODEC_NONE, 2);
+
+	/* Opus fails to allocate, PCM is set up again and keeps the stream going */
+	heap_take();
+	ret = sw_codec_switch(&cur_cfg, SW_CODEC_OPUS);
+	heap_give();
+
+	zassert_equal(ret, -ENOMEM, "Switch without heap returned %d", ret);
+	zassert_true(cur_cfg.initialized && cur_cfg.sw_codec == SW_CODEC_NONE,
+		     "Config on codec %d, initialized %d", cur_cfg.sw_codec, cur_cfg.initialized);
+	frame_round_trip();
+
+	/* The next frame with the Opus codec id tries again */
+	ret = sw_codec_switch(&cur_cfg, SW_CODEC_OPUS);
+	zassert_ok(ret, "Switch with heap returned %d", ret);
+	zassert_true(cur_cfg.initialized && cur_cfg.sw_codec == SW_CODEC_OPUS,
+		     "Config on codec %d", cur_cfg.sw_codec);
+#endif /* (CONFIG_SW_CODEC_OPUS) */
+}
+
+ZTEST_SUITE(sw_codec_switch, NULL, NULL, NULL, codec_after, NULL);
@@ -0,0 +1,180 @@
+/*
+ * Copyright (c) 2025 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+/** @file
+ * @brief Opus 24 bit path tests
+ *
+ * Codes a 1 kHz tone at falling levels through a 24 bit and a 16 bit Opus
+ * path and fits a sine to the output by least squares. Everything that is
+ * not the fitted sine counts as noise, so the SNR shows where each path
+ * runs out of bits. The 24 bit path must keep the low level tones the 16
+ * bit path loses in its rounding.
+ */
+
+#include <math.h>
+#include <zephyr/ztest.h>
+
+#include "opus_interface.h"
+#include "sw_codec_opus.h"
+#include "sw_codec_select.h"
+
+#define DEPTH_FRAME_US	    10000
+#define DEPTH_BITRATE	    256000
+#define DEPTH_COMPLEXITY    10
+#define DEPTH_SETTLE_FRAMES 10
+#define DEPTH_FRAMES	    50
+#define DEPTH_SAMPLES	    (CONFIG_AUDIO_SAMPLE_RATE_HZ / 1000 * DEPTH_FRAME_US / 1000)
+#define DEPTH_TONE_PERIOD   (CONFIG_AUDIO_SAMPLE_RATE_HZ / 1000)
+/* Full scale of a 24 bit sample, and one 16 bit step in 24 bit samples */
+#define DEPTH_FULL_SCALE    8388607
+#define DEPTH_STEP_16	    256
+/* Below about -80 dBFS a 16 bit tone is a few steps, the 24 bit path must do better */
+#define DEPTH_LOW_LEVEL_DB  -80
+#define DEPTH_GAIN_MIN_DB   6.0
+#define DEPTH_ENC_BUF_SIZE  (DEPTH_BITRATE / 8 * DEPTH_FRAME_US / USEC_PER_SEC * 2)
+
+static const int8_t depth_level_db[] = {-20, -60, -80, -90};
+
+static int32_t pcm_in[DEPTH_SAMPLES];
+static int32_t pcm_out[DEPTH_SAMPLES];
+static uint8_t enc_buf[DEPTH_ENC_BUF_SIZE];
+static double depth_sin[DEPTH_TONE_PERIOD];
+
+/* Round a 24 bit sample to the nearest 16 bit step */
+static int32_t depth_to_16(int32_t x)
+{
+	return CLAMP((x + DEPTH_STEP_16 / 2) & ~(DEPTH_STEP_16 - 1), -DEPTH_FULL_SCALE,
+		     DEPTH_FULL_SCALE);
+}
+
+/**
+ * @brief Code the tone at a level with 24 or 16 significant bits.
+ *
+ * @return SNR in dB of the output against the sine fitted to it, -INFINITY if the tone
+ *	   was lost.
+ */
+static double depth_snr(int8_t level_db, uint8_t bits)
+{
+	double amplitude = DEPTH_FULL_SCALE * pow(10.0, level_db / 20.0);
+	ENC_Opus_ConfigTypeDef enc_cfg = {0};
+	DEC_Opus_ConfigTypeDef dec_cfg = {0};
+	/* Sums of the normal equations for x ~ a * sin + b * cos */
+	double sxx = 0, sss = 0, scc = 0, ssc = 0, sxs = 0, sxc = 0;
+	double det, a, c, fit;
+	uint32_t pos = 0;
+	int opus_err;
+	int ret;
+
+	enc_cfg.ms_frame = DEPTH_FRAME_US / 1000.0f;
+	enc_cfg.sample_freq = CONFIG_AUDIO_SAMPLE_RATE_HZ;
+	enc_cfg.channels = 1;
+	enc_cfg.application = (uint16_t)OPUS_APPLICATION_AUDIO;
+	enc_cfg.bitrate = DEPTH_BITRATE;
+	enc_cfg.complexity = DEPTH_COMPLEXITY;
+	enc_cfg.res24 = 1;
+	sw_codec_opus_profile_apply(NULL, &enc_cfg);
+	enc_cfg.lsb_depth = bits;
+
+	dec_cfg.ms_frame = enc_cfg.ms_frame;
+	dec_cfg.sample_freq = enc_cfg.sample_freq;
+	dec_cfg.channels = 1;
+	dec_cfg.res24 = 1;
+
+	zassert_equal(ENC_Opus_Init(&enc_cfg, &opus_err), OPUS_SUCCESS, "Encoder init: %d",
+		      opus_err);
+	zassert_equal(DEC_Opus_Init(&dec_cfg, &opus_err), OPUS_SUCCESS, "Decoder init: %d",
+		      opus_err);
+
+	for (uint32_t f = 0; f < DEPTH_SETTLE_FRAMES + DEPTH_FRAMES; f++) {
+		/* A 16 bit path is modelled by rounding input and output to 16 bit steps */
+		for (uint32_t i = 0; i < DEPTH_SAMPLES; i++) {
+			pcm_in[i] = (int32_t)lround(amplitude *
+						    depth_sin[(pos + i) % DEPTH_TONE_PERIOD]);
+			pcm_in[i] = (bits == 16) ? depth_to_16(pcm_in[i]) : pcm_in[i];
+		}
+
+		ret = ENC_Opus_Encode((uint8_t *)pcm_in, enc_buf);
+		zassert_true(ret > 0, "Encode failed: %d", ret);
+
+		ret = DEC_Opus_Decode(enc_buf, ret, (uint8_t *)pcm_out);
+		zassert_true(ret >= 0, "Decode failed: %d", ret);
+
+		/* Skip the codec start up, the delay itself is absorbed by the fit phase */
+		for (uint32_t i = 0; (f >= DEPTH_SETTLE_FRAMES) && (i < DEPTH_SAMPLES); i++) {
+			double x = (bits == 16) ? depth_to_16(pcm_out[i]) : pcm_out[i];
+			uint32_t n = pos + i;
+			double sn = depth_sin[n % DEPTH_TONE_PERIOD];
+			double cs = depth_sin[(n + DEPTH_TONE_PERIOD / 4) % DEPTH_TONE_PERIOD];
+
+			sxx += x * x;
+			sss += sn * sn;
+			scc += cs * cs;
+			ssc += sn * cs;
+			sxs += x * sn;
+			sxc += x * cs;
+		}
+
+		pos += DEPTH_SAMPLES;
+	}
+
+	ENC_Opus_Deinit();
+	DEC_Opus_Deinit();
+
+	det = sss * scc - ssc * ssc;
+	a = (sxs * scc - sxc * ssc) / det;
+	c = (sxc * sss - sxs * ssc) / det;
+	fit = a * sxs + c * sxc;
+
+	if (fit <= 0.0) {
+		return -INFINITY;
+	}
+
+	/* Nothing but the tone came out */
+	if (sxx <= fit) {
+		return INFINITY;
+	}
+
+	return 10.0 * log10(fit / (sxx - fit));
+}
+
+static void *depth_setup(void)
+{
+	for (int i = 0; i < DEPTH_TONE_PERIOD; i++) {
+		depth_sin[i] = sin(2.0 * M_PI * i / DEPTH_TONE_PERIOD);
+	}
+
+	return NULL;
+}
+
+static void depth_after(void *fixture)
+{
+	ARG_UNUSED(fixture);
+
+	ENC_Opus_Deinit();
+	DEC_Opus_Deinit();
+}
+
+ZTEST(sw_codec_opus_depth, test_low_level_tones)
+{
+	for (int l = 0; l < ARRAY_SIZE(depth_level_db); l++) {
+		double snr_24 = depth_snr(depth_level_db[l], 24);
+		double snr_16 = depth_snr(depth_level_db[l], 16);
+
+		TC_PRINT("%d dBFS: %.1f dB SNR with 24 bits, %.1f dB with 16 bits\n",
+			 depth_level_db[l], snr_24, snr_16);
+
+		zassert_true(snr_24 > -INFINITY, "%d dBFS tone lost with 24 bits",
+			     depth_level_db[l]);
+
+		if (depth_level_db[l] <= DEPTH_LOW_LEVEL_DB) {
+			zassert_true(snr_24 >= snr_16 + DEPTH_GAIN_MIN_DB,
+				     "%d dBFS: 24 bits %.1f dB, 16 bits %.1f dB",
+				     depth_level_db[l], snr_24, snr_16);
+		}
+	}
+}
+
+ZTEST_SUITE(sw_codec_opus_depth, NULL, depth_setup, NULL, depth_after, NULL);
@@ -0,0 +1,249 @@
+/*
+ * Copyright (c) 2025 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+/** @file
+ * @brief Opus multistream decode tests
+ *
+ * Codes a tone on each channel, each with its own frequency, as two
+ * uncoupled streams like CONFIG_OPUS_MULTISTREAM does. Each stream is then
+ * decoded on its own with a one channel decoder, which must return its own
+ * tone and not the other one. The same signal is also coded as one stereo
+ * stream to compare the decode CPU time per decoded channel.
+ */
+
+#include <math.h>
+#include <time.h>
+#include <zephyr/ztest.h>
+
+#include "opus_interface.h"
+#include "sw_codec_opus.h"
+#include "sw_codec_select.h"
+
+#define MS_FRAME_US	 10000
+#define MS_BITRATE	 128000
+#define MS_COMPLEXITY	 0
+#define MS_CH		 2
+#define MS_SETTLE_FRAMES 10
+#define MS_FRAMES	 100
+#define MS_SAMPLES	 (CONFIG_AUDIO_SAMPLE_RATE_HZ / 1000 * MS_FRAME_US / 1000)
+/* CBR packet size of ENC_Opus_getMemorySize() */
+#define MS_PKT_MAX	 (MS_BITRATE / 8 * MS_FRAME_US / USEC_PER_SEC * 2)
+#define MS_AMPLITUDE	 16384.0
+/* A stream must carry its own tone and keep the other one well below it */
+#define MS_SNR_MIN_DB	 20.0
+#define MS_CROSSTALK_DB	 -40.0
+
+static const uint16_t ms_tone_hz[MS_CH] = {1000, 1500};
+
+static int16_t pcm_in[MS_SAMPLES * MS_CH];
+static int16_t pcm_out[MS_SAMPLES * MS_CH];
+static uint8_t pkt[MS_FRAMES][MS_PKT_MAX];
+static uint16_t pkt_len[MS_FRAMES];
+
+/* Sums of the normal equations for x ~ a * sin + b * cos at one frequency */
+struct ms_fit {
+	double sxx, sss, scc, ssc, sxs, sxc;
+};
+
+/* CPU time of the calling thread, each native_sim thread is a host thread */
+static uint64_t cpu_time_ns(void)
+{
+#if defined(CONFIG_EXTERNAL_LIBC)
+	struct timespec ts;
+
+	clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+
+	return (uint64_t)ts.tv_sec * NSEC_PER_SEC + ts.tv_nsec;
+#else
+	return 0;
+#endif /* defined(CONFIG_EXTERNAL_LIBC) */
+}
+
+static double ms_phase(uint8_t ch, uint32_t n)
+{
+	return 2.0 * M_PI * ms_tone_hz[ch] * n / CONFIG_AUDIO_SAMPLE_RATE_HZ;
+}
+
+static void ms_fit_add(struct ms_fit *fit, double x, double phase)
+{
+	double sn = sin(phase);
+	double cs = cos(phase);
+
+	fit->sxx += x * x;
+	fit->sss += sn * sn;
+	fit->scc += cs * cs;
+	fit->ssc += sn * cs;
+	fit->sxs += x * sn;
+	fit->sxc += x * cs;
+}
+
+/**
+ * @brief Level of the fitted tone and of everything else.
+ *
+ * @return SNR in dB, and in level_db the tone level in dB of MS_AMPLITUDE.
+ */
+static double ms_fit_snr(const struct ms_fit *fit, double *level_db)
+{
+	double det = fit->sss * fit->scc - fit->ssc * fit->ssc;
+	double a = (fit->sxs * fit->scc - fit->sxc * fit->ssc) / det;
+	double c = (fit->sxc * fit->sss - fit->sxs * fit->ssc) / det;
+	double tone = a * fit->sxs + c * fit->sxc;
+
+	/* Mean square of the fitted tone against that of a sine of MS_AMPLITUDE */
+	*level_db = 10.0 * log10(MAX(tone, 1e-9) / (fit->sss + fit->scc) /
+				 (MS_AMPLITUDE * MS_AMPLITUDE / 2.0));
+
+	if (fit->sxx <= tone) {
+		return INFINITY;
+	}
+
+	return 10.0 * log10(MAX(tone, 1e-9) / (fit->sxx - tone));
+}
+
+/* Code MS_FRAMES frames of the two tones as two mono streams or one stereo stream */
+static void ms_encode(uint8_t streams)
+{
+	ENC_Opus_ConfigTypeDef enc_cfg = {0};
+	int opus_err;
+	int ret;
+
+	enc_cfg.ms_frame = MS_FRAME_US / 1000.0f;
+	enc_cfg.sample_freq = CONFIG_AUDIO_SAMPLE_RATE_HZ;
+	enc_cfg.channels = MS_CH;
+	enc_cfg.application = (uint16_t)OPUS_APPLICATION_AUDIO;
+	enc_cfg.bitrate = MS_BITRATE;
+	enc_cfg.complexity = MS_COMPLEXITY;
+	sw_codec_opus_profile_apply(NULL, &enc_cfg);
+	enc_cfg.rate_control = OPUS_RATE_CBR;
+	enc_cfg.streams = streams;
+	enc_cfg.coupled_streams = 0;
+
+	zassert_equal(ENC_Opus_Init(&enc_cfg, &opus_err), OPUS_SUCCESS, "Encoder init: %d",
+		      opus_err);
+
+	for (uint32_t f = 0; f < MS_FRAMES; f++) {
+		for (uint32_t i = 0; i < MS_SAMPLES; i++) {
+			for (uint8_t c = 0; c < MS_CH; c++) {
+				pcm_in[i * MS_CH + c] = (int16_t)lround(
+					MS_AMPLITUDE * sin(ms_phase(c, f * MS_SAMPLES + i)));
+			}
+		}
+
+		ret = ENC_Opus_Encode((uint8_t *)pcm_in, pkt[f]);
+		zassert_true(ret > 0 && ret <= MS_PKT_MAX, "Encode: %d", ret);
+		pkt_len[f] = ret;
+	}
+
+	ENC_Opus_Deinit();
+}
+
+/**
+ * @brief Decode the coded frames, as one stereo stream if streams is 0, else only stream
+ *	  stream_id. Fits the tone of ch_fit to the first output channel.
+ *
+ * @return Decode CPU time in ns.
+ */
+static uint64_t ms_decode(uint8_t streams, uint8_t stream_id, uint8_t ch_fit, struct ms_fit *fit)
+{
+	DEC_Opus_ConfigTypeDef dec_cfg = {0};
+	uint8_t ch = streams ? 1 : MS_CH;
+	uint64_t dec_ns = 0;
+	int opus_err;
+	int ret;
+
+	dec_cfg.ms_frame = MS_FRAME_US / 1000.0f;
+	dec_cfg.sample_freq = CONFIG_AUDIO_SAMPLE_RATE_HZ;
+	dec_cfg.channels = ch;
+	dec_cfg.streams = streams;
+	dec_cfg.stream_id = stream_id;
+
+	zassert_equal(DEC_Opus_Init(&dec_cfg, &opus_err), OPUS_SUCCESS, "Decoder init: %d",
+		      opus_err);
+
+	for (uint32_t f = 0; f < MS_FRAMES; f++) {
+		uint64_t start = cpu_time_ns();
+
+		ret = DEC_Opus_Decode(pkt[f], pkt_len[f], (uint8_t *)pcm_out);
+		dec_ns += cpu_time_ns() - start;
+		zassert_equal(ret, MS_SAMPLES, "Decode stream %u: %d", stream_id, ret);
+
+		/* Skip the codec start up, the delay itself is absorbed by the fit phase */
+		for (uint32_t i = 0; (fit != NULL) && (f >= MS_SETTLE_FRAMES) && (i < MS_SAMPLES);
+		     i++) {
+			ms_fit_add(fit, pcm_out[i * ch], ms_phase(ch_fit, f * MS_SAMPLES + i));
+		}
+	}
+
+	DEC_Opus_Deinit();
+
+	return dec_ns;
+}
+
+static void ms_after(void *fixture)
+{
+	ARG_UNUSED(fixture);
+
+	ENC_Opus_Deinit();
+	DEC_Opus_Deinit();
+}
+
+ZTEST(sw_codec_opus_multistream, test_stream_decode)
+{
+	ms_encode(MS_CH);
+
+	for (uint8_t s = 0; s < MS_CH; s++) {
+		struct ms_fit own = {0};
+		struct ms_fit other = {0};
+		double own_db, other_db;
+		double snr;
+
+		ms_decode(MS_CH, s, s, &own);
+		ms_decode(MS_CH, s, MS_CH - 1 - s, &other);
+
+		snr = ms_fit_snr(&own, &own_db);
+		ms_fit_snr(&other, &other_db);
+
+		TC_PRINT("Stream %u: %.1f dB SNR, other tone at %.1f dB\n", s, snr, other_db);
+
+		zassert_true(snr >= MS_SNR_MIN_DB, "Stream %u: %.1f dB SNR", s, snr);
+		zassert_true(other_db <= MS_CROSSTALK_DB, "Stream %u: other tone at %.1f dB", s,
+			     other_db);
+	}
+}
+
+ZTEST(sw_codec_opus_multistream, test_decode_cpu_per_channel)
+{
+	uint64_t stereo_ns;
+	uint64_t stream_ns[MS_CH];
+
+	if (!IS_ENABLED(CONFIG_EXTERNAL_LIBC)) {
+		ztest_test_skip();
+	}
+
+	ms_encode(0);
+	stereo_ns = ms_decode(0, 0, 0, NULL);
+
+	ms_encode(MS_CH);
+	for (uint8_t s = 0; s < MS_CH; s++) {
+		stream_ns[s] = ms_decode(MS_CH, s, s, NULL);
+	}
+
+	/* Host CPU time, only the ratios carry over to the target */
+	TC_PRINT("Decode per frame: stereo %u ns, %u ns per channel, stream 0 %u ns, "
+		 "stream 1 %u ns\n",
+		 (uint32_t)(stereo_ns / MS_FRAMES), (uint32_t)(stereo_ns / MS_FRAMES / MS_CH),
+		 (uint32_t)(stream_ns[0] / MS_FRAMES), (uint32_t)(stream_ns[1] / MS_FRAMES));
+
+	/* Decoding one channel of two has to save time over decoding the stereo stream */
+	for (uint8_t s = 0; s < MS_CH; s++) {
+		zassert_true(stream_ns[s] < stereo_ns,
+			     "Stream %u decode %u ns, stereo decode %u ns per frame", s,
+			     (uint32_t)(stream_ns[s] / MS_FRAMES),
+			     (uint32_t)(stereo_ns / MS_FRAMES));
+	}
+}
+
+ZTEST_SUITE(sw_codec_opus_multistream, NULL, NULL, NULL, ms_after, NULL);
@@ -0,0 +1,173 @@
+/*
+ * Copyright (c) 2025 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+/** @file
+ * @brief Opus encoder profile tests
+ *
+ * Codes a mix of tones with each encoder profile and checks that the
+ * highest tone that survives the codec is the highest one inside the
+ * bandwidth the profile asks for.
+ */
+
+#include <math.h>
+#include <zephyr/ztest.h>
+
+#include "opus_interface.h"
+#include "sw_codec_opus.h"
+#include "sw_codec_select.h"
+
+#define PROFILE_FRAME_US       10000
+#define PROFILE_SAMPLES	       (CONFIG_AUDIO_SAMPLE_RATE_HZ / 1000 * PROFILE_FRAME_US / 1000)
+#define PROFILE_CH	       2
+#define PROFILE_SETTLE_FRAMES  10
+#define PROFILE_FRAMES	       50
+#define PROFILE_TONE_AMPLITUDE 3000.0
+/* A tone is coded if it keeps at least a tenth of its power */
+#define PROFILE_PASS_RATIO     0.1
+/* Twice the average packet of the highest profile bitrate, as ENC_Opus_Init allows */
+#define PROFILE_ENC_BUF_SIZE   (160000 * PROFILE_CH / 8 * PROFILE_FRAME_US / USEC_PER_SEC * 2)
+
+/* Between the edges of NB, WB, SWB and FB so each bandwidth passes a different set */
+static const uint16_t profile_tone_hz[] = {3000, 5000, 7000, 10000, 14000, 18000};
+
+static int16_t pcm_in[PROFILE_SAMPLES * PROFILE_CH];
+static int16_t pcm_out[PROFILE_SAMPLES * PROFILE_CH];
+static uint8_t enc_buf[PROFILE_ENC_BUF_SIZE];
+
+/**
+ * @brief Goertzel power of one tone in the first channel of an interleaved frame.
+ */
+static double tone_power(const int16_t *pcm, uint32_t freq_hz)
+{
+	double coeff = 2.0 * cos(2.0 * M_PI * freq_hz / CONFIG_AUDIO_SAMPLE_RATE_HZ);
+	double s1 = 0;
+	double s2 = 0;
+
+	for (uint32_t i = 0; i < PROFILE_SAMPLES; i++) {
+		double s0 = pcm[i * PROFILE_CH] + coeff * s1 - s2;
+
+		s2 = s1;
+		s1 = s0;
+	}
+
+	return s1 * s1 + s2 * s2 - coeff * s1 * s2;
+}
+
+static void profile_check(const char *name)
+{
+	const struct sw_codec_opus_profile *profile = sw_codec_opus_profile_find(name);
+	ENC_Opus_ConfigTypeDef enc_cfg = {0};
+	DEC_Opus_ConfigTypeDef dec_cfg = {0};
+	double in_pwr[ARRAY_SIZE(profile_tone_hz)] = {0};
+	double out_pwr[ARRAY_SIZE(profile_tone_hz)] = {0};
+	uint32_t bandwidth_hz;
+	uint32_t measured_hz = 0;
+	uint32_t expected_hz = 0;
+	uint32_t pos = 0;
+	int opus_err;
+	int ret;
+
+	zassert_not_null(profile, "No profile %s", name);
+
+	enc_cfg.ms_frame = PROFILE_FRAME_US / 1000.0f;
+	enc_cfg.sample_freq = CONFIG_AUDIO_SAMPLE_RATE_HZ;
+	enc_cfg.channels = PROFILE_CH;
+	enc_cfg.application = (uint16_t)OPUS_APPLICATION_AUDIO;
+	sw_codec_opus_profile_apply(profile, &enc_cfg);
+	/* Bandwidth after the sample rate cap */
+	bandwidth_hz = sw_codec_opus_bandwidth_hz(enc_cfg.bandwidth);
+
+	dec_cfg.ms_frame = enc_cfg.ms_frame;
+	dec_cfg.sample_freq = enc_cfg.sample_freq;
+	dec_cfg.channels = PROFILE_CH;
+
+	zassert_equal(ENC_Opus_Init(&enc_cfg, &opus_err), OPUS_SUCCESS, "Encoder init: %d",
+		      opus_err);
+	zassert_equal(DEC_Opus_Init(&dec_cfg, &opus_err), OPUS_SUCCESS, "Decoder init: %d",
+		      opus_err);
+
+	for (uint32_t f = 0; f < PROFILE_SETTLE_FRAMES + PROFILE_FRAMES; f++) {
+		for (uint32_t i = 0; i < PROFILE_SAMPLES; i++) {
+			double x = 0;
+
+			for (int t = 0; t < ARRAY_SIZE(profile_tone_hz); t++) {
+				if (2 * profile_tone_hz[t] < CONFIG_AUDIO_SAMPLE_RATE_HZ) {
+					x += PROFILE_TONE_AMPLITUDE *
+					     sin(2.0 * M_PI * profile_tone_hz[t] * (pos + i) /
+						 CONFIG_AUDIO_SAMPLE_RATE_HZ);
+				}
+			}
+
+			for (uint8_t c = 0; c < PROFILE_CH; c++) {
+				pcm_in[i * PROFILE_CH + c] = (int16_t)x;
+			}
+		}
+		pos += PROFILE_SAMPLES;
+
+		ret = ENC_Opus_Encode((uint8_t *)pcm_in, enc_buf);
+		zassert_true(ret > 0, "Encode failed: %d", ret);
+
+		ret = DEC_Opus_Decode(enc_buf, ret, (uint8_t *)pcm_out);
+		zassert_true(ret >= 0, "Decode failed: %d", ret);
+
+		/* Power is independent of the codec delay once the tones are steady */
+		for (int t = 0; (f >= PROFILE_SETTLE_FRAMES) && (t < ARRAY_SIZE(profile_tone_hz));
+		     t++) {
+			in_pwr[t] += tone_power(pcm_in, profile_tone_hz[t]);
+			out_pwr[t] += tone_power(pcm_out, profile_tone_hz[t]);
+		}
+	}
+
+	ENC_Opus_Deinit();
+	DEC_Opus_Deinit();
+
+	for (int t = 0; t < ARRAY_SIZE(profile_tone_hz); t++) {
+		if (in_pwr[t] == 0) {
+			continue;
+		}
+
+		TC_PRINT("%s: %5d Hz %.1f dB\n", name, profile_tone_hz[t],
+			 10.0 * log10(MAX(out_pwr[t], 1.0) / in_pwr[t]));
+
+		if (out_pwr[t] >= in_pwr[t] * PROFILE_PASS_RATIO) {
+			measured_hz = profile_tone_hz[t];
+		}
+
+		if (profile_tone_hz[t] < bandwidth_hz) {
+			expected_hz = profile_tone_hz[t];
+		}
+	}
+
+	zassert_equal(measured_hz, expected_hz,
+		      "%s: highest coded tone %d Hz, expected %d Hz for %d Hz bandwidth", name,
+		      measured_hz, expected_hz, bandwidth_hz);
+}
+
+static void profile_after(void *fixture)
+{
+	ARG_UNUSED(fixture);
+
+	/* Both are safe to call when not initialized, and free what a failed test left */
+	ENC_Opus_Deinit();
+	DEC_Opus_Deinit();
+}
+
+ZTEST(sw_codec_opus_profile, test_speech_low_latency)
+{
+	profile_check("speech-low-latency");
+}
+
+ZTEST(sw_codec_opus_profile, test_music_hq)
+{
+	profile_check("music-hq");
+}
+
+ZTEST(sw_codec_opus_profile, test_robust_lossy)
+{
+	profile_check("robust-lossy");
+}
+
+ZTEST_SUITE(sw_codec_opus_profile, NULL, NULL, NULL, profile_after, NULL);
@@ -383,7 +383,7 @@ int main(void)
 	ret = audio_system_init();
 	ERR_CHK(ret);
 
-	ret = audio_system_config_set(48000, 320000, 0);
+	ret = audio_system_config_set(CONFIG_SW_CODEC_SAMPLE_RATE_HZ, 320000, 0);
 	ERR_CHK_MSG(ret, "Failed to set sample and bitrate for encoder");
 
 	audio_system_start();
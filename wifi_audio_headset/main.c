@@ -393,7 +393,8 @@ int main(void)
 	ret = audio_system_init();
 	ERR_CHK(ret);
 
-	ret = audio_system_config_set(48000, 0, 48000);
+	ret = audio_system_config_set(CONFIG_SW_CODEC_SAMPLE_RATE_HZ, 0,
+				      CONFIG_SW_CODEC_SAMPLE_RATE_HZ);
 	ERR_CHK_MSG(ret, "Failed to set sample rate for decoder");
 
 	audio_system_start();